@@ -135,6 +135,11 @@ PyObject* PyGC_AddRoot(PyObject*) PYSTON_NOEXCEPT;
 // to reduce any chances of compiler reorderings or a GC somehow happening between the assignment
 // to the static slot and the call to PyGC_AddRoot.
 
+// Pyston addition:
+// Lets the collector know about a new weakref object, so that it can find weakly-referenced garbage
+// without having to wait for the sweep phase.  Doesn't keep the weakref alive.
+void PyGC_RegisterWeakref(PyObject*) PYSTON_NOEXCEPT;
+
 // Pyston change : expose these type objects
 extern PyTypeObject Pattern_Type;
 extern PyTypeObject Match_Type;
@@ -94,7 +94,13 @@ struct _dictobject {
 #endif
 typedef struct {
     PyObject_HEAD;
-    char _filler[SIZEOF_UNORDEREDMAP];
+    // Pyston change: this is the layout of BoxedDict::DictMap
+    void* _table;
+    void* _entries;
+    Py_ssize_t _num_items;
+    Py_ssize_t _num_entries;
+    Py_ssize_t _usable_left;
+    Py_ssize_t _log_size;
 } PyDictObject;
 
 // Pyston change: these are no longer static objects:
@@ -97,6 +97,15 @@ PyAPI_FUNC(void) _Py_ReleaseInternedStrings(void) PYSTON_NOEXCEPT;
 // Pyston addition:
 PyAPI_FUNC(char) PyString_GetItem(PyObject *, Py_ssize_t) PYSTON_NOEXCEPT;
 
+// Pyston addition: vectorized byte-string kernels (src/runtime/stringkernels.cpp).  The searches return the index
+// of the match, or -1.
+PyAPI_FUNC(Py_ssize_t) _PyString_FindChar(const char* s, Py_ssize_t n, char c) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyString_RFindChar(const char* s, Py_ssize_t n, char c) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyString_CountChar(const char* s, Py_ssize_t n, char c, Py_ssize_t maxcount) PYSTON_NOEXCEPT;
+PyAPI_FUNC(Py_ssize_t) _PyString_FindSubstring(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m) PYSTON_NOEXCEPT;
+PyAPI_FUNC(void) _PyString_Lower(char* dest, const char* src, Py_ssize_t n) PYSTON_NOEXCEPT;
+PyAPI_FUNC(void) _PyString_Upper(char* dest, const char* src, Py_ssize_t n) PYSTON_NOEXCEPT;
+
 /* Use only if you know it's a string */
 // Pyston changes: these aren't direct macros any more [they potentially could be though]
 //#define PyString_CHECK_INTERNED(op) (((PyStringObject *)(op))->ob_sstate)
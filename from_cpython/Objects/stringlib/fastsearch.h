@@ -52,6 +52,15 @@ fastsearch(const STRINGLIB_CHAR* s, Py_ssize_t n,
         if (m <= 0)
             return -1;
         /* use special case for 1-character strings */
+#if !STRINGLIB_IS_UNICODE
+        /* Pyston change: use the vectorized kernels from stringkernels.cpp for byte strings */
+        if (mode == FAST_COUNT)
+            return _PyString_CountChar(s, n, p[0], maxcount);
+        else if (mode == FAST_SEARCH)
+            return _PyString_FindChar(s, n, p[0]);
+        else
+            return _PyString_RFindChar(s, n, p[0]);
+#endif
         if (mode == FAST_COUNT) {
             for (i = 0; i < n; i++)
                 if (s[i] == p[0]) {
@@ -72,6 +81,12 @@ fastsearch(const STRINGLIB_CHAR* s, Py_ssize_t n,
         return -1;
     }
 
+#if !STRINGLIB_IS_UNICODE
+    /* Pyston change: forward searches go through the vectorized kernel instead */
+    if (mode == FAST_SEARCH)
+        return _PyString_FindSubstring(s, n, p, m);
+#endif
+
     mlast = m - 1;
     skip = mlast - 1;
     mask = 0;
@@ -115,6 +115,19 @@ stringlib_split_char(PyObject* str_obj,
         return NULL;
 
     i = j = 0;
+#if !STRINGLIB_IS_UNICODE
+    /* Pyston change: search with the vectorized kernel from stringkernels.cpp */
+    while ((j < str_len) && (maxcount-- > 0)) {
+        Py_ssize_t found = _PyString_FindChar(str + j, str_len - j, ch);
+        if (found == -1) {
+            j = str_len;
+            break;
+        }
+        j += found;
+        SPLIT_ADD(str, i, j);
+        i = j = j + 1;
+    }
+#else
     while ((j < str_len) && (maxcount-- > 0)) {
         for(; j < str_len; j++) {
             /* I found that using memchr makes no difference */
@@ -125,6 +138,7 @@ stringlib_split_char(PyObject* str_obj,
             }
         }
     }
+#endif
 #ifndef STRINGLIB_MUTABLE
     if (count == 0 && STRINGLIB_CHECK_EXACT(str_obj)) {
         /* ch not in str_obj, so just use str_obj as list[0] */
@@ -28,6 +28,9 @@ init_weakref(PyWeakReference *self, PyObject *ob, PyObject *callback)
     self->wr_object = ob;
     Py_XINCREF(callback);
     self->wr_callback = callback;
+
+    // Pyston change: the gc needs to know about all weakrefs
+    PyGC_RegisterWeakref((PyObject*)self);
 }
 
 static PyWeakReference *
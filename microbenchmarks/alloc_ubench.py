@@ -0,0 +1,13 @@
+# Allocates lots of short-lived ints, floats and small tuples, which all come out of the
+# smallest size classes.
+def f():
+    t = 0
+    x = 1.0
+    for i in xrange(10000000):
+        t += i
+        x = x * 1.0000001
+        p = (i, x)
+        q = (p, t)
+    return t, q
+
+f()
@@ -0,0 +1,5 @@
+keys = ["some_longer_attribute_name_%d" % i for i in xrange(64)]
+d = dict.fromkeys(keys, 1)
+for i in xrange(200000):
+    for k in keys:
+        d[k]
@@ -0,0 +1,38 @@
+# Measures how the gc mark phase scales with the number of marking threads.
+# Run with -s to also get the us_gc_mark_phase counter for each thread count.
+
+import gc
+import time
+import __pyston__
+
+class Node(object):
+    def __init__(self, children):
+        self.children = children
+        self.payload = (len(children), str(len(children)))
+
+def make_tree(depth, width):
+    if depth == 0:
+        return Node([])
+    return Node([make_tree(depth - 1, width) for i in xrange(width)])
+
+# A few wide trees plus some flat containers, so that there's a decent amount of work to share:
+heap = [make_tree(6, 6) for i in xrange(4)]
+heap.append([[i, float(i), str(i)] for i in xrange(200000)])
+heap.append(dict((i, (i,)) for i in xrange(100000)))
+
+NCOLLECTIONS = 10
+
+def run(nthreads):
+    __pyston__.setOption("GC_MARK_THREADS", nthreads)
+    gc.collect()
+
+    __pyston__.clearStats()
+    start = time.time()
+    for i in xrange(NCOLLECTIONS):
+        gc.collect()
+    elapsed = time.time() - start
+    print "%d thread(s): %.1fms per collection" % (nthreads, elapsed * 1000.0 / NCOLLECTIONS)
+    __pyston__.dumpStats()
+
+for nthreads in (1, 2, 4, 8):
+    run(nthreads)
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Runs the grwl_scaling.py workloads with the GIL build and the GRWL build, at a few different thread counts.
+# Run from the top of the repository after `make pyston_release pyston_grwl`.
+#
+# usage: microbenchmarks/grwl_compare.sh [workload...]
+
+set -e
+
+WORKLOADS=${*:-"handlers dict_reads attr_reads mixed"}
+THREADS="1 2 4 8"
+
+for workload in $WORKLOADS; do
+    for binary in pyston_release pyston_grwl; do
+        echo "== $binary"
+        for n in $THREADS; do
+            ./$binary microbenchmarks/grwl_scaling.py $workload $n
+        done
+    done
+done
@@ -0,0 +1,103 @@
+# Multithreaded workloads for comparing the GIL build against the GRWL build (make pyston_grwl), which lets threads
+# run Python code in parallel as long as they are only reading shared objects.
+#
+# usage: grwl_scaling.py <workload> [nthreads]
+#
+# The total amount of work is the same no matter how many threads there are, so with a lock that lets the threads run
+# in parallel, the throughput should go up with the thread count.  See grwl_compare.sh for running the whole matrix.
+
+import sys
+import time
+from thread import start_new_thread, allocate_lock
+
+TOTAL_OPS = 2000000
+
+
+# Shared read-only state, like the configuration and routing table of a server:
+CONFIG = dict(("option%d" % i, i) for i in xrange(100))
+ROUTES = dict(("/path/%d" % i, "handler%d" % (i % 7)) for i in xrange(50))
+PATHS = ROUTES.keys()
+
+class Settings(object):
+    def __init__(self):
+        self.timeout = 30
+        self.retries = 3
+        self.verbose = False
+        self.name = "server"
+SETTINGS = Settings()
+
+
+def handlers(n):
+    # Read-mostly request handling: look up the route and some configuration, and build a response.  Only the
+    # thread's own objects get modified.
+    npaths = len(PATHS)
+    responses = 0
+    for i in xrange(n):
+        path = PATHS[i % npaths]
+        handler = ROUTES[path]
+        limit = CONFIG["option%d" % (i % 100)]
+        response = [handler, path, limit, SETTINGS.timeout]
+        if len(response) == 4:
+            responses += 1
+    return responses
+
+def dict_reads(n):
+    total = 0
+    for i in xrange(n):
+        total += CONFIG["option42"]
+        total += CONFIG["option7"]
+    return total
+
+def attr_reads(n):
+    total = 0
+    s = SETTINGS
+    for i in xrange(n):
+        total += s.timeout
+        total += s.retries
+    return total
+
+COUNTERS = {"hits": 0}
+LOG = []
+def mixed(n):
+    # Mostly reads, with a couple of writes to shared objects every ten iterations: one that can be done in read mode
+    # (replacing the value of an existing dict key) and one that has to promote the GRWL (appending to a list).
+    total = 0
+    for i in xrange(n):
+        total += CONFIG["option%d" % (i % 100)]
+        if i % 10 == 0:
+            COUNTERS["hits"] = i
+            LOG.append(i)
+    return total
+
+WORKLOADS = {
+    "handlers": handlers,
+    "dict_reads": dict_reads,
+    "attr_reads": attr_reads,
+    "mixed": mixed,
+}
+
+
+def run(workload, nthreads):
+    f = WORKLOADS[workload]
+    per_thread = TOTAL_OPS / nthreads
+
+    lock = allocate_lock()
+    done = []
+    def thread_main():
+        f(per_thread)
+        with lock:
+            done.append(None)
+
+    start = time.time()
+    for i in xrange(nthreads):
+        start_new_thread(thread_main, ())
+    while len(done) < nthreads:
+        time.sleep(0.001)
+    elapsed = time.time() - start
+
+    print "%s, %d threads: %.2fs, %.0f ops/s" % (workload, nthreads, elapsed, per_thread * nthreads / elapsed)
+
+if __name__ == "__main__":
+    workload = sys.argv[1] if len(sys.argv) > 1 else "handlers"
+    nthreads = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+    run(workload, nthreads)
@@ -0,0 +1,39 @@
+# Attribute loads and method calls in code that only ever runs in the interpreter.
+# Run with -J to turn off the baseline jit and the LLVM tier, and compare against
+# __pyston__.setOption("ENABLE_INTERPRETER_CACHES", 0) to see what the interpreter's caches buy.
+
+class Request(object):
+    def __init__(self, path, method):
+        self.path = path
+        self.method = method
+        self.headers = {}
+
+    def get_header(self, name):
+        return self.headers.get(name)
+
+class Handler(object):
+    prefix = "/api"
+
+    def __init__(self):
+        self.count = 0
+
+    def matches(self, req):
+        return req.path.startswith(self.prefix)
+
+    def handle(self, req):
+        self.count += 1
+        if req.method == "GET":
+            return req.get_header("accept")
+        return None
+
+def f(n):
+    h = Handler()
+    r = Request("/api/foo", "GET")
+    r.headers["accept"] = "text/html"
+    for i in xrange(n):
+        if h.matches(r):
+            h.handle(r)
+        h.count = h.count + r.path.count("/")
+    return h.count
+
+print f(2000000)
@@ -0,0 +1,14 @@
+def f():
+    a = set(range(0, 2000))
+    b = set(range(1000, 3000))
+    small = set(range(0, 2000, 100))
+    t = 0
+    for i in xrange(2000):
+        t += len(a | b)
+        t += len(a & b)
+        t += len(a - b)
+        t += len(a - small)
+        t += len(small & b)
+        t += a.issubset(b) + small.issubset(a)
+    print t
+f()
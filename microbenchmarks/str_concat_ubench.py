@@ -0,0 +1,12 @@
+# Builds up large strings with +=, the way that template rendering code tends to.
+def render(rows):
+    out = ""
+    for i in xrange(rows):
+        out += "<tr><td>"
+        out += str(i)
+        out += "</td><td>row number %d</td></tr>\n" % i
+    return out
+
+for i in xrange(20):
+    s = render(50000)
+print len(s)
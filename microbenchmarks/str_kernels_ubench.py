@@ -0,0 +1,17 @@
+short = "hello world, this is a string"
+medium = ("The quick brown fox jumps over the lazy dog. " * 20) + "needle"
+big = ("lorem ipsum dolor sit amet, " * 100000) + "needle"
+
+def f(s, n):
+    for i in xrange(n):
+        "needle" in s
+        s.find("needle")
+        s.count(",")
+        s.split(",")
+        s.replace("o", "0")
+        s.lower()
+        s.upper()
+
+f(short, 200000)
+f(medium, 20000)
+f(big, 10)
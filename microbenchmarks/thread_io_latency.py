@@ -0,0 +1,24 @@
+# How long a thread that wakes up from blocking has to wait for the GIL while other threads are busy running Python
+# code; this used to be unbounded.
+from thread import start_new_thread
+import time
+
+stop = []
+def spin():
+    while not stop:
+        pass
+
+for i in xrange(3):
+    start_new_thread(spin, ())
+
+worst = 0
+total = 0
+for i in xrange(500):
+    start = time.time()
+    time.sleep(0.0005)
+    elapsed = time.time() - start
+    total += elapsed
+    worst = max(worst, elapsed)
+stop.append(True)
+
+print "average %.2fms, worst %.2fms" % (total / 500 * 1000, worst * 1000)
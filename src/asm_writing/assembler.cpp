@@ -103,6 +103,49 @@ void Assembler::emitArith(Immediate imm, Register r, int opcode) {
     }
 }
 
+void Assembler::emitArith(Register src, Register dest, int opcode) {
+    assert(0 <= opcode && opcode < 8);
+
+    int rex = REX_W;
+
+    int src_idx = src.regnum;
+    int dest_idx = dest.regnum;
+    if (src_idx >= 8) {
+        rex |= REX_R;
+        src_idx -= 8;
+    }
+    if (dest_idx >= 8) {
+        rex |= REX_B;
+        dest_idx -= 8;
+    }
+
+    emitRex(rex);
+    emitByte((opcode << 3) | 0x01);
+    emitModRM(0b11, src_idx, dest_idx);
+}
+
+void Assembler::emitSSEArith(XMMRegister src, XMMRegister dest, uint8_t opcode) {
+    int rex = 0;
+    int src_idx = src.regnum;
+    int dest_idx = dest.regnum;
+
+    if (dest_idx >= 8) {
+        rex |= REX_R;
+        dest_idx -= 8;
+    }
+    if (src_idx >= 8) {
+        rex |= REX_B;
+        src_idx -= 8;
+    }
+
+    emitByte(0xf2);
+    if (rex)
+        emitRex(rex);
+    emitByte(0x0f);
+    emitByte(opcode);
+
+    emitModRM(0b11, dest_idx, src_idx);
+}
 
 void Assembler::emitByte(uint8_t b) {
     if (addr >= end_addr) {
@@ -569,6 +612,18 @@ void Assembler::cvtss2sd(XMMRegister src, XMMRegister dest) {
     emitModRM(0b11, src_idx, dest_idx);
 }
 
+void Assembler::addsd(XMMRegister src, XMMRegister dest) {
+    emitSSEArith(src, dest, 0x58);
+}
+
+void Assembler::subsd(XMMRegister src, XMMRegister dest) {
+    emitSSEArith(src, dest, 0x5c);
+}
+
+void Assembler::mulsd(XMMRegister src, XMMRegister dest) {
+    emitSSEArith(src, dest, 0x59);
+}
+
 void Assembler::push(Register reg) {
     // assert(0 && "This breaks unwinding, please don't use.");
 
@@ -609,6 +664,34 @@ void Assembler::sub(Immediate imm, Register reg) {
     emitArith(imm, reg, OPCODE_SUB);
 }
 
+void Assembler::add(Register src, Register dest) {
+    emitArith(src, dest, OPCODE_ADD);
+}
+
+void Assembler::sub(Register src, Register dest) {
+    emitArith(src, dest, OPCODE_SUB);
+}
+
+void Assembler::imul(Register src, Register dest) {
+    int rex = REX_W;
+
+    int src_idx = src.regnum;
+    int dest_idx = dest.regnum;
+    if (dest_idx >= 8) {
+        rex |= REX_R;
+        dest_idx -= 8;
+    }
+    if (src_idx >= 8) {
+        rex |= REX_B;
+        src_idx -= 8;
+    }
+
+    emitRex(rex);
+    emitByte(0x0f);
+    emitByte(0xaf);
+    emitModRM(0b11, dest_idx, src_idx);
+}
+
 void Assembler::incl(Indirect mem) {
     int src_idx = mem.base.regnum;
 
@@ -87,6 +87,8 @@ private:
     void emitModRM(uint8_t mod, uint8_t reg, uint8_t rm);
     void emitSIB(uint8_t scalebits, uint8_t index, uint8_t base);
     void emitArith(Immediate imm, Register reg, int opcode);
+    void emitArith(Register src, Register dest, int opcode);
+    void emitSSEArith(XMMRegister src, XMMRegister dest, uint8_t opcode);
 
     int getModeFromOffset(int offset) const;
 
@@ -128,6 +130,9 @@ public:
     void movsd(Indirect src, XMMRegister dest);
 
     void movss(Indirect src, XMMRegister dest);
+    void addsd(XMMRegister src, XMMRegister dest);
+    void subsd(XMMRegister src, XMMRegister dest);
+    void mulsd(XMMRegister src, XMMRegister dest);
     void cvtss2sd(XMMRegister src, XMMRegister dest);
 
     void mov(Indirect scr, Register dest);
@@ -151,6 +156,9 @@ public:
 
     void add(Immediate imm, Register reg);
     void sub(Immediate imm, Register reg);
+    void add(Register src, Register dest);
+    void sub(Register src, Register dest);
+    void imul(Register src, Register dest);
 
     void incl(Indirect mem);
     void decl(Indirect mem);
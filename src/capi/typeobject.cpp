@@ -3174,7 +3174,23 @@ void commonClassSetup(BoxedClass* cls) {
 }
 
 extern "C" void PyType_Modified(PyTypeObject* type) noexcept {
-    // We don't cache anything yet that would need to be invalidated:
+    // Invalidate the cached lookups (see typeLookup) for this type and all of its subclasses; if the type doesn't have
+    // a valid version tag, neither do its subclasses.
+    if (!PyType_HasFeature(type, Py_TPFLAGS_VALID_VERSION_TAG))
+        return;
+
+    PyObject* raw = type->tp_subclasses;
+    if (raw != NULL) {
+        Py_ssize_t n = PyList_GET_SIZE(raw);
+        for (Py_ssize_t i = 0; i < n; i++) {
+            PyObject* ref = PyWeakref_GET_OBJECT(PyList_GET_ITEM(raw, i));
+            if (ref != Py_None)
+                PyType_Modified((PyTypeObject*)ref);
+        }
+    }
+    type->tp_flags &= ~Py_TPFLAGS_VALID_VERSION_TAG;
+    // ICs guard on just the tag, so it can't keep its old value:
+    type->tp_version_tag = 0;
 }
 
 static Box* tppProxyToTpCall(Box* self, CallRewriteArgs* rewrite_args, ArgPassSpec argspec, Box* arg1, Box* arg2,
@@ -22,6 +22,7 @@
 #include "analysis/scoping_analysis.h"
 #include "codegen/baseline_jit.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/compvars.h"
 #include "codegen/irgen.h"
 #include "codegen/irgen/hooks.h"
@@ -341,12 +342,18 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
     bool should_jit = false;
     bool from_start = start_block == NULL && start_at == NULL;
 
+    bool use_jit_cache = ENABLE_BASELINEJIT && ENABLE_BASELINEJIT_CACHE;
+    if (use_jit_cache)
+        loadBaselineJITCacheEntry(interpreter.source_info);
+
     assert((start_block == NULL) == (start_at == NULL));
     if (start_block == NULL) {
         start_block = interpreter.source_info->cfg->getStartingBlock();
         start_at = start_block->body[0];
 
-        if (ENABLE_BASELINEJIT && interpreter.clfunc->times_interpreted >= REOPT_THRESHOLD_INTERPRETER
+        if (ENABLE_BASELINEJIT
+            && (interpreter.clfunc->times_interpreted >= REOPT_THRESHOLD_INTERPRETER
+                || (use_jit_cache && wasBaselineJITedPreviously(start_block)))
             && !start_block->code)
             should_jit = true;
     }
@@ -391,7 +398,8 @@ Box* ASTInterpreter::executeInner(ASTInterpreter& interpreter, CFGBlock* start_b
             }
         }
 
-        if (ENABLE_BASELINEJIT && should_jit && !interpreter.jit) {
+        if (ENABLE_BASELINEJIT && !interpreter.jit
+            && (should_jit || (use_jit_cache && wasBaselineJITedPreviously(interpreter.current_block)))) {
             assert(!interpreter.current_block->code);
             interpreter.startJITing(interpreter.current_block);
         }
@@ -612,7 +620,9 @@ Value ASTInterpreter::visit_jump(AST_Jump* node) {
     if (ENABLE_BASELINEJIT && backedge && edgecount == OSR_THRESHOLD_INTERPRETER && !jit && !node->target->code)
         startJITing(node->target);
 
-    if (backedge && edgecount == OSR_THRESHOLD_BASELINE) {
+    // With background compiles, doOSR has to keep checking whether the compile has finished:
+    if (backedge && (edgecount == OSR_THRESHOLD_BASELINE
+                     || (ENABLE_BACKGROUND_COMPILE && edgecount > OSR_THRESHOLD_BASELINE))) {
         Box* rtn = doOSR(node);
         if (rtn)
             return Value(rtn, NULL);
@@ -627,6 +637,14 @@ Box* ASTInterpreter::doOSR(AST_Jump* node) {
     if (!can_osr)
         return NULL;
 
+    if (ENABLE_BACKGROUND_COMPILE) {
+        for (auto& p : clfunc->osr_versions) {
+            // The compile for this backedge is still in the queue:
+            if (p.first->backedge == node && !p.second)
+                return NULL;
+        }
+    }
+
     static StatCounter ast_osrs("num_ast_osrs");
     ast_osrs.log();
 
@@ -727,6 +745,12 @@ Box* ASTInterpreter::doOSR(AST_Jump* node) {
         found_entry = entry;
     }
 
+    if (ENABLE_BACKGROUND_COMPILE && !clfunc->osr_versions.count(found_entry)) {
+        // Keep going where we are; we'll check again at the next backedge.
+        enqueueOSRCompile(found_entry);
+        return NULL;
+    }
+
     OSRExit exit(found_entry);
 
     std::vector<Box*, StlCompatAllocator<Box*>> arg_array;
@@ -1262,6 +1286,12 @@ Value ASTInterpreter::visit_expr(AST_expr* node) {
 }
 
 
+static GetattrCache* getGetattrCache(AST_Attribute* node) {
+    if (unlikely(!node->getattr_cache))
+        node->getattr_cache = new GetattrCache();
+    return node->getattr_cache;
+}
+
 Value ASTInterpreter::visit_call(AST_Call* node) {
     Value v;
     Value func;
@@ -1270,12 +1300,15 @@ Value ASTInterpreter::visit_call(AST_Call* node) {
 
     bool is_callattr = false;
     bool callattr_clsonly = false;
+    GetattrCache* getattr_cache = NULL;
     if (node->func->type == AST_TYPE::Attribute) {
         is_callattr = true;
         callattr_clsonly = false;
         AST_Attribute* attr_ast = ast_cast<AST_Attribute>(node->func);
         func = visit_expr(attr_ast->value);
         attr = attr_ast->attr;
+        if (ENABLE_INTERPRETER_CACHES)
+            getattr_cache = getGetattrCache(attr_ast);
     } else if (node->func->type == AST_TYPE::ClsAttribute) {
         is_callattr = true;
         callattr_clsonly = true;
@@ -1324,9 +1357,14 @@ Value ASTInterpreter::visit_call(AST_Call* node) {
         if (jit)
             v.var = jit->emitCallattr(node, func, attr.getBox(), callattr_flags, args_vars, keyword_names);
 
-        v.o = callattr(func.o, attr.getBox(), callattr_flags, args.size() > 0 ? args[0] : 0,
-                       args.size() > 1 ? args[1] : 0, args.size() > 2 ? args[2] : 0, args.size() > 3 ? &args[3] : 0,
-                       keyword_names);
+        if (getattr_cache)
+            v.o = callattrCached(func.o, attr.getBox(), getattr_cache, callattr_flags, args.size() > 0 ? args[0] : 0,
+                                 args.size() > 1 ? args[1] : 0, args.size() > 2 ? args[2] : 0,
+                                 args.size() > 3 ? &args[3] : 0, keyword_names);
+        else
+            v.o = callattr(func.o, attr.getBox(), callattr_flags, args.size() > 0 ? args[0] : 0,
+                           args.size() > 1 ? args[1] : 0, args.size() > 2 ? args[2] : 0,
+                           args.size() > 3 ? &args[3] : 0, keyword_names);
         return v;
     } else {
         Value v;
@@ -1400,14 +1438,15 @@ Value ASTInterpreter::visit_dict(AST_Dict* node) {
 Value ASTInterpreter::visit_set(AST_Set* node) {
     llvm::SmallVector<RewriterVar*, 8> items;
 
-    BoxedSet::Set set;
+    // The set's table only keeps its elements alive once it's inside a BoxedSet:
+    BoxedSet* set = new BoxedSet();
     for (AST_expr* e : node->elts) {
         Value v = visit_expr(e);
-        set.insert(v.o);
+        set->s.insert(v.o);
         items.push_back(v);
     }
 
-    return Value(new BoxedSet(std::move(set)), jit ? jit->emitCreateSet(items) : NULL);
+    return Value(set, jit ? jit->emitCreateSet(items) : NULL);
 }
 
 Value ASTInterpreter::visit_str(AST_Str* node) {
@@ -1517,8 +1556,9 @@ Value ASTInterpreter::visit_tuple(AST_Tuple* node) {
 
 Value ASTInterpreter::visit_attribute(AST_Attribute* node) {
     Value v = visit_expr(node->value);
-    return Value(pyston::getattr(v.o, node->attr.getBox()),
-                 jit ? jit->emitGetAttr(v, node->attr.getBox(), node) : NULL);
+    Box* o = ENABLE_INTERPRETER_CACHES ? getattrCached(v.o, node->attr.getBox(), getGetattrCache(node))
+                                       : pyston::getattr(v.o, node->attr.getBox());
+    return Value(o, jit ? jit->emitGetAttr(v, node->attr.getBox(), node) : NULL);
 }
 }
 
@@ -1638,7 +1678,15 @@ Box* astInterpretFunction(CLFunction* clfunc, int nargs, Box* closure, Box* gene
     // function.
     int num_blocks = source_info->cfg ? source_info->cfg->blocks.size() : 10000;
     int threshold = num_blocks <= 20 ? (REOPT_THRESHOLD_BASELINE / 3) : REOPT_THRESHOLD_BASELINE;
-    if (unlikely(can_reopt && (FORCE_OPTIMIZE || !ENABLE_INTERPRETER || clfunc->times_interpreted > threshold))) {
+    if (unlikely(can_reopt && ENABLE_BACKGROUND_COMPILE && ENABLE_INTERPRETER && !FORCE_OPTIMIZE
+                 && clfunc->times_interpreted > threshold)) {
+        // Keep interpreting until the new version is ready; the first call after that will pick it up.
+        clfunc->times_interpreted = 0;
+
+        std::vector<ConcreteCompilerType*> arg_types(nargs, UNKNOWN);
+        enqueueCompile(clfunc, new FunctionSpecialization(UNKNOWN, arg_types), EffortLevel::MODERATE);
+    } else if (unlikely(can_reopt
+                        && (FORCE_OPTIMIZE || !ENABLE_INTERPRETER || clfunc->times_interpreted > threshold))) {
         assert(!globals);
 
         clfunc->times_interpreted = 0;
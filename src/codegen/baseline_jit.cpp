@@ -14,13 +14,22 @@
 
 #include "codegen/baseline_jit.h"
 
+#include <cstdio>
+#include <set>
+#include <unistd.h>
+#include <unordered_map>
+
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/DenseSet.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 
 #include "codegen/irgen/hooks.h"
 #include "codegen/memmgr.h"
 #include "codegen/type_recording.h"
 #include "core/cfg.h"
+#include "core/options.h"
+#include "core/stats.h"
 #include "runtime/generator.h"
 #include "runtime/inline/list.h"
 #include "runtime/objmodel.h"
@@ -31,6 +40,8 @@ namespace pyston {
 
 static llvm::DenseSet<CFGBlock*> blocks_aborted;
 static llvm::DenseMap<CFGBlock*, std::vector<void*>> block_patch_locations;
+// Blocks that the baseline jit cache says to compile the first time they get executed:
+static llvm::DenseSet<CFGBlock*> blocks_jitted_previously;
 
 // The EH table is copied from the one clang++ generated for:
 //
@@ -146,6 +157,9 @@ JitFragmentWriter::JitFragmentWriter(CFGBlock* block, std::unique_ptr<ICInfo> ic
     vregs_array = createNewVar();
     addLocationToVar(vregs_array, assembler::R14);
     addAction([=]() { vregs_array->bumpUse(); }, vregs_array, ActionType::NORMAL);
+
+    if (ENABLE_BLOCK_COUNTS)
+        addAction([=]() { _emitBlockCount(); }, {}, ActionType::NORMAL);
 }
 
 RewriterVar* JitFragmentWriter::imm(uint64_t val) {
@@ -156,12 +170,45 @@ RewriterVar* JitFragmentWriter::imm(void* val) {
     return loadConst((uint64_t)val);
 }
 
-RewriterVar* JitFragmentWriter::emitAugbinop(RewriterVar* lhs, RewriterVar* rhs, int op_type) {
-    return emitPPCall((void*)augbinop, { lhs, rhs, imm(op_type) }, 2, 320);
+// If both operands are exact ints or exact floats and the operation is one that _emitNumericFastPath knows how to
+// do inline, returns their class.  The operands are the ones the interpreter is currently executing with, so this
+// only bets on the types we have actually seen at this site.
+static BoxedClass* numericFastPathCls(Box* lhs, Box* rhs, int op_type, bool is_compare) {
+    if (lhs->cls != rhs->cls)
+        return NULL;
+
+    if (is_compare) {
+        if (lhs->cls != int_cls)
+            return NULL;
+        switch (op_type) {
+            case AST_TYPE::Eq:
+            case AST_TYPE::NotEq:
+            case AST_TYPE::Lt:
+            case AST_TYPE::LtE:
+            case AST_TYPE::Gt:
+            case AST_TYPE::GtE:
+                return int_cls;
+            default:
+                return NULL;
+        }
+    }
+
+    if (lhs->cls != int_cls && lhs->cls != float_cls)
+        return NULL;
+    if (op_type == AST_TYPE::Add || op_type == AST_TYPE::Sub || op_type == AST_TYPE::Mult)
+        return lhs->cls;
+    return NULL;
+}
+
+RewriterVar* JitFragmentWriter::emitAugbinop(Value lhs, Value rhs, int op_type) {
+    // ints and floats don't have inplace operators, so augbinop does the same thing as binop for them.
+    return emitPPCall((void*)augbinop, { lhs, rhs, imm(op_type) }, 2, 320, NULL,
+                      numericFastPathCls(lhs.o, rhs.o, op_type, false), op_type);
 }
 
-RewriterVar* JitFragmentWriter::emitBinop(RewriterVar* lhs, RewriterVar* rhs, int op_type) {
-    return emitPPCall((void*)binop, { lhs, rhs, imm(op_type) }, 2, 240);
+RewriterVar* JitFragmentWriter::emitBinop(Value lhs, Value rhs, int op_type) {
+    return emitPPCall((void*)binop, { lhs, rhs, imm(op_type) }, 2, 240, NULL,
+                      numericFastPathCls(lhs.o, rhs.o, op_type, false), op_type);
 }
 
 RewriterVar* JitFragmentWriter::emitCallattr(AST_expr* node, RewriterVar* obj, BoxedString* attr, CallattrFlags flags,
@@ -221,9 +268,10 @@ RewriterVar* JitFragmentWriter::emitCallattr(AST_expr* node, RewriterVar* obj, B
 #endif
 }
 
-RewriterVar* JitFragmentWriter::emitCompare(RewriterVar* lhs, RewriterVar* rhs, int op_type) {
+RewriterVar* JitFragmentWriter::emitCompare(Value lhs, Value rhs, int op_type) {
     // TODO: can directly emit the assembly for Is/IsNot
-    return emitPPCall((void*)compare, { lhs, rhs, imm(op_type) }, 2, 240);
+    return emitPPCall((void*)compare, { lhs, rhs, imm(op_type) }, 2, 240, NULL,
+                      numericFastPathCls(lhs.o, rhs.o, op_type, true), op_type);
 }
 
 RewriterVar* JitFragmentWriter::emitCreateDict(const llvm::ArrayRef<RewriterVar*> keys,
@@ -317,8 +365,18 @@ RewriterVar* JitFragmentWriter::emitGetItem(RewriterVar* value, RewriterVar* sli
 
 RewriterVar* JitFragmentWriter::emitGetLocal(InternedString s, int vreg) {
     assert(vreg >= 0);
+    // Python code can't change a function's fast locals behind its back (the statements that could, like del, don't
+    // get JITed), and a value that we loaded before has already been checked for being defined:
+    auto it = known_vregs.find(vreg);
+    if (it != known_vregs.end()) {
+        static StatCounter sc_forwarded("num_baselinejit_vreg_loads_forwarded");
+        sc_forwarded.log();
+        return it->second;
+    }
+
     RewriterVar* val_var = vregs_array->getAttr(vreg * 8);
     addAction([=]() { _emitGetLocal(val_var, s.c_str()); }, { val_var }, ActionType::NORMAL);
+    known_vregs[vreg] = val_var;
     return val_var;
 }
 
@@ -489,6 +547,7 @@ void JitFragmentWriter::emitSetLocal(InternedString s, int vreg, bool set_closur
     } else {
         vregs_array->setAttr(8 * vreg, v);
     }
+    known_vregs[vreg] = v;
 }
 
 void JitFragmentWriter::emitSideExit(RewriterVar* v, Box* cmp_value, CFGBlock* next_block) {
@@ -611,12 +670,14 @@ RewriterVar* JitFragmentWriter::getInterp() {
 }
 
 RewriterVar* JitFragmentWriter::emitPPCall(void* func_addr, llvm::ArrayRef<RewriterVar*> args, int num_slots,
-                                           int slot_size, TypeRecorder* type_recorder) {
+                                           int slot_size, TypeRecorder* type_recorder, BoxedClass* fast_path_cls,
+                                           int fast_path_op) {
     RewriterVar::SmallVector args_vec(args.begin(), args.end());
 #if ENABLE_BASELINEJIT_ICS
     RewriterVar* result = createNewVar();
-    addAction([=]() { this->_emitPPCall(result, func_addr, args_vec, num_slots, slot_size); }, args,
-              ActionType::NORMAL);
+    addAction([=]() {
+        this->_emitPPCall(result, func_addr, args_vec, num_slots, slot_size, fast_path_cls, fast_path_op);
+    }, args, ActionType::NORMAL);
     if (type_recorder)
         return call(false, (void*)recordType, imm(type_recorder), result);
     return result;
@@ -694,6 +755,19 @@ Box* JitFragmentWriter::runtimeCallHelper(Box* obj, ArgPassSpec argspec, TypeRec
     return recordType(type_recorder, r);
 }
 
+void JitFragmentWriter::_emitBlockCount() {
+    uintptr_t counter_addr = (uintptr_t)&block->bjit_count;
+    if (isLargeConstant(counter_addr)) {
+        assembler::Register reg = allocReg(Location::any());
+        assembler->mov(assembler::Immediate(counter_addr), reg);
+        assembler->incl(assembler::Indirect(reg, 0));
+    } else {
+        assembler->incl(assembler::Immediate(counter_addr));
+    }
+
+    assertConsistent();
+}
+
 void JitFragmentWriter::_emitGetLocal(RewriterVar* val_var, const char* name) {
     assembler::Register var_reg = val_var->getInReg();
     assembler->test(var_reg, var_reg);
@@ -755,8 +829,96 @@ void JitFragmentWriter::_emitOSRPoint(RewriterVar* result, RewriterVar* node_var
     assertConsistent();
 }
 
+static assembler::ConditionCode intCompareCondition(int op_type) {
+    switch (op_type) {
+        case AST_TYPE::Eq:
+            return assembler::COND_EQUAL;
+        case AST_TYPE::NotEq:
+            return assembler::COND_NOT_EQUAL;
+        case AST_TYPE::Lt:
+            return assembler::COND_LESS;
+        case AST_TYPE::LtE:
+            return assembler::COND_NOT_GREATER;
+        case AST_TYPE::Gt:
+            return assembler::COND_GREATER;
+        case AST_TYPE::GtE:
+            return assembler::COND_NOT_LESS;
+        default:
+            RELEASE_ASSERT(0, "%d", op_type);
+    }
+}
+
+void JitFragmentWriter::_emitNumericFastPath(BoxedClass* cls, int op_type, int slowpath_size) {
+    static StatCounter num_fast_paths("num_baselinejit_numeric_fast_paths");
+    num_fast_paths.log();
+
+    // _setupCall has put the operands into RDI and RSI and spilled everything else that is live, so we are free to
+    // use the other caller-saved registers here.  The argument registers have to be left alone until we know that we
+    // are not going to end up in the slowpath.
+    llvm::SmallVector<std::unique_ptr<assembler::ForwardJump>, 4> slowpath_jumps;
+    auto jump_to_slowpath = [&](assembler::ConditionCode condition) {
+        slowpath_jumps.emplace_back(new assembler::ForwardJump(*assembler, condition));
+    };
+
+    assembler->mov(assembler::Immediate(cls), assembler::RAX);
+    assembler->cmp(assembler::Indirect(assembler::RDI, offsetof(Box, cls)), assembler::RAX);
+    jump_to_slowpath(assembler::COND_NOT_EQUAL);
+    assembler->cmp(assembler::Indirect(assembler::RSI, offsetof(Box, cls)), assembler::RAX);
+    jump_to_slowpath(assembler::COND_NOT_EQUAL);
+
+    if (cls == float_cls) {
+        assembler->movsd(assembler::Indirect(assembler::RDI, offsetof(BoxedFloat, d)), assembler::XMM0);
+        assembler->movsd(assembler::Indirect(assembler::RSI, offsetof(BoxedFloat, d)), assembler::XMM1);
+        if (op_type == AST_TYPE::Add)
+            assembler->addsd(assembler::XMM1, assembler::XMM0);
+        else if (op_type == AST_TYPE::Sub)
+            assembler->subsd(assembler::XMM1, assembler::XMM0);
+        else if (op_type == AST_TYPE::Mult)
+            assembler->mulsd(assembler::XMM1, assembler::XMM0);
+        else
+            RELEASE_ASSERT(0, "%d", op_type);
+
+        assembler->mov(assembler::Immediate((void*)boxFloat), assembler::R11);
+        assembler->callq(assembler::R11);
+    } else {
+        assert(cls == int_cls);
+        assembler->mov(assembler::Indirect(assembler::RDI, offsetof(BoxedInt, n)), assembler::RAX);
+        assembler->mov(assembler::Indirect(assembler::RSI, offsetof(BoxedInt, n)), assembler::RCX);
+
+        if (op_type == AST_TYPE::Add || op_type == AST_TYPE::Sub || op_type == AST_TYPE::Mult) {
+            if (op_type == AST_TYPE::Add)
+                assembler->add(assembler::RCX, assembler::RAX);
+            else if (op_type == AST_TYPE::Sub)
+                assembler->sub(assembler::RCX, assembler::RAX);
+            else
+                assembler->imul(assembler::RCX, assembler::RAX);
+            // The result has to become a long; let the slowpath handle that.
+            jump_to_slowpath(assembler::COND_OVERFLOW);
+
+            assembler->mov(assembler::RAX, assembler::RDI);
+            assembler->mov(assembler::Immediate((void*)boxInt), assembler::R11);
+            assembler->callq(assembler::R11);
+        } else {
+            // Comparisons just pick one of the two bool singletons, without any call.
+            assembler->cmp(assembler::RCX, assembler::RAX);
+            assembler->mov(assembler::Immediate(True), assembler::RAX);
+            {
+                assembler::ForwardJump jump_true(*assembler, intCompareCondition(op_type));
+                assembler->mov(assembler::Immediate(False), assembler::RAX);
+            }
+        }
+    }
+
+    // Jump over the patchpoint: the result is in RAX, same as it would be after the slowpath call.
+    // slowpath_size is always large enough that this gets the 5 byte encoding.
+    assert(slowpath_size >= 0x80);
+    assembler->jmp(assembler::JumpDestination::fromStart(assembler->bytesWritten() + 5 + slowpath_size));
+
+    // slowpath_jumps get patched to point here, which is where the patchpoint starts.
+}
+
 void JitFragmentWriter::_emitPPCall(RewriterVar* result, void* func_addr, const RewriterVar::SmallVector& args,
-                                    int num_slots, int slot_size) {
+                                    int num_slots, int slot_size, BoxedClass* fast_path_cls, int fast_path_op) {
     assembler::Register r = allocReg(assembler::R11);
 
     if (args.size() > 6) { // only 6 args can get passed in registers.
@@ -775,10 +937,13 @@ void JitFragmentWriter::_emitPPCall(RewriterVar* result, void* func_addr, const
     assert(vars_by_location.count(assembler::R11) == 0);
 
     int pp_size = slot_size * num_slots;
+    constexpr int call_size = 16;
+
+    if (fast_path_cls)
+        _emitNumericFastPath(fast_path_cls, fast_path_op, pp_size + call_size);
 
     // make space for patchpoint
     uint8_t* pp_start = rewrite->getSlotStart() + assembler->bytesWritten();
-    constexpr int call_size = 16;
     assembler->skipBytes(pp_size + call_size);
     uint8_t* pp_end = rewrite->getSlotStart() + assembler->bytesWritten();
     assert(assembler->hasFailed() || (pp_start + pp_size + call_size == pp_end));
@@ -854,4 +1019,387 @@ void JitFragmentWriter::_emitSideExit(RewriterVar* var, RewriterVar* val_constan
 
     assertConsistent();
 }
+
+// Saves the baseline jit's decisions (which blocks it compiled, and which ones it had to give up on) across runs,
+// so that a restarted process can compile a function's hot blocks the first time they run, instead of
+// interpreting everything again until the thresholds are reached.
+//
+// We don't save the machine code itself: it's full of pointers to this process's objects (AST nodes, strings, type
+// recorders, IC slots), and generating it again is cheap compared to the warmup that decided what to generate.
+// Functions are identified by a hash of their CFG, including the contents of every statement, so an edited function
+// just looks like a new one.
+namespace {
+// Hashes everything in the statements that could change the code we generate: every node's type, plus the names,
+// constants and operators stored in them.
+class FunctionHasher : public ASTVisitor {
+public:
+    // FNV-1a
+    uint64_t hash = 14695981039346656037UL;
+
+    void add(const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t*)data)[i];
+            hash *= 1099511628211UL;
+        }
+    }
+    void add(uint64_t n) { add(&n, sizeof(n)); }
+    void add(llvm::StringRef s) {
+        add(s.size());
+        add(s.data(), s.size());
+    }
+
+private:
+    bool addNode(AST* node) {
+        add(node->type);
+        return false;
+    }
+
+public:
+#define HASH_NODE(name, cls)                                                                                           \
+    bool visit_##name(cls* node) override { return addNode(node); }
+
+    HASH_NODE(assert, AST_Assert)
+    HASH_NODE(assign, AST_Assign)
+    HASH_NODE(break, AST_Break)
+    HASH_NODE(call, AST_Call)
+    HASH_NODE(comprehension, AST_comprehension)
+    HASH_NODE(continue, AST_Continue)
+    HASH_NODE(delete, AST_Delete)
+    HASH_NODE(dict, AST_Dict)
+    HASH_NODE(dictcomp, AST_DictComp)
+    HASH_NODE(ellipsis, AST_Ellipsis)
+    HASH_NODE(excepthandler, AST_ExceptHandler)
+    HASH_NODE(exec, AST_Exec)
+    HASH_NODE(expr, AST_Expr)
+    HASH_NODE(extslice, AST_ExtSlice)
+    HASH_NODE(for, AST_For)
+    HASH_NODE(generatorexp, AST_GeneratorExp)
+    HASH_NODE(if, AST_If)
+    HASH_NODE(ifexp, AST_IfExp)
+    HASH_NODE(import, AST_Import)
+    HASH_NODE(index, AST_Index)
+    HASH_NODE(invoke, AST_Invoke)
+    HASH_NODE(lambda, AST_Lambda)
+    HASH_NODE(listcomp, AST_ListComp)
+    HASH_NODE(pass, AST_Pass)
+    HASH_NODE(raise, AST_Raise)
+    HASH_NODE(repr, AST_Repr)
+    HASH_NODE(return, AST_Return)
+    HASH_NODE(set, AST_Set)
+    HASH_NODE(setcomp, AST_SetComp)
+    HASH_NODE(slice, AST_Slice)
+    HASH_NODE(tryexcept, AST_TryExcept)
+    HASH_NODE(tryfinally, AST_TryFinally)
+    HASH_NODE(while, AST_While)
+    HASH_NODE(with, AST_With)
+    HASH_NODE(yield, AST_Yield)
+    HASH_NODE(makeclass, AST_MakeClass)
+    HASH_NODE(makefunction, AST_MakeFunction)
+#undef HASH_NODE
+
+    bool visit_alias(AST_alias* node) override {
+        add(node->name.s());
+        add(node->asname.s());
+        return addNode(node);
+    }
+    bool visit_arguments(AST_arguments* node) override {
+        add(node->vararg.s());
+        add(node->kwarg.s());
+        add(node->args.size());
+        add(node->defaults.size());
+        return addNode(node);
+    }
+    bool visit_augassign(AST_AugAssign* node) override {
+        add(node->op_type);
+        return addNode(node);
+    }
+    bool visit_augbinop(AST_AugBinOp* node) override {
+        add(node->op_type);
+        return addNode(node);
+    }
+    bool visit_attribute(AST_Attribute* node) override {
+        add(node->ctx_type);
+        add(node->attr.s());
+        return addNode(node);
+    }
+    bool visit_binop(AST_BinOp* node) override {
+        add(node->op_type);
+        return addNode(node);
+    }
+    bool visit_boolop(AST_BoolOp* node) override {
+        add(node->op_type);
+        add(node->values.size());
+        return addNode(node);
+    }
+    bool visit_clsattribute(AST_ClsAttribute* node) override {
+        add(node->attr.s());
+        return addNode(node);
+    }
+    bool visit_compare(AST_Compare* node) override {
+        for (auto op : node->ops)
+            add(op);
+        return addNode(node);
+    }
+    bool visit_classdef(AST_ClassDef* node) override {
+        add(node->name.s());
+        return addNode(node);
+    }
+    bool visit_functiondef(AST_FunctionDef* node) override {
+        add(node->name.s());
+        return addNode(node);
+    }
+    bool visit_global(AST_Global* node) override {
+        for (auto name : node->names)
+            add(name.s());
+        return addNode(node);
+    }
+    bool visit_importfrom(AST_ImportFrom* node) override {
+        add(node->module.s());
+        add(node->level);
+        return addNode(node);
+    }
+    bool visit_keyword(AST_keyword* node) override {
+        add(node->arg.s());
+        return addNode(node);
+    }
+    bool visit_langprimitive(AST_LangPrimitive* node) override {
+        add(node->opcode);
+        add(node->args.size());
+        return addNode(node);
+    }
+    bool visit_list(AST_List* node) override {
+        add(node->ctx_type);
+        add(node->elts.size());
+        return addNode(node);
+    }
+    bool visit_name(AST_Name* node) override {
+        add(node->ctx_type);
+        add(node->id.s());
+        return addNode(node);
+    }
+    bool visit_num(AST_Num* node) override {
+        add(node->num_type);
+        if (node->num_type == AST_Num::LONG)
+            add(node->n_long);
+        else
+            add(&node->n_int, sizeof(node->n_int));
+        return addNode(node);
+    }
+    bool visit_print(AST_Print* node) override {
+        add(node->nl);
+        add(node->values.size());
+        return addNode(node);
+    }
+    bool visit_str(AST_Str* node) override {
+        add(node->str_type);
+        add(node->str_data);
+        return addNode(node);
+    }
+    bool visit_subscript(AST_Subscript* node) override {
+        add(node->ctx_type);
+        return addNode(node);
+    }
+    bool visit_tuple(AST_Tuple* node) override {
+        add(node->ctx_type);
+        add(node->elts.size());
+        return addNode(node);
+    }
+    bool visit_unaryop(AST_UnaryOp* node) override {
+        add(node->op_type);
+        return addNode(node);
+    }
+
+    // The CFG's edges:
+    bool visit_branch(AST_Branch* node) override {
+        add(node->iftrue->idx);
+        add(node->iffalse->idx);
+        return addNode(node);
+    }
+    bool visit_jump(AST_Jump* node) override {
+        add(node->target->idx);
+        return addNode(node);
+    }
+};
+
+class BaselineJITCache {
+private:
+    struct Record {
+        int last_used; // generation of the last run that ran this function
+        std::vector<int> jitted, aborted;
+    };
+
+    // Functions that haven't been run in this many saves get dropped from the file:
+    static constexpr int max_unused_generations = 32;
+
+    llvm::SmallString<128> path;
+    bool loaded;
+    int generation;
+    std::unordered_map<uint64_t, Record> records;
+    // Every function we looked up in this run:
+    llvm::DenseMap<SourceInfo*, uint64_t> seen;
+
+    static uint64_t hashFunction(SourceInfo* source) {
+        FunctionHasher hasher;
+        hasher.add(source->fn);
+        hasher.add(source->getName());
+        for (CFGBlock* block : source->cfg->blocks) {
+            hasher.add(block->body.size());
+            for (AST_stmt* stmt : block->body)
+                stmt->accept(&hasher);
+        }
+        return hasher.hash;
+    }
+
+    void load() {
+        loaded = true;
+        generation = 0;
+        records.clear();
+
+        FILE* f = fopen(path.c_str(), "r");
+        if (!f)
+            return;
+
+        int version;
+        if (fscanf(f, "pyston_baseline_jit_cache %d %d\n", &version, &generation) != 2 || version != 2) {
+            generation = 0;
+            fclose(f);
+            return;
+        }
+
+        while (true) {
+            uint64_t key;
+            Record r;
+            int num_jitted, num_aborted, idx;
+            if (fscanf(f, "%lx %d %d", &key, &r.last_used, &num_jitted) != 3)
+                break;
+            for (int i = 0; i < num_jitted && fscanf(f, "%d", &idx) == 1; i++)
+                r.jitted.push_back(idx);
+            if (fscanf(f, "%d", &num_aborted) != 1)
+                break;
+            for (int i = 0; i < num_aborted && fscanf(f, "%d", &idx) == 1; i++)
+                r.aborted.push_back(idx);
+            records[key] = std::move(r);
+        }
+        fclose(f);
+    }
+
+public:
+    BaselineJITCache() : loaded(false), generation(0) {
+        llvm::sys::path::home_directory(path);
+        llvm::sys::path::append(path, ".cache");
+        llvm::sys::path::append(path, "pyston");
+        llvm::sys::path::append(path, "baseline_jit_cache");
+    }
+
+    void lookup(SourceInfo* source) {
+        if (seen.count(source))
+            return;
+
+        if (!loaded)
+            load();
+
+        uint64_t key = hashFunction(source);
+        seen[source] = key;
+
+        auto it = records.find(key);
+        if (it == records.end())
+            return;
+
+        static StatCounter sc_hits("num_baselinejit_cache_hits");
+        sc_hits.log();
+        static StatCounter sc_blocks("num_baselinejit_cache_eager_blocks");
+
+        auto& blocks = source->cfg->blocks;
+        for (int idx : it->second.jitted) {
+            if (idx >= 0 && idx < blocks.size()) {
+                blocks_jitted_previously.insert(blocks[idx]);
+                sc_blocks.log();
+            }
+        }
+        for (int idx : it->second.aborted) {
+            if (idx >= 0 && idx < blocks.size())
+                blocks_aborted.insert(blocks[idx]);
+        }
+    }
+
+    void save() {
+        if (seen.empty())
+            return;
+
+        // Other processes might have saved their results since we read the file; start from what's there now.
+        // If two processes save at the same time, one of them loses, which just means a bit more warmup next time.
+        load();
+        generation++;
+
+        for (auto& p : seen) {
+            Record& r = records[p.second];
+            std::set<int> jitted(r.jitted.begin(), r.jitted.end());
+            std::set<int> aborted(r.aborted.begin(), r.aborted.end());
+            for (CFGBlock* block : p.first->cfg->blocks) {
+                if (block->code)
+                    jitted.insert(block->idx);
+                if (blocks_aborted.count(block))
+                    aborted.insert(block->idx);
+            }
+            for (int idx : aborted)
+                jitted.erase(idx);
+
+            r.last_used = generation;
+            r.jitted.assign(jitted.begin(), jitted.end());
+            r.aborted.assign(aborted.begin(), aborted.end());
+        }
+
+        llvm::SmallString<128> dir = path;
+        llvm::sys::path::remove_filename(dir);
+        if (!llvm::sys::fs::exists(dir.str()) && llvm::sys::fs::create_directories(dir.str()))
+            return;
+
+        // Write to a temporary file and rename it into place, so that nobody sees a partially-written file:
+        std::string tmp_path = (path + "." + std::to_string(getpid())).str();
+        FILE* f = fopen(tmp_path.c_str(), "w");
+        if (!f)
+            return;
+
+        fprintf(f, "pyston_baseline_jit_cache 2 %d\n", generation);
+        for (auto& p : records) {
+            const Record& r = p.second;
+            if (r.last_used + max_unused_generations < generation)
+                continue;
+            if (r.jitted.empty() && r.aborted.empty())
+                continue;
+
+            fprintf(f, "%lx %d %ld", p.first, r.last_used, r.jitted.size());
+            for (int idx : r.jitted)
+                fprintf(f, " %d", idx);
+            fprintf(f, " %ld", r.aborted.size());
+            for (int idx : r.aborted)
+                fprintf(f, " %d", idx);
+            fprintf(f, "\n");
+        }
+
+        bool failed = ferror(f);
+        fclose(f);
+        if (failed || rename(tmp_path.c_str(), path.c_str()) != 0)
+            remove(tmp_path.c_str());
+    }
+};
+
+BaselineJITCache& baselineJITCache() {
+    static BaselineJITCache* cache = new BaselineJITCache();
+    return *cache;
+}
+}
+
+void loadBaselineJITCacheEntry(SourceInfo* source) {
+    assert(ENABLE_BASELINEJIT_CACHE);
+    baselineJITCache().lookup(source);
+}
+
+bool wasBaselineJITedPreviously(CFGBlock* block) {
+    return blocks_jitted_previously.count(block);
+}
+
+void saveBaselineJITCache() {
+    baselineJITCache().save();
+}
 }
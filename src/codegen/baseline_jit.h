@@ -31,6 +31,7 @@ class Box;
 class BoxedDict;
 class BoxedList;
 class BoxedTuple;
+class SourceInfo;
 
 class TypeRecorder;
 
@@ -178,6 +179,10 @@ private:
     RewriterVar* interp;
     RewriterVar* vregs_array;
     llvm::DenseMap<InternedString, RewriterVar*> local_syms;
+    // The values of the vregs that this fragment has already loaded or stored, so that later uses in the same
+    // fragment don't have to load them again.  We still store every assignment to the vregs array, since the
+    // interpreter, the next fragment and frame introspection all read them from there.
+    llvm::DenseMap<int, RewriterVar*> known_vregs;
     std::unique_ptr<ICInfo> ic_info;
 
     // Optional points to a CFGBlock and a patch location which should get patched to a direct jump if
@@ -204,11 +209,11 @@ public:
     RewriterVar* imm(void* val);
 
 
-    RewriterVar* emitAugbinop(RewriterVar* lhs, RewriterVar* rhs, int op_type);
-    RewriterVar* emitBinop(RewriterVar* lhs, RewriterVar* rhs, int op_type);
+    RewriterVar* emitAugbinop(Value lhs, Value rhs, int op_type);
+    RewriterVar* emitBinop(Value lhs, Value rhs, int op_type);
     RewriterVar* emitCallattr(AST_expr* node, RewriterVar* obj, BoxedString* attr, CallattrFlags flags,
                               const llvm::ArrayRef<RewriterVar*> args, std::vector<BoxedString*>* keyword_names);
-    RewriterVar* emitCompare(RewriterVar* lhs, RewriterVar* rhs, int op_type);
+    RewriterVar* emitCompare(Value lhs, Value rhs, int op_type);
     RewriterVar* emitCreateDict(const llvm::ArrayRef<RewriterVar*> keys, const llvm::ArrayRef<RewriterVar*> values);
     RewriterVar* emitCreateList(const llvm::ArrayRef<RewriterVar*> values);
     RewriterVar* emitCreateSet(const llvm::ArrayRef<RewriterVar*> values);
@@ -269,7 +274,8 @@ private:
     RewriterVar* getInterp();
 
     RewriterVar* emitPPCall(void* func_addr, llvm::ArrayRef<RewriterVar*> args, int num_slots, int slot_size,
-                            TypeRecorder* type_recorder = NULL);
+                            TypeRecorder* type_recorder = NULL, BoxedClass* fast_path_cls = NULL,
+                            int fast_path_op = 0);
 
     static void assertNameDefinedHelper(const char* id);
     static Box* callattrHelper(Box* obj, BoxedString* attr, CallattrFlags flags, TypeRecorder* type_recorder,
@@ -285,14 +291,25 @@ private:
     static Box* runtimeCallHelper(Box* obj, ArgPassSpec argspec, TypeRecorder* type_recorder, Box** args,
                                   std::vector<BoxedString*>* keyword_names);
 
+    void _emitBlockCount();
     void _emitGetLocal(RewriterVar* val_var, const char* name);
     void _emitJump(CFGBlock* b, RewriterVar* block_next, int& size_of_exit_to_interp);
     void _emitOSRPoint(RewriterVar* result, RewriterVar* node_var);
+    void _emitNumericFastPath(BoxedClass* cls, int op_type, int slowpath_size);
     void _emitPPCall(RewriterVar* result, void* func_addr, const RewriterVar::SmallVector& args, int num_slots,
-                     int slot_size);
+                     int slot_size, BoxedClass* fast_path_cls, int fast_path_op);
     void _emitReturn(RewriterVar* v);
     void _emitSideExit(RewriterVar* var, RewriterVar* val_constant, CFGBlock* next_block, RewriterVar* false_path);
 };
+
+// With ENABLE_BASELINEJIT_CACHE, we remember which blocks the baseline jit compiled in previous runs, and compile
+// them the first time they get executed instead of waiting for them to get hot again.
+//
+// Reads what the previous runs did with this function; cheap after the first call.
+void loadBaselineJITCacheEntry(SourceInfo* source);
+bool wasBaselineJITedPreviously(CFGBlock* block);
+// Merges what the baseline jit did in this run into the cache file.
+void saveBaselineJITCache();
 }
 
 #endif
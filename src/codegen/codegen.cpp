@@ -43,7 +43,8 @@ CLFunction::CLFunction(int num_args, int num_defaults, bool takes_varargs, bool
       param_names(this->source->ast, this->source->getInternedStrings()),
       always_use_version(NULL),
       code_obj(NULL),
-      times_interpreted(0) {
+      times_interpreted(0),
+      compile_queued(false) {
     assert(num_args >= num_defaults);
 }
 CLFunction::CLFunction(int num_args, int num_defaults, bool takes_varargs, bool takes_kwargs,
@@ -53,7 +54,8 @@ CLFunction::CLFunction(int num_args, int num_defaults, bool takes_varargs, bool
       param_names(param_names),
       always_use_version(NULL),
       code_obj(NULL),
-      times_interpreted(0) {
+      times_interpreted(0),
+      compile_queued(false) {
     assert(num_args >= num_defaults);
 }
 
@@ -92,6 +94,7 @@ SourceInfo::~SourceInfo() {
 void FunctionAddressRegistry::registerFunction(const std::string& name, void* addr, int length,
                                                llvm::Function* llvm_func) {
     assert(addr);
+    LOCK_REGION(&lock);
     assert(functions.count(addr) == 0);
     functions.insert(std::make_pair(addr, FuncInfo(name, length, llvm_func)));
 }
@@ -109,6 +112,7 @@ void FunctionAddressRegistry::dumpPerfMap() {
     char buf[80];
     snprintf(buf, 80, "/tmp/perf-%d.map", getpid());
     FILE* f = fopen(buf, "w");
+    LOCK_REGION(&lock);
     for (const auto& p : functions) {
         const FuncInfo& info = p.second;
         fprintf(f, "%lx %x %s\n", (uintptr_t)p.first, info.length, info.name.c_str());
@@ -127,29 +131,27 @@ void FunctionAddressRegistry::dumpPerfMap() {
 }
 
 llvm::Function* FunctionAddressRegistry::getLLVMFuncAtAddress(void* addr) {
-    FuncMap::iterator it = functions.find(addr);
-    if (it == functions.end()) {
+    {
+        LOCK_REGION(&lock);
+        FuncMap::iterator it = functions.find(addr);
+        if (it != functions.end())
+            return it->second.llvm_func;
         if (lookup_neg_cache.count(addr))
             return NULL;
+    }
 
-        bool success;
-        std::string name = getFuncNameAtAddress(addr, false, &success);
-        if (!success) {
-            lookup_neg_cache.insert(addr);
-            return NULL;
-        }
-
-        llvm::Function* r = g.stdlib_module->getFunction(name);
-
-        if (!r) {
-            lookup_neg_cache.insert(addr);
-            return NULL;
-        }
+    bool success;
+    std::string name = getFuncNameAtAddress(addr, false, &success);
+    llvm::Function* r = success ? g.stdlib_module->getFunction(name) : NULL;
 
-        registerFunction(name, addr, 0, r);
-        return r;
+    if (!r) {
+        LOCK_REGION(&lock);
+        lookup_neg_cache.insert(addr);
+        return NULL;
     }
-    return it->second.llvm_func;
+
+    registerFunction(name, addr, 0, r);
+    return r;
 }
 
 static std::string tryDemangle(const char* s) {
@@ -164,8 +166,17 @@ static std::string tryDemangle(const char* s) {
 }
 
 std::string FunctionAddressRegistry::getFuncNameAtAddress(void* addr, bool demangle, bool* out_success) {
-    FuncMap::iterator it = functions.find(addr);
-    if (it == functions.end()) {
+    std::string name;
+    bool found;
+    {
+        LOCK_REGION(&lock);
+        FuncMap::iterator it = functions.find(addr);
+        found = (it != functions.end());
+        if (found)
+            name = it->second.name;
+    }
+
+    if (!found) {
         Dl_info info;
         int success = dladdr(addr, &info);
 
@@ -187,9 +198,9 @@ std::string FunctionAddressRegistry::getFuncNameAtAddress(void* addr, bool deman
     if (out_success)
         *out_success = true;
     if (!demangle)
-        return it->second.name;
+        return name;
 
-    return tryDemangle(it->second.name.c_str());
+    return tryDemangle(name.c_str());
 }
 
 class RegistryEventListener : public llvm::JITEventListener {
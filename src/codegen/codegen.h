@@ -44,6 +44,9 @@ private:
     FuncMap functions;
     std::unordered_set<void*> lookup_neg_cache;
 
+    // The background compile thread registers functions without holding the GIL:
+    threading::PthreadFastMutex lock;
+
 public:
     std::string getFuncNameAtAddress(void* addr, bool demangle, bool* out_success = NULL);
     llvm::Function* getLLVMFuncAtAddress(void* addr);
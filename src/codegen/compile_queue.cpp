@@ -0,0 +1,250 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codegen/compile_queue.h"
+
+#include <algorithm>
+#include <deque>
+#include <pthread.h>
+
+#include "codegen/irgen/hooks.h"
+#include "codegen/osrentry.h"
+#include "core/common.h"
+#include "core/options.h"
+#include "core/stats.h"
+#include "core/threading.h"
+#include "core/util.h"
+
+namespace pyston {
+
+namespace {
+struct CompileRequest {
+    CLFunction* clfunc;
+    EffortLevel effort;
+
+    // Exactly one of these is set:
+    FunctionSpecialization* spec;    // a new version of the function with this signature
+    const OSREntryDescriptor* entry; // an OSR entry
+    CompiledFunction* reopt_cf;      // a more optimized replacement for this version
+
+    uint64_t queued_at; // in cpu ticks
+};
+}
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static std::deque<CompileRequest> queue;
+static bool compile_thread_started = false;
+
+static pthread_mutex_t llvm_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread bool is_compile_thread = false;
+
+static void acquireLLVMLock() {
+    if (pthread_mutex_trylock(&llvm_lock) == 0)
+        return;
+
+    // The compile thread has the lock, and it might need the GIL back before it can give it up:
+    static StatCounter sc_waits("num_llvm_lock_waits");
+    sc_waits.log();
+    threading::GLAllowThreadsReadRegion _allow;
+    pthread_mutex_lock(&llvm_lock);
+}
+
+static void releaseLLVMLock() {
+    pthread_mutex_unlock(&llvm_lock);
+}
+
+LLVMLockRegion::LLVMLockRegion() {
+    acquireLLVMLock();
+}
+
+LLVMLockRegion::~LLVMLockRegion() {
+    releaseLLVMLock();
+}
+
+BackgroundCompileAllowThreadsRegion::BackgroundCompileAllowThreadsRegion() : released(is_compile_thread) {
+    if (released)
+        threading::beginAllowThreads();
+}
+
+BackgroundCompileAllowThreadsRegion::~BackgroundCompileAllowThreadsRegion() {
+    if (released)
+        threading::endAllowThreads();
+}
+
+static void runRequest(const CompileRequest& req) {
+    CLFunction* clfunc = req.clfunc;
+
+    if (req.spec) {
+        assert(clfunc->compile_queued);
+        compileFunction(clfunc, req.spec, req.effort, NULL);
+        clfunc->compile_queued = false;
+        // Calls that got rewritten to go to the interpreter should pick up the new version:
+        clfunc->dependent_interp_callsites.invalidateAll();
+    } else if (req.entry) {
+        assert(clfunc->osr_versions.count(req.entry));
+        compileFunction(clfunc, NULL, req.effort, req.entry);
+    } else {
+        CompiledFunction* cf = req.reopt_cf;
+        assert(cf->reopt_queued);
+
+        // The version might have been thrown out (for failing its speculations) while it was waiting:
+        auto& versions = clfunc->versions;
+        if (std::find(versions.begin(), versions.end(), cf) == versions.end()) {
+            static StatCounter sc_dropped("num_background_compiles_dropped");
+            sc_dropped.log();
+            return;
+        }
+        _doReopt(cf, req.effort);
+    }
+
+    static StatCounter sc_compiles("num_background_compiles");
+    sc_compiles.log();
+    static StatCounter sc_us("us_background_compile_time_to_install");
+    sc_us.log((getCPUTicks() - req.queued_at) / Stats::estimateCPUFreq());
+}
+
+static void* compileThreadMain(Box*, Box*, Box*) {
+    // We start out holding the GIL, like any other thread.
+    is_compile_thread = true;
+
+    while (true) {
+        CompileRequest req;
+        {
+            threading::GLAllowThreadsReadRegion _allow;
+
+            pthread_mutex_lock(&queue_lock);
+            while (queue.empty())
+                pthread_cond_wait(&queue_cond, &queue_lock);
+            req = queue.front();
+            queue.pop_front();
+            pthread_mutex_unlock(&queue_lock);
+        }
+
+        runRequest(req);
+    }
+}
+
+// Make sure that a fork doesn't happen in the middle of a background compile, since the child wouldn't be able
+// to use LLVM afterwards.  This assumes that fork() gets called while holding the GIL, which is what os.fork does.
+static void prepareForFork() {
+    if (compile_thread_started)
+        acquireLLVMLock();
+}
+
+static void afterForkInParent() {
+    if (compile_thread_started)
+        releaseLLVMLock();
+}
+
+static void afterForkInChild() {
+    if (!compile_thread_started)
+        return;
+
+    // The compile thread doesn't exist in the child; forget about the requests it had, so that the functions
+    // can get queued up again (and start up a new thread).
+    for (const CompileRequest& req : queue) {
+        if (req.spec)
+            req.clfunc->compile_queued = false;
+        else if (req.entry)
+            req.clfunc->osr_versions.erase(req.entry);
+        else
+            req.reopt_cf->reopt_queued = false;
+    }
+    queue.clear();
+    compile_thread_started = false;
+
+    pthread_mutex_init(&queue_lock, NULL);
+    pthread_cond_init(&queue_cond, NULL);
+    pthread_mutex_init(&llvm_lock, NULL);
+}
+
+static void enqueue(const CompileRequest& req) {
+    static StatCounter sc_queued("num_background_compiles_queued");
+    sc_queued.log();
+
+    if (!compile_thread_started) {
+        static bool registered_fork_handlers = false;
+        if (!registered_fork_handlers) {
+            pthread_atfork(prepareForFork, afterForkInParent, afterForkInChild);
+            registered_fork_handlers = true;
+        }
+
+        compile_thread_started = true;
+        threading::start_thread(&compileThreadMain, NULL, NULL, NULL);
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    queue.push_back(req);
+
+    // Summed over all the requests; divide by num_background_compiles_queued to get the average depth:
+    static StatCounter sc_depth("background_compile_queue_depth");
+    sc_depth.log(queue.size());
+
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+void enqueueCompile(CLFunction* clfunc, FunctionSpecialization* spec, EffortLevel effort) {
+    if (clfunc->compile_queued) {
+        delete spec;
+        return;
+    }
+
+    clfunc->compile_queued = true;
+    enqueue(CompileRequest({.clfunc = clfunc,
+                            .effort = effort,
+                            .spec = spec,
+                            .entry = NULL,
+                            .reopt_cf = NULL,
+                            .queued_at = getCPUTicks() }));
+}
+
+void enqueueOSRCompile(const OSREntryDescriptor* entry) {
+    CLFunction* clfunc = entry->clfunc;
+    if (clfunc->osr_versions.count(entry))
+        return;
+
+    // A NULL version means that the compile is still pending.
+    clfunc->osr_versions[entry] = NULL;
+    enqueue(CompileRequest({.clfunc = clfunc,
+                            .effort = EffortLevel::MAXIMAL,
+                            .spec = NULL,
+                            .entry = entry,
+                            .reopt_cf = NULL,
+                            .queued_at = getCPUTicks() }));
+}
+
+void enqueueReopt(CompiledFunction* cf) {
+    if (cf->reopt_queued)
+        return;
+
+    cf->reopt_queued = true;
+    enqueue(CompileRequest({.clfunc = cf->clfunc,
+                            .effort = EffortLevel::MAXIMAL,
+                            .spec = NULL,
+                            .entry = NULL,
+                            .reopt_cf = cf,
+                            .queued_at = getCPUTicks() }));
+}
+
+void stopBackgroundCompiles() {
+    if (!compile_thread_started)
+        return;
+
+    // The compile thread holds the lock for the whole time it's compiling something, so once we have it, the
+    // thread is idle, and it will stay that way:
+    acquireLLVMLock();
+}
+}
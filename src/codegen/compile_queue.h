@@ -0,0 +1,61 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_CODEGEN_COMPILEQUEUE_H
+#define PYSTON_CODEGEN_COMPILEQUEUE_H
+
+#include "core/types.h"
+
+namespace pyston {
+
+class OSREntryDescriptor;
+
+// With ENABLE_BACKGROUND_COMPILE, tiering up into the LLVM tier doesn't stop the thread that crossed the
+// threshold: the compile gets queued up for a separate compile thread, and the function keeps running in the
+// interpreter / baseline jit until the new version gets installed.  Installing happens while holding the GIL, so
+// the new version becomes visible all at once, to the next call (or the next OSR check for OSR compiles).
+//
+// The compile thread holds the GIL for the parts of the compile that look at Python-level state (irgen and
+// installing the result), and releases it while LLVM optimizes the IR and generates machine code, which is where
+// the time goes.
+
+// These all return immediately; requests for something that is already in the queue are ignored.
+void enqueueCompile(CLFunction* clfunc, FunctionSpecialization* spec, EffortLevel effort);
+void enqueueOSRCompile(const OSREntryDescriptor* entry);
+void enqueueReopt(CompiledFunction* cf);
+
+// Waits for the compile thread to finish what it's doing, and keeps it from starting anything new.
+void stopBackgroundCompiles();
+
+// LLVM isn't thread-safe, so everything that uses it (ie compileFunction) needs to hold this lock.  If the
+// compile thread has it, this waits with the GIL released.
+class LLVMLockRegion {
+public:
+    LLVMLockRegion();
+    ~LLVMLockRegion();
+};
+
+// Releases the GIL if this is the compile thread; for use around the parts of compileFunction that only
+// touch LLVM's data structures.
+class BackgroundCompileAllowThreadsRegion {
+private:
+    bool released;
+
+public:
+    BackgroundCompileAllowThreadsRegion();
+    ~BackgroundCompileAllowThreadsRegion();
+};
+}
+
+#endif
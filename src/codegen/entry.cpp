@@ -16,7 +16,6 @@
 
 #include <cstdio>
 #include <iostream>
-#include <lz4frame.h>
 #include <openssl/evp.h>
 #include <unordered_map>
 
@@ -38,8 +37,11 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 
+#include "codegen/baseline_jit.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/memmgr.h"
+#include "codegen/object_cache.h"
 #include "codegen/profiling/profiling.h"
 #include "codegen/stackmaps.h"
 #include "core/options.h"
@@ -121,87 +123,6 @@ static llvm::Module* loadStdlib() {
     return m;
 }
 
-class CompressedFile {
-public:
-    static bool writeFile(llvm::StringRef file_name, llvm::StringRef data) {
-        std::error_code error_code;
-        llvm::raw_fd_ostream file(file_name, error_code, llvm::sys::fs::F_RW);
-        if (error_code)
-            return false;
-
-        int uncompressed_size = data.size();
-        // Write the uncompressed size to the beginning of the file as a simple checksum.
-        // It looks like each lz4 block has its own data checksum, but we need to also
-        // make sure that we have all the blocks that we expected.
-        // In particular, without this, an empty file seems to be a valid lz4 stream.
-        file.write(reinterpret_cast<const char*>(&uncompressed_size), 4);
-
-        LZ4F_preferences_t preferences;
-        memset(&preferences, 0, sizeof(preferences));
-        preferences.frameInfo.contentChecksumFlag = contentChecksumEnabled;
-        preferences.frameInfo.contentSize = data.size();
-
-        std::vector<char> compressed;
-        size_t max_size = LZ4F_compressFrameBound(data.size(), &preferences);
-        compressed.resize(max_size);
-        size_t compressed_size = LZ4F_compressFrame(&compressed[0], max_size, data.data(), data.size(), &preferences);
-        if (LZ4F_isError(compressed_size))
-            return false;
-        file.write(compressed.data(), compressed_size);
-        return true;
-    }
-
-    static std::unique_ptr<llvm::MemoryBuffer> getFile(llvm::StringRef file_name) {
-        auto compressed_content = llvm::MemoryBuffer::getFile(file_name, -1, false);
-        if (!compressed_content)
-            return std::unique_ptr<llvm::MemoryBuffer>();
-
-        LZ4F_decompressionContext_t context;
-        LZ4F_createDecompressionContext(&context, LZ4F_VERSION);
-
-        LZ4F_frameInfo_t frame_info;
-        memset(&frame_info, 0, sizeof(frame_info));
-
-        const char* start = (*compressed_content)->getBufferStart();
-        size_t pos = 0;
-        size_t compressed_size = (*compressed_content)->getBufferSize();
-        if (compressed_size < 4)
-            return std::unique_ptr<llvm::MemoryBuffer>();
-
-        int orig_uncompressed_size = *reinterpret_cast<const int*>(start);
-        pos += 4;
-
-        size_t remaining = compressed_size - pos;
-        LZ4F_getFrameInfo(context, &frame_info, start + pos, &remaining);
-        pos += remaining;
-
-        std::vector<char> uncompressed;
-        uncompressed.reserve(frame_info.contentSize);
-        while (pos < compressed_size) {
-            unsigned char buff[4096];
-            size_t buff_size = sizeof(buff);
-            remaining = compressed_size - pos;
-            size_t error_code = LZ4F_decompress(context, buff, &buff_size, start + pos, &remaining, NULL);
-            if (LZ4F_isError(error_code)) {
-                LZ4F_freeDecompressionContext(context);
-                return std::unique_ptr<llvm::MemoryBuffer>();
-            }
-            pos += remaining;
-            if (buff_size != 0)
-                uncompressed.insert(uncompressed.end(), buff, buff + buff_size);
-        }
-
-        LZ4F_freeDecompressionContext(context);
-        if (uncompressed.size() != frame_info.contentSize)
-            return std::unique_ptr<llvm::MemoryBuffer>();
-
-        if (uncompressed.size() != orig_uncompressed_size)
-            return std::unique_ptr<llvm::MemoryBuffer>();
-
-        return llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(uncompressed.data(), uncompressed.size()));
-    }
-};
-
 class PystonObjectCache : public llvm::ObjectCache {
 private:
     // Stream which calculates the SHA256 hash of the data writen to.
@@ -237,6 +158,7 @@ private:
     };
 
     llvm::SmallString<128> cache_dir;
+    std::unique_ptr<ObjectCachePackFile> pack_file;
     std::string module_identifier;
     std::string hash_before_codegen;
 
@@ -245,9 +167,10 @@ public:
         llvm::sys::path::home_directory(cache_dir);
         llvm::sys::path::append(cache_dir, ".cache");
         llvm::sys::path::append(cache_dir, "pyston");
-        llvm::sys::path::append(cache_dir, "object_cache");
 
-        cleanupCacheDirectory();
+        llvm::SmallString<128> pack_path = cache_dir;
+        llvm::sys::path::append(pack_path, "object_cache.pack");
+        pack_file.reset(new ObjectCachePackFile(pack_path));
     }
 
 
@@ -260,12 +183,7 @@ public:
         RELEASE_ASSERT(module_identifier == M->getModuleIdentifier(), "");
         RELEASE_ASSERT(!hash_before_codegen.empty(), "");
 
-        llvm::SmallString<128> cache_file = cache_dir;
-        llvm::sys::path::append(cache_file, hash_before_codegen);
-        if (!llvm::sys::fs::exists(cache_dir.str()) && llvm::sys::fs::create_directories(cache_dir.str()))
-            return;
-
-        CompressedFile::writeFile(cache_file, Obj.getBuffer());
+        pack_file->add(hash_before_codegen, Obj.getBuffer());
     }
 
 #if LLVMREV < 215566
@@ -284,9 +202,8 @@ public:
         llvm::WriteBitcodeToFile(M, hash_stream);
         hash_before_codegen = hash_stream.getHash();
 
-        llvm::SmallString<128> cache_file = cache_dir;
-        llvm::sys::path::append(cache_file, hash_before_codegen);
-        if (!llvm::sys::fs::exists(cache_file.str())) {
+        std::unique_ptr<llvm::MemoryBuffer> mem_buff = pack_file->get(hash_before_codegen);
+        if (!mem_buff) {
 #if 0
             // This code helps with identifying why we got a cache miss for a file.
             // - clear the cache directory
@@ -313,41 +230,9 @@ public:
             return NULL;
         }
 
-        std::unique_ptr<llvm::MemoryBuffer> mem_buff = CompressedFile::getFile(cache_file);
-        if (!mem_buff) {
-            jit_objectcache_misses.log();
-            return NULL;
-        }
-
         jit_objectcache_hits.log();
         return mem_buff;
     }
-
-    void cleanupCacheDirectory() {
-        // Find all files inside the cache directory, if the number of files is larger than
-        // MAX_OBJECT_CACHE_ENTRIES,
-        // sort them by last modification time and remove the oldest excessive ones.
-        typedef std::pair<std::string, llvm::sys::TimeValue> CacheFileEntry;
-        std::vector<CacheFileEntry> cache_files;
-
-        std::error_code ec;
-        for (llvm::sys::fs::directory_iterator file(cache_dir.str(), ec), end; !ec && file != end; file.increment(ec)) {
-            llvm::sys::fs::file_status status;
-            if (file->status(status))
-                continue; // ignore files where we can't retrieve the file status.
-            cache_files.emplace_back(std::make_pair(file->path(), status.getLastModificationTime()));
-        }
-
-        int num_expired = cache_files.size() - MAX_OBJECT_CACHE_ENTRIES;
-        if (num_expired <= 0)
-            return;
-
-        std::stable_sort(cache_files.begin(), cache_files.end(),
-                         [](const CacheFileEntry& lhs, const CacheFileEntry& rhs) { return lhs.second < rhs.second; });
-
-        for (int i = 0; i < num_expired; ++i)
-            llvm::sys::fs::remove(cache_files[i].first);
-    }
 };
 
 static void handle_sigusr1(int signum) {
@@ -541,6 +426,9 @@ int joinRuntime() {
     // In the future this will have to wait for non-daemon
     // threads to finish
 
+    stopBackgroundCompiles();
+    saveBaselineJITCache();
+
     if (PROFILE)
         g.func_addr_registry.dumpPerfMap();
 
@@ -39,6 +39,7 @@
 #include "analysis/scoping_analysis.h"
 #include "analysis/type_analysis.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/compvars.h"
 #include "codegen/gcbuilder.h"
 #include "codegen/irgen/irgenerator.h"
@@ -1094,8 +1095,11 @@ CompiledFunction* doCompile(CLFunction* clfunc, SourceInfo* source, ParamNames*
     static StatCounter us_irgen("us_compiling_irgen");
     us_irgen.log(irgen_us);
 
-    if (ENABLE_LLVMOPTS)
+    if (ENABLE_LLVMOPTS) {
+        // The passes only look at the IR (and at constant classes), so other threads can keep going:
+        BackgroundCompileAllowThreadsRegion _allow;
         optimizeIR(f, effort);
+    }
 
     g.cur_module = NULL;
 
@@ -14,6 +14,8 @@
 
 #include "codegen/irgen/hooks.h"
 
+#include <algorithm>
+
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -23,6 +25,7 @@
 #include "codegen/ast_interpreter.h"
 #include "codegen/baseline_jit.h"
 #include "codegen/codegen.h"
+#include "codegen/compile_queue.h"
 #include "codegen/compvars.h"
 #include "codegen/irgen.h"
 #include "codegen/irgen/future.h"
@@ -145,18 +148,25 @@ static void compileIR(CompiledFunction* cf, EffortLevel effort) {
 
     {
         Timer _t("to jit the IR");
+
+        g.cur_cf = cf;
+        {
+            BackgroundCompileAllowThreadsRegion _allow;
 #if LLVMREV < 215967
-        g.engine->addModule(cf->func->getParent());
+            g.engine->addModule(cf->func->getParent());
 #else
-        g.engine->addModule(std::unique_ptr<llvm::Module>(cf->func->getParent()));
+            g.engine->addModule(std::unique_ptr<llvm::Module>(cf->func->getParent()));
 #endif
-
-        g.cur_cf = cf;
-        void* compiled = (void*)g.engine->getFunctionAddress(cf->func->getName());
+            compiled = (void*)g.engine->getFunctionAddress(cf->func->getName());
+        }
         g.cur_cf = NULL;
         assert(compiled);
         ASSERT(compiled == cf->code, "cf->code should have gotten filled in");
 
+        // Other threads can look through the registry at any time (to unwind their stacks), so this has to
+        // happen while holding the GIL:
+        registerCompiledFunction(cf);
+
         long us = _t.end();
         static StatCounter us_jitting("us_compiling_jitting");
         us_jitting.log(us);
@@ -188,6 +198,15 @@ CompiledFunction* compileFunction(CLFunction* f, FunctionSpecialization* spec, E
 
     assert((entry_descriptor != NULL) + (spec != NULL) == 1);
 
+    LLVMLockRegion _llvm_lock;
+
+    if (entry_descriptor) {
+        // Another thread might have done this compile while we were waiting for the lock:
+        auto it = f->osr_versions.find(entry_descriptor);
+        if (it != f->osr_versions.end() && it->second)
+            return it->second;
+    }
+
     SourceInfo* source = f->source.get();
     assert(source);
 
@@ -725,6 +744,7 @@ CompiledFunction::CompiledFunction(llvm::Function* func, FunctionSpecialization*
       effort(effort),
       times_called(0),
       times_speculation_failed(0),
+      reopt_queued(false),
       location_map(nullptr) {
     assert((spec != NULL) + (entry_descriptor != NULL) == 1);
 }
@@ -740,7 +760,7 @@ ConcreteCompilerType* CompiledFunction::getReturnType() {
 /// Reoptimizes the given function version at the new effort level.
 /// The cf must be an active version in its parents CLFunction; the given
 /// version will be replaced by the new version, which will be returned.
-static CompiledFunction* _doReopt(CompiledFunction* cf, EffortLevel new_effort) {
+CompiledFunction* _doReopt(CompiledFunction* cf, EffortLevel new_effort) {
     LOCK_REGION(codegen_rwlock.asWrite());
 
     assert(cf->clfunc->versions.size());
@@ -757,13 +777,21 @@ static CompiledFunction* _doReopt(CompiledFunction* cf, EffortLevel new_effort)
     FunctionList& versions = clfunc->versions;
     for (int i = 0; i < versions.size(); i++) {
         if (versions[i] == cf) {
-            versions.erase(versions.begin() + i);
-
             CompiledFunction* new_cf
                 = compileFunction(clfunc, cf->spec, new_effort,
                                   NULL); // this pushes the new CompiledVersion to the back of the version list
 
-            cf->dependent_callsites.invalidateAll();
+            // Only remove the old version once the new one is there, since other threads can run while
+            // compileFunction waits for the LLVM lock.  One of them might have thrown the old version out already
+            // (see speculationFailed), in which case there's nothing left to do.
+            auto it = std::find(versions.begin(), versions.end(), cf);
+            if (it == versions.end()) {
+                static StatCounter sc_gone("num_reopts_of_removed_versions");
+                sc_gone.log();
+            } else {
+                versions.erase(it);
+                cf->dependent_callsites.invalidateAll();
+            }
 
             return new_cf;
         }
@@ -808,6 +836,14 @@ void* compilePartialFunc(OSRExit* exit) {
 
 static StatCounter stat_reopt("reopts");
 extern "C" CompiledFunction* reoptCompiledFuncInternal(CompiledFunction* cf) {
+    if (ENABLE_BACKGROUND_COMPILE) {
+        // Keep using this version until the new one is ready.  Since our caller is about to call back into
+        // this version, reset the call count so that it doesn't come right back here:
+        enqueueReopt(cf);
+        cf->times_called = 0;
+        return cf;
+    }
+
     if (VERBOSITY("irgen") >= 2)
         printf("In reoptCompiledFunc, %p, %ld\n", cf, cf->times_called);
     stat_reopt.log();
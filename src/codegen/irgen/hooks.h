@@ -30,6 +30,8 @@ class BoxedDict;
 CompiledFunction* compilePartialFuncInternal(OSRExit* exit);
 void* compilePartialFunc(OSRExit*);
 extern "C" CompiledFunction* reoptCompiledFuncInternal(CompiledFunction*);
+// Replaces the given version with one compiled at the new effort level, and returns the new version.
+CompiledFunction* _doReopt(CompiledFunction* cf, EffortLevel new_effort);
 extern "C" char* reoptCompiledFunc(CompiledFunction*);
 
 class AST_Module;
@@ -14,6 +14,7 @@
 
 #include "codegen/irgen/irgenerator.h"
 
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -2002,9 +2003,20 @@ private:
         llvm::BasicBlock* iftrue = entry_blocks[node->iftrue];
         llvm::BasicBlock* iffalse = entry_blocks[node->iffalse];
 
+        // If the baseline jit counted how often the targets ran, tell llvm which way this branch usually goes, so that
+        // the path the function has been taking gets laid out straight and the rarely- or never-taken side gets moved
+        // out of line.  The counts are per block, so for targets with other predecessors they are only an estimate.
+        llvm::MDNode* branch_weights = NULL;
+        if (ENABLE_BLOCK_COUNTS && (node->iftrue->bjit_count || node->iffalse->bjit_count)) {
+            // Branch weights are 32 bits; the +1 keeps a side that never ran from getting a weight of zero.
+            uint32_t iftrue_weight = std::min<uint64_t>((uint64_t)node->iftrue->bjit_count + 1, UINT32_MAX);
+            uint32_t iffalse_weight = std::min<uint64_t>((uint64_t)node->iffalse->bjit_count + 1, UINT32_MAX);
+            branch_weights = llvm::MDBuilder(g.context).createBranchWeights(iftrue_weight, iffalse_weight);
+        }
+
         endBlock(FINISHED);
 
-        emitter.getBuilder()->CreateCondBr(v, iftrue, iffalse);
+        emitter.getBuilder()->CreateCondBr(v, iftrue, iffalse, branch_weights);
     }
 
     void doExpr(AST_Expr* node, UnwindInfo unw_info) {
@@ -0,0 +1,281 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codegen/object_cache.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#include "core/options.h"
+#include "core/stats.h"
+
+namespace pyston {
+
+bool ObjectCachePackFile::isValid(const Header& h, size_t file_size) {
+    return memcmp(h.magic, "PYOCACHE", 8) == 0 && h.version == version && h.num_slots > 0
+           && dataStart(h.num_slots) <= h.data_end && h.data_end <= file_size;
+}
+
+bool ObjectCachePackFile::writeEmptyFile(int fd) {
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "PYOCACHE", 8);
+    h.version = version;
+    h.num_slots = std::max(MAX_OBJECT_CACHE_ENTRIES, 1);
+    h.data_end = dataStart(h.num_slots);
+
+    // ftruncate fills the index with zeroes, ie unused slots:
+    return ftruncate(fd, 0) == 0 && ftruncate(fd, h.data_end) == 0 && pwrite(fd, &h, sizeof(h), 0) == sizeof(h);
+}
+
+bool ObjectCachePackFile::openFile() {
+    if (fd != -1)
+        close(fd);
+    fd = -1;
+
+    llvm::SmallString<128> dir(path);
+    llvm::sys::path::remove_filename(dir);
+    if (!llvm::sys::fs::exists(dir.str()) && llvm::sys::fs::create_directories(dir.str()))
+        return false;
+
+    int new_fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (new_fd == -1)
+        return false;
+
+    bool ok = flock(new_fd, LOCK_EX) == 0;
+    struct stat st;
+    ok = ok && fstat(new_fd, &st) == 0;
+    if (ok) {
+        Header h;
+        if (st.st_size < sizeof(h) || pread(new_fd, &h, sizeof(h), 0) != sizeof(h) || !isValid(h, st.st_size))
+            ok = writeEmptyFile(new_fd);
+    }
+    flock(new_fd, LOCK_UN);
+
+    if (!ok) {
+        close(new_fd);
+        return false;
+    }
+
+    fd = new_fd;
+    fd_pid = getpid();
+    fd_inode = st.st_ino;
+    return true;
+}
+
+bool ObjectCachePackFile::lock(int operation) {
+    while (true) {
+        if ((fd == -1 || fd_pid != getpid()) && !openFile())
+            return false;
+        if (flock(fd, operation) != 0)
+            return false;
+
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0 && st.st_ino == fd_inode)
+            return true;
+
+        // Somebody compacted the cache into a new file since we opened it:
+        flock(fd, LOCK_UN);
+        close(fd);
+        fd = -1;
+    }
+}
+
+void ObjectCachePackFile::unlock() {
+    flock(fd, LOCK_UN);
+}
+
+bool ObjectCachePackFile::ensureMapped(size_t size) {
+    if (map && map_inode == fd_inode && map_size >= size)
+        return true;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < size)
+        return false;
+
+    size_t page_size = getpagesize();
+    size_t new_size = (st.st_size + page_size - 1) & ~(page_size - 1);
+
+    if (!map || map_inode != fd_inode || new_size > map_reserved) {
+        if (map && map_reserved > map_size)
+            munmap(map + map_size, map_reserved - map_size);
+        map_reserved = map_size;
+
+        size_t reserve = std::max(new_size, (size_t)1 << 30);
+        void* r = mmap(NULL, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (r == MAP_FAILED)
+            return false;
+
+        map = (char*)r;
+        map_size = 0;
+        map_reserved = reserve;
+        map_inode = fd_inode;
+    }
+
+    // The page that the file used to end in is already mapped, and shows whatever got written past the old end:
+    void* tail
+        = mmap(map + map_size, new_size - map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, map_size);
+    if (tail == MAP_FAILED)
+        return false;
+
+    map_size = new_size;
+    return isValid(*header(), st.st_size);
+}
+
+int ObjectCachePackFile::find(llvm::StringRef hash) {
+    for (int i = 0; i < header()->num_slots; i++) {
+        if (memcmp(index()[i].hash, hash.data(), hash_length) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void ObjectCachePackFile::compact() {
+    static StatCounter sc_compactions("num_jit_objectcache_compactions");
+    sc_compactions.log();
+
+    std::string tmp_path = path + "." + std::to_string(getpid());
+    int new_fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (new_fd == -1)
+        return;
+
+    // The objects that got appended since we last mapped the file (by other processes, or by our own pwrite()s in
+    // add()) are past the end of our mapping:
+    if (!ensureMapped(header()->data_end)) {
+        close(new_fd);
+        unlink(tmp_path.c_str());
+        return;
+    }
+
+    Header h = *header();
+    std::vector<IndexEntry> new_index(index(), index() + h.num_slots);
+    h.data_end = dataStart(h.num_slots);
+    bool ok = true;
+    for (IndexEntry& e : new_index) {
+        if (!e.hash[0])
+            continue;
+        uint64_t offset = align(h.data_end);
+        ok = ok && pwrite(new_fd, map + e.offset, e.size, offset) == e.size;
+        e.offset = offset;
+        h.data_end = offset + e.size;
+    }
+    size_t index_size = new_index.size() * sizeof(IndexEntry);
+    ok = ok && pwrite(new_fd, new_index.data(), index_size, sizeof(h)) == index_size;
+    ok = ok && pwrite(new_fd, &h, sizeof(h), 0) == sizeof(h);
+
+    // Take the lock on the new file before anyone can see it:
+    struct stat st;
+    ok = ok && flock(new_fd, LOCK_EX) == 0 && fstat(new_fd, &st) == 0;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        close(new_fd);
+        unlink(tmp_path.c_str());
+        return;
+    }
+
+    unlock();
+    close(fd);
+    fd = new_fd;
+    fd_inode = st.st_ino;
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCachePackFile::get(llvm::StringRef hash) {
+    assert(hash.size() == hash_length);
+    if (!lock(LOCK_SH))
+        return std::unique_ptr<llvm::MemoryBuffer>();
+
+    std::unique_ptr<llvm::MemoryBuffer> rtn;
+    if (ensureMapped(sizeof(Header)) && ensureMapped(dataStart(header()->num_slots))) {
+        int i = find(hash);
+        if (i != -1) {
+            uint64_t offset = index()[i].offset, size = index()[i].size;
+            if (offset + size <= header()->data_end && ensureMapped(offset + size)) {
+                // Other readers might be doing this at the same time, so this has to be atomic:
+                uint64_t now = __atomic_add_fetch(&header()->clock, 1, __ATOMIC_RELAXED);
+                __atomic_store_n(&index()[i].last_used, now, __ATOMIC_RELAXED);
+                rtn = llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(map + offset, size), "", false);
+            }
+        }
+    }
+
+    unlock();
+    return rtn;
+}
+
+void ObjectCachePackFile::add(llvm::StringRef hash, llvm::StringRef data) {
+    assert(hash.size() == hash_length);
+    if (!lock(LOCK_EX))
+        return;
+
+    if (!ensureMapped(sizeof(Header)) || !ensureMapped(dataStart(header()->num_slots))) {
+        unlock();
+        return;
+    }
+
+    // Another process might have compiled the same module in the meantime:
+    if (find(hash) != -1) {
+        unlock();
+        return;
+    }
+
+    // Reclaim the space of the evicted objects once they take up more than half of the file:
+    uint64_t dead_bytes = header()->data_end - dataStart(header()->num_slots) - header()->live_bytes;
+    if (dead_bytes > header()->live_bytes + data.size() && dead_bytes > (8 << 20)) {
+        compact();
+        if (!ensureMapped(dataStart(header()->num_slots))) {
+            unlock();
+            return;
+        }
+    }
+
+    // Use a free slot, or evict the least recently used object:
+    int slot = 0;
+    for (int i = 0; i < header()->num_slots; i++) {
+        if (!index()[i].hash[0]) {
+            slot = i;
+            break;
+        }
+        if (index()[i].last_used < index()[slot].last_used)
+            slot = i;
+    }
+    IndexEntry& e = index()[slot];
+    if (e.hash[0]) {
+        static StatCounter sc_evictions("num_jit_objectcache_evictions");
+        sc_evictions.log();
+        header()->live_bytes -= e.size;
+        memset(e.hash, 0, hash_length);
+    }
+
+    // Write the object before publishing it in the index:
+    uint64_t offset = align(header()->data_end);
+    if (pwrite(fd, data.data(), data.size(), offset) == data.size()) {
+        e.offset = offset;
+        e.size = data.size();
+        e.last_used = ++header()->clock;
+        memcpy(e.hash, hash.data(), hash_length);
+        header()->data_end = offset + data.size();
+        header()->live_bytes += data.size();
+    }
+
+    unlock();
+}
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_CODEGEN_OBJECTCACHE_H
+#define PYSTON_CODEGEN_OBJECTCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace pyston {
+
+// All of the cached objects live in a single file, so that a hit is just a lookup in the index plus handing LLVM a
+// pointer into our mapping of the file, and so that all the processes that share a cache (eg the children of a
+// prefork server) see each other's objects.
+//
+// The file is a Header, then num_slots IndexEntries, then the objects.  Objects only ever get appended after
+// data_end: the space used by evicted objects gets reclaimed by copying the live ones into a new file and renaming
+// it over the old one, so the bytes that a process has handed to LLVM never change underneath it.
+//
+// Processes coordinate with flock(): lookups hold a shared lock, and adding an object holds an exclusive one.
+class ObjectCachePackFile {
+public:
+    static constexpr int hash_length = 64; // hex sha256 of the module
+
+private:
+    static constexpr uint32_t version = 1;
+    static constexpr int alignment = 16;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t num_slots;
+        uint64_t data_end;
+        uint64_t live_bytes;
+        uint64_t clock; // ticks on every hit, for the LRU eviction
+    };
+
+    struct IndexEntry {
+        char hash[hash_length]; // all zeroes for an unused slot
+        uint64_t offset;
+        uint64_t size;
+        uint64_t last_used;
+    };
+
+    std::string path;
+
+    int fd;
+    pid_t fd_pid; // flock() locks are shared with forked children, so each process needs to open the file itself
+    ino_t fd_inode;
+
+    // We never unmap the file, since LLVM might still be using objects in it.  Instead we reserve a big range of
+    // address space for it up front and map the parts that get appended to the file right after the parts that we
+    // already have, so the file only gets mapped once.  (Unless it outgrows the reservation, or it gets replaced by
+    // compact(); then we start a new mapping, and give back the unused part of the old reservation.)
+    char* map;
+    size_t map_size; // how much of the reservation is mapped; always a multiple of the page size
+    size_t map_reserved;
+    ino_t map_inode;
+
+    Header* header() { return (Header*)map; }
+    IndexEntry* index() { return (IndexEntry*)(map + sizeof(Header)); }
+    static size_t dataStart(uint32_t num_slots) { return sizeof(Header) + num_slots * sizeof(IndexEntry); }
+    static uint64_t align(uint64_t offset) { return (offset + alignment - 1) & ~(uint64_t)(alignment - 1); }
+
+    static bool isValid(const Header& h, size_t file_size);
+    bool writeEmptyFile(int fd);
+    bool openFile();
+
+    // Returns with the lock held on the file that's currently at `path`.
+    bool lock(int operation);
+    void unlock();
+
+    // Makes sure that our mapping covers the first `size` bytes of the file.  Must be called with the lock held.
+    bool ensureMapped(size_t size);
+
+    int find(llvm::StringRef hash);
+
+    // Copies the live objects into a new file and switches over to it.  Must be called with the exclusive lock held.
+    void compact();
+
+public:
+    // The index gets MAX_OBJECT_CACHE_ENTRIES slots when the file is created.
+    ObjectCachePackFile(llvm::StringRef path)
+        : path(path.str()),
+          fd(-1),
+          fd_pid(0),
+          fd_inode(0),
+          map(NULL),
+          map_size(0),
+          map_reserved(0),
+          map_inode(0) {}
+
+    // Returns a buffer pointing into the mapping of the file, or NULL if the object isn't in the cache.
+    std::unique_ptr<llvm::MemoryBuffer> get(llvm::StringRef hash);
+    void add(llvm::StringRef hash, llvm::StringRef data);
+};
+}
+
+#endif
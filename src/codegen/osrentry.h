@@ -27,6 +27,8 @@ class Function;
 
 namespace pyston {
 
+class AST_Jump;
+class CLFunction;
 struct StackMap;
 
 class OSREntryDescriptor {
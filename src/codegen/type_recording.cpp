@@ -38,6 +38,23 @@ Box* recordType(TypeRecorder* self, Box* obj) {
         self->last_count++;
     }
 
+    if (ENABLE_TYPE_HISTOGRAMS && !self->megamorphic) {
+        int i = 0;
+        for (; i < TypeRecorder::max_classes; i++) {
+            if (self->seen[i] == cls) {
+                self->counts[i]++;
+                break;
+            }
+            if (!self->seen[i]) {
+                self->seen[i] = cls;
+                self->counts[i] = 1;
+                break;
+            }
+        }
+        if (i == TypeRecorder::max_classes)
+            self->megamorphic = true;
+    }
+
     // printf("Seen %s %ld times\n", getNameOfClass(cls)->c_str(), self->last_count);
 
     return obj;
@@ -61,4 +78,12 @@ BoxedClass* TypeRecorder::predict() {
 
     return NULL;
 }
+
+int64_t TypeRecorder::countFor(BoxedClass* cls) const {
+    for (int i = 0; i < max_classes && seen[i]; i++) {
+        if (seen[i] == cls)
+            return counts[i];
+    }
+    return 0;
+}
 }
@@ -33,15 +33,30 @@ class TypeRecorder;
 // The return value of this function is 'obj' for ease of use.
 extern "C" Box* recordType(TypeRecorder* recorder, Box* obj);
 class TypeRecorder {
+public:
+    // How many different classes we keep counts for; a site that sees more than this is megamorphic.
+    static constexpr int max_classes = 4;
+
 private:
     BoxedClass* last_seen;
     int64_t last_count;
 
+    // How many times we've seen each class, in the order we first saw them:
+    BoxedClass* seen[max_classes];
+    int64_t counts[max_classes];
+    bool megamorphic;
+
 public:
-    constexpr TypeRecorder() : last_seen(nullptr), last_count(0) {}
+    constexpr TypeRecorder() : last_seen(nullptr), last_count(0), seen(), counts(), megamorphic(false) {}
 
+    // Returns the class that the last SPECULATION_THRESHOLD values have all been.
     BoxedClass* predict();
 
+    // How many values of this class the site has produced; only counted with ENABLE_TYPE_HISTOGRAMS.  Once the site
+    // is megamorphic, the counts stop changing, and the classes after the first max_classes ones aren't counted at all.
+    int64_t countFor(BoxedClass* cls) const;
+    bool isMegamorphic() const { return megamorphic; }
+
     friend Box* recordType(TypeRecorder*, Box*);
 };
 
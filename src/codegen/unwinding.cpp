@@ -166,6 +166,11 @@ CompiledFunction* getCFForAddress(uint64_t addr) {
     return cf_registry.getCFForAddress(addr);
 }
 
+void registerCompiledFunction(CompiledFunction* cf) {
+    assert(cf->code_start);
+    cf_registry.registerCF(cf);
+}
+
 class TracebacksEventListener : public llvm::JITEventListener {
 public:
     virtual void NotifyObjectEmitted(const llvm::object::ObjectFile& Obj,
@@ -214,7 +219,6 @@ public:
             assert(g.cur_cf->code_start == 0);
             g.cur_cf->code_start = func_addr;
             g.cur_cf->code_size = Size;
-            cf_registry.registerCF(g.cur_cf);
         }
 
         assert(func_addr);
@@ -330,7 +334,8 @@ public:
         }
     }
 
-    AST_stmt* getCurrentStatement() {
+    // Returns NULL if the frame is stopped somewhere that we didn't record the current statement for.
+    AST_stmt* tryGetCurrentStatement() {
         if (id.type == PythonFrameId::COMPILED) {
             CompiledFunction* cf = getCF();
             uint64_t ip = getId().ip;
@@ -351,13 +356,19 @@ public:
                     return reinterpret_cast<AST_stmt*>(readLocation(e.locations[0]));
                 }
             }
-            RELEASE_ASSERT(0, "no frame info found at offset 0x%x / ip 0x%lx!", offset, ip);
+            return NULL;
         } else if (id.type == PythonFrameId::INTERPRETED) {
             return getCurrentStatementForInterpretedFrame((void*)id.bp);
         }
         abort();
     }
 
+    AST_stmt* getCurrentStatement() {
+        AST_stmt* rtn = tryGetCurrentStatement();
+        RELEASE_ASSERT(rtn, "no frame info found at ip 0x%lx!", getId().ip);
+        return rtn;
+    }
+
     Box* getGlobals() {
         if (id.type == PythonFrameId::COMPILED) {
             CompiledFunction* cf = getCF();
@@ -1174,12 +1185,12 @@ std::string getCurrentPythonLine() {
     if (frame_iter.get()) {
         std::ostringstream stream;
 
-        auto* cf = frame_iter->getCF();
-        auto source = cf->clfunc->source.get();
-
-        auto current_stmt = frame_iter->getCurrentStatement();
+        // This gets called from places (like the heap profiler) where we could be anywhere inside a function, so
+        // don't assume that the current statement is known:
+        auto source = frame_iter->getCL()->source.get();
+        auto current_stmt = frame_iter->tryGetCurrentStatement();
 
-        stream << source->fn << ":" << current_stmt->lineno;
+        stream << source->fn << ":" << (current_stmt ? current_stmt->lineno : -1);
         return stream.str();
     }
     return "unknown:-1";
@@ -38,6 +38,8 @@ BoxedModule* getCurrentModule();
 Box* getGlobals();     // returns either the module or a globals dict
 Box* getGlobalsDict(); // always returns a dict-like object
 CompiledFunction* getCFForAddress(uint64_t addr);
+// Makes a newly-jitted function show up in getCFForAddress; its code_start and code_size need to be set.
+void registerCompiledFunction(CompiledFunction* cf);
 
 Box* getTraceback();
 
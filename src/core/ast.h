@@ -144,6 +144,7 @@ class ASTVisitor;
 class ExprVisitor;
 class StmtVisitor;
 class AST_keyword;
+struct GetattrCache;
 
 class AST {
 public:
@@ -272,13 +273,16 @@ public:
     AST_TYPE::AST_TYPE ctx_type;
     InternedString attr;
 
+    // Used by the interpreter for loads (and calls) of this attribute; allocated the first time it's needed.
+    GetattrCache* getattr_cache;
+
     virtual void accept(ASTVisitor* v);
     virtual void* accept_expr(ExprVisitor* v);
 
-    AST_Attribute() : AST_expr(AST_TYPE::Attribute) {}
+    AST_Attribute() : AST_expr(AST_TYPE::Attribute), getattr_cache(NULL) {}
 
     AST_Attribute(AST_expr* value, AST_TYPE::AST_TYPE ctx_type, InternedString attr)
-        : AST_expr(AST_TYPE::Attribute), value(value), ctx_type(ctx_type), attr(attr) {}
+        : AST_expr(AST_TYPE::Attribute), value(value), ctx_type(ctx_type), attr(attr), getattr_cache(NULL) {}
 
     static const AST_TYPE::AST_TYPE TYPE = AST_TYPE::Attribute;
 };
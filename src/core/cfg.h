@@ -52,6 +52,8 @@ public:
     void* code;
     // contains the address of the entry function
     std::pair<CFGBlock*, Box*>(*entry_code)(void* interpeter, CFGBlock* block, Box** vregs);
+    // how many times the baseline jit code of this block has run; only kept up to date with ENABLE_BLOCK_COUNTS
+    uint32_t bjit_count;
 
     std::vector<AST_stmt*> body;
     std::vector<CFGBlock*> predecessors, successors;
@@ -60,7 +62,7 @@ public:
 
     typedef std::vector<AST_stmt*>::iterator iterator;
 
-    CFGBlock(CFG* cfg, int idx) : cfg(cfg), code(NULL), entry_code(NULL), idx(idx), info(NULL) {}
+    CFGBlock(CFG* cfg, int idx) : cfg(cfg), code(NULL), entry_code(NULL), bjit_count(0), idx(idx), info(NULL) {}
 
     void connectTo(CFGBlock* successor, bool allow_backedge = false);
     void unconnectFrom(CFGBlock* successor);
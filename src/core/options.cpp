@@ -16,6 +16,13 @@
 
 namespace pyston {
 
+// The GRWL build turns off the parts of the jit that aren't thread-safe yet; see the comment above ENABLE_ICS.
+#if THREADING_USE_GRWL
+static const bool _USE_GRWL = true;
+#else
+static const bool _USE_GRWL = false;
+#endif
+
 int GLOBAL_VERBOSITY = 0;
 
 int PYSTON_VERSION_MAJOR = 0;
@@ -39,7 +46,7 @@ bool DUMPJIT = false;
 bool TRAP = false;
 bool USE_STRIPPED_STDLIB = true; // always true
 bool ENABLE_INTERPRETER = true;
-bool ENABLE_BASELINEJIT = true;
+bool ENABLE_BASELINEJIT = !_USE_GRWL;
 bool ENABLE_PYPA_PARSER = true;
 bool USE_REGALLOC_BASIC = true;
 bool PAUSE_AT_ABORT = false;
@@ -55,8 +62,52 @@ int SPECULATION_THRESHOLD = 100;
 
 int MAX_OBJECT_CACHE_ENTRIES = 500;
 
+// Do the LLVM-tier compiles that the thresholds above trigger on a separate thread, and keep running the function
+// in the interpreter / baseline jit until the new version is ready.
+bool ENABLE_BACKGROUND_COMPILE = false;
+
+// Cache attribute lookups and method calls in the interpreter, per AST node (see GetattrCache).
+bool ENABLE_INTERPRETER_CACHES = !_USE_GRWL;
+
+// Count how often the baseline jit runs each block, and give the llvm tier the counts as branch weights, so that
+// it lays out the path that hot loops actually take as straight-line code and moves the other blocks out of the way.
+bool ENABLE_BLOCK_COUNTS = false;
+
+// Have each TypeRecorder count how often it sees each class (see TypeRecorder::countFor), on top of the run of the
+// last class that predict() uses.  Nothing in the compiler looks at these counts yet, so they're off by default.
+bool ENABLE_TYPE_HISTOGRAMS = false;
+
+// Remember which blocks the baseline jit compiled (in ~/.cache/pyston/baseline_jit_cache), and compile them as soon
+// as they get executed in later runs.
+bool ENABLE_BASELINEJIT_CACHE = false;
+
+// Number of threads (including the collecting thread) that take part in the gc mark phase.
+int GC_MARK_THREADS = 1;
+
+// Sweep small-object blocks the next time they get allocated from, rather than during the collection pause.
+bool GC_LAZY_SWEEP = true;
+
+// Generational mode: most collections only look at the objects allocated since the last collection, plus the
+// old objects that were written to.  This needs write barriers in the generated code, so it can only be turned
+// on at startup (with -g).
+bool GC_GENERATIONAL = false;
+int GC_MINOR_COLLECTIONS_PER_MAJOR = 8;
+
+// Collect once the amount allocated since the last collection reaches GC_HEAP_GROWTH_PERCENT of the memory that
+// survived it, or GC_MIN_BYTES_PER_COLLECTION, whichever is larger.  GC_MIN_BYTES_PER_COLLECTION=0 turns off
+// automatic collections.
+int GC_MIN_BYTES_PER_COLLECTION = 10000000;
+int GC_HEAP_GROWTH_PERCENT = 50;
+
+// How many bytes of completely empty heap blocks to keep around after a collection; the rest of them get
+// returned to the OS.
+int GC_FREE_MEMORY_WATERMARK = 32 * 1024 * 1024;
+
 static bool _GLOBAL_ENABLE = 1;
-bool ENABLE_ICS = 1 && _GLOBAL_ENABLE;
+// With the GRWL, several threads can be running the same code at once, and rewriting ICs (or filling in the
+// interpreter's caches, or patching baseline jit code) while another thread is executing it isn't safe.  So the GRWL
+// build runs without them for now, which also means that it only uses the interpreter and the llvm tier.
+bool ENABLE_ICS = 1 && _GLOBAL_ENABLE && !_USE_GRWL;
 bool ENABLE_ICGENERICS = 1 && ENABLE_ICS;
 bool ENABLE_ICGETITEMS = 1 && ENABLE_ICS;
 bool ENABLE_ICSETITEMS = 1 && ENABLE_ICS;
@@ -75,7 +126,7 @@ bool ENABLE_INLINING = 1 && _GLOBAL_ENABLE;
 bool ENABLE_REOPT = 1 && _GLOBAL_ENABLE;
 bool ENABLE_PYSTON_PASSES = 1 && _GLOBAL_ENABLE;
 bool ENABLE_TYPE_FEEDBACK = 1 && _GLOBAL_ENABLE;
-bool ENABLE_RUNTIME_ICS = 1 && _GLOBAL_ENABLE;
+bool ENABLE_RUNTIME_ICS = 1 && _GLOBAL_ENABLE && !_USE_GRWL;
 bool ENABLE_JIT_OBJECT_CACHE = 1 && _GLOBAL_ENABLE;
 
 bool ENABLE_FRAME_INTROSPECTION = 1;
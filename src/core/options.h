@@ -36,6 +36,17 @@ extern int OSR_THRESHOLD_BASELINE, REOPT_THRESHOLD_BASELINE;
 extern int OSR_THRESHOLD_T2, REOPT_THRESHOLD_T2;
 extern int SPECULATION_THRESHOLD;
 extern int MAX_OBJECT_CACHE_ENTRIES;
+extern bool ENABLE_BACKGROUND_COMPILE;
+extern bool ENABLE_BASELINEJIT_CACHE;
+extern bool ENABLE_INTERPRETER_CACHES;
+extern bool ENABLE_BLOCK_COUNTS;
+extern bool ENABLE_TYPE_HISTOGRAMS;
+extern int GC_MARK_THREADS;
+extern bool GC_LAZY_SWEEP;
+extern bool GC_GENERATIONAL;
+extern int GC_MINOR_COLLECTIONS_PER_MAJOR;
+extern int GC_MIN_BYTES_PER_COLLECTION, GC_HEAP_GROWTH_PERCENT;
+extern int GC_FREE_MEMORY_WATERMARK;
 
 extern bool SHOW_DISASM, FORCE_INTERPRETER, FORCE_OPTIMIZE, PROFILE, DUMPJIT, TRAP, USE_STRIPPED_STDLIB,
     CONTINUE_AFTER_FATAL, ENABLE_INTERPRETER, ENABLE_BASELINEJIT, ENABLE_PYPA_PARSER, USE_REGALLOC_BASIC,
@@ -14,9 +14,13 @@
 
 #include "core/threading.h"
 
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <err.h>
+#include <linux/futex.h>
 #include <setjmp.h>
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -473,17 +477,9 @@ extern "C" void endAllowThreads() noexcept {
     acquireGLRead();
 }
 
-#if THREADING_USE_GIL
-#if THREADING_USE_GRWL
-#error "Can't turn on both the GIL and the GRWL!"
-#endif
-
-static pthread_mutex_t gil = PTHREAD_MUTEX_INITIALIZER;
-
-std::atomic<int> threads_waiting_on_gil(0);
-static pthread_cond_t gil_acquired = PTHREAD_COND_INITIALIZER;
-
-extern "C" void PyEval_ReInitThreads() noexcept {
+// The part of PyEval_ReInitThreads that doesn't depend on the kind of global lock: after a fork, the other threads
+// are gone.
+static void forgetOtherThreads() {
     pthread_t current_thread = pthread_self();
     assert(current_threads.count(pthread_self()));
 
@@ -506,46 +502,130 @@ extern "C" void PyEval_ReInitThreads() noexcept {
     threading_lock.unlock();
 
     num_starting_threads = 0;
-    threads_waiting_on_gil = 0;
+}
+
+#if THREADING_USE_GIL
+#if THREADING_USE_GRWL
+#error "Can't turn on both the GIL and the GRWL!"
+#endif
+
+// The GIL is a ticket lock: a thread that wants the GIL takes the next ticket, and the GIL gets passed on to the
+// tickets in order, so threads get the GIL in the order that they asked for it.  Waiting threads sleep on the futex
+// of their ticket's slot, so that releasing the GIL only wakes up the thread that is next in line.
+//
+// Threads holding the GIL don't give it up on their own (other than to block), so a thread that has been waiting
+// for longer than GIL_SWITCH_INTERVAL_US without the GIL changing hands sets gil_drop_request, and the holder then
+// goes to the back of the line (this is the same scheme as the "new GIL" of CPython 3.2).
+static std::atomic<uint32_t> gil_next_ticket(0);
+static std::atomic<uint32_t> gil_now_serving(0);
+
+#define GIL_WAIT_SLOTS 64
+struct GILWaitSlot {
+    // The last ticket that got handed the GIL through this slot.  This is the futex word that waiters sleep on.
+    std::atomic<uint32_t> handed_to;
+    // Keep each slot on its own cache line:
+    char padding[64 - sizeof(std::atomic<uint32_t>)];
+};
+static GILWaitSlot gil_wait_slots[GIL_WAIT_SLOTS];
+
+std::atomic<int> gil_drop_request(0);
+
+static StatCounter num_gil_drop_requests("num_gil_drop_requests");
+
+static long futex(std::atomic<uint32_t>* uaddr, int op, uint32_t val, const struct timespec* timeout) {
+    return syscall(SYS_futex, uaddr, op, val, timeout, NULL, 0);
+}
+
+static uint64_t monotonicMicroseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
+extern "C" void PyEval_ReInitThreads() noexcept {
+    forgetOtherThreads();
+
+    // We are holding the GIL, and whichever threads were waiting on it are gone:
+    gil_next_ticket = gil_now_serving + 1;
+    gil_drop_request = 0;
 
     // TODO we should clean up all created PerThreadSets, such as the one used in the heap for thread-local-caches.
 }
 
 void acquireGLWrite() {
-    threads_waiting_on_gil++;
-    pthread_mutex_lock(&gil);
-    threads_waiting_on_gil--;
+    uint32_t ticket = gil_next_ticket.fetch_add(1);
+    if (likely(gil_now_serving.load() == ticket))
+        return;
+
+    uint64_t wait_start = monotonicMicroseconds();
+    bool requested_drop = false;
 
-    pthread_cond_signal(&gil_acquired);
+    GILWaitSlot& slot = gil_wait_slots[ticket % GIL_WAIT_SLOTS];
+    uint32_t last_seen_serving = gil_now_serving.load();
+    while (true) {
+        // Read the futex word before checking whether it's our turn, so that if the GIL gets handed to us in between,
+        // the futex wait returns immediately.
+        uint32_t handed_to = slot.handed_to.load();
+        uint32_t now_serving = gil_now_serving.load();
+        if (now_serving == ticket)
+            break;
+
+        struct timespec timeout = { 0, GIL_SWITCH_INTERVAL_US * 1000 };
+        long r = futex(&slot.handed_to, FUTEX_WAIT_PRIVATE, handed_to, &timeout);
+        if (r == -1 && errno == ETIMEDOUT) {
+            // The GIL hasn't changed hands for a whole interval, so ask whoever has it to let the others run:
+            now_serving = gil_now_serving.load();
+            if (now_serving == last_seen_serving && now_serving != ticket) {
+                gil_drop_request.store(1, std::memory_order_relaxed);
+                requested_drop = true;
+            }
+            last_seen_serving = now_serving;
+        }
+    }
+
+    // The stats aren't thread-safe, so only log them now that we have the GIL:
+    static thread_local StatPerThreadCounter sc_gil_waits("gil_waits");
+    static thread_local StatPerThreadCounter sc_gil_wait_us("gil_wait_us");
+    sc_gil_waits.log();
+    sc_gil_wait_us.log(monotonicMicroseconds() - wait_start);
+    if (requested_drop)
+        num_gil_drop_requests.log();
 }
 
 void releaseGLWrite() {
-    pthread_mutex_unlock(&gil);
-}
+    uint32_t next = gil_now_serving.load(std::memory_order_relaxed) + 1;
+    gil_now_serving.store(next);
 
-int gil_check_count = 0;
+    // If nobody has taken the next ticket yet, whoever does will see that it's their turn without having to sleep.
+    // (This relies on the store to gil_now_serving and this load being sequentially consistent.)
+    if (gil_next_ticket.load() == next)
+        return;
+
+    GILWaitSlot& slot = gil_wait_slots[next % GIL_WAIT_SLOTS];
+    slot.handed_to.store(next);
+    // Usually there's just the one thread waiting on this slot, but with more than GIL_WAIT_SLOTS waiters there
+    // can be several, and only one of them is next in line:
+    futex(&slot.handed_to, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+}
 
-// TODO: this function is fair in that it forces a thread to give up the GIL
-// after a bounded amount of time, but currently we have no guarantees about
-// who it will release the GIL to.  So we could have two threads that are
-// switching back and forth, and a third that never gets run.
-// We could enforce fairness by having a FIFO of events (implementd with mutexes?)
-// and make sure to always wake up the longest-waiting one.
 void _allowGLReadPreemption() {
-    assert(gil_check_count >= GIL_CHECK_INTERVAL);
-    gil_check_count = 0;
+    gil_drop_request.store(0, std::memory_order_relaxed);
 
-    // Double check this, since if we are wrong about there being a thread waiting on the gil,
-    // we're going to get stuck in the following pthread_cond_wait:
-    if (!threads_waiting_on_gil.load(std::memory_order_seq_cst))
+    // Double check that somebody is still waiting; otherwise we would just get the GIL right back.
+    if (gil_next_ticket.load() == gil_now_serving.load(std::memory_order_relaxed) + 1)
         return;
 
-    threads_waiting_on_gil++;
-    pthread_cond_wait(&gil_acquired, &gil);
-    threads_waiting_on_gil--;
-    pthread_cond_signal(&gil_acquired);
+    static thread_local StatPerThreadCounter sc_gil_switches("gil_forced_switches");
+    sc_gil_switches.log();
+
+    // Go to the back of the line:
+    releaseGLWrite();
+    acquireGLWrite();
 }
 #elif THREADING_USE_GRWL
+// In GRWL mode, threads run Python code while holding the global lock in read mode, so they can run at the same
+// time.  Anything that changes the structure of an object that other threads might be looking at (see
+// isGLPromoted()) has to promote to write mode first, as do the collector and the compiler.
 static pthread_rwlock_t grwl = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
 
 enum class GRWLHeldState {
@@ -554,64 +634,109 @@ enum class GRWLHeldState {
     W,
 };
 static __thread GRWLHeldState grwl_state = GRWLHeldState::N;
+// How many promoteGL() calls deep we are; the lock only goes back to read mode when the outermost one is done.
+// Taking the lock with acquireGLWrite() counts as one level, so that promoting inside of that is a no-op.
+static __thread int grwl_promote_depth = 0;
+// The mode that releaseGLRead() gave up, so that acquireGLRead() can restore it.  This lets code that is holding the
+// lock in write mode (ex Python code called from a dict mutation) still block, with beginAllowThreads().
+static __thread GRWLHeldState grwl_released_state = GRWLHeldState::N;
+
+std::atomic<int> grwl_writers_waiting(0);
+
+static void grwlLockWrite() {
+    grwl_writers_waiting++;
+    pthread_rwlock_wrlock(&grwl);
+    grwl_writers_waiting--;
+}
 
-static std::atomic<int> writers_waiting(0);
+extern "C" void PyEval_ReInitThreads() noexcept {
+    forgetOtherThreads();
+
+    // The threads that were holding the lock are gone, so start over with a fresh lock, and take it back in the mode
+    // that we had it in:
+    pthread_rwlock_t fresh_grwl = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+    grwl = fresh_grwl;
+    grwl_writers_waiting = 0;
+    if (grwl_state == GRWLHeldState::R)
+        pthread_rwlock_rdlock(&grwl);
+    else if (grwl_state == GRWLHeldState::W)
+        pthread_rwlock_wrlock(&grwl);
+}
 
 void acquireGLRead() {
     assert(grwl_state == GRWLHeldState::N);
-    pthread_rwlock_rdlock(&grwl);
-    grwl_state = GRWLHeldState::R;
+    if (grwl_released_state == GRWLHeldState::W) {
+        grwlLockWrite();
+        grwl_state = GRWLHeldState::W;
+    } else {
+        pthread_rwlock_rdlock(&grwl);
+        grwl_state = GRWLHeldState::R;
+    }
+    grwl_released_state = GRWLHeldState::N;
 }
 
 void releaseGLRead() {
-    assert(grwl_state == GRWLHeldState::R);
+    assert(grwl_state != GRWLHeldState::N);
     pthread_rwlock_unlock(&grwl);
+    grwl_released_state = grwl_state;
     grwl_state = GRWLHeldState::N;
 }
 
 void acquireGLWrite() {
     assert(grwl_state == GRWLHeldState::N);
-
-    writers_waiting++;
-    pthread_rwlock_wrlock(&grwl);
-    writers_waiting--;
-
+    grwlLockWrite();
     grwl_state = GRWLHeldState::W;
+    grwl_promote_depth = 1;
 }
 
 void releaseGLWrite() {
     assert(grwl_state == GRWLHeldState::W);
+    assert(grwl_promote_depth == 1);
     pthread_rwlock_unlock(&grwl);
     grwl_state = GRWLHeldState::N;
+    grwl_promote_depth = 0;
+}
+
+bool isGLPromoted() {
+    return grwl_state == GRWLHeldState::W;
 }
 
 void promoteGL() {
+    if (grwl_state == GRWLHeldState::W) {
+        grwl_promote_depth++;
+        return;
+    }
+
     Timer _t2("promoting", /*min_usec=*/10000);
 
     // Note: this is *not* the same semantics as normal promoting, on purpose.
-    releaseGLRead();
-    acquireGLWrite();
+    assert(grwl_state == GRWLHeldState::R);
+    pthread_rwlock_unlock(&grwl);
+    grwlLockWrite();
+    grwl_state = GRWLHeldState::W;
+    grwl_promote_depth = 1;
 
     long promote_us = _t2.end();
     static thread_local StatPerThreadCounter sc_promoting_us("grwl_promoting_us");
     sc_promoting_us.log(promote_us);
+    static thread_local StatPerThreadCounter sc_promotions("grwl_promotions");
+    sc_promotions.log();
 }
 
 void demoteGL() {
-    releaseGLWrite();
-    acquireGLRead();
-}
-
-static __thread int gl_check_count = 0;
-void allowGLReadPreemption() {
-    assert(grwl_state == GRWLHeldState::R);
+    assert(grwl_state == GRWLHeldState::W);
+    assert(grwl_promote_depth > 0);
+    if (--grwl_promote_depth > 0)
+        return;
 
-    // gl_check_count++;
-    // if (gl_check_count < 10)
-    // return;
-    // gl_check_count = 0;
+    pthread_rwlock_unlock(&grwl);
+    pthread_rwlock_rdlock(&grwl);
+    grwl_state = GRWLHeldState::R;
+}
 
-    if (__builtin_expect(!writers_waiting.load(std::memory_order_relaxed), 1))
+void _allowGLReadPreemption() {
+    // A thread in write mode is the only one running, so there's nobody to let in:
+    if (grwl_state != GRWLHeldState::R)
         return;
 
     Timer _t2("preempted", /*min_usec=*/10000);
@@ -90,11 +90,19 @@ void acquireGLWrite();
 void releaseGLWrite();
 void _allowGLReadPreemption();
 
-#define GIL_CHECK_INTERVAL 1000
-// Note: this doesn't need to be an atomic, since it should
-// only be accessed by the thread that holds the gil:
-extern int gil_check_count;
-extern std::atomic<int> threads_waiting_on_gil;
+#if THREADING_USE_GIL
+// How long a thread waits for the GIL before it asks the thread holding it to give it up:
+#define GIL_SWITCH_INTERVAL_US 5000
+// Set when a thread has been waiting on the GIL for longer than GIL_SWITCH_INTERVAL_US; the thread holding the GIL
+// then gives it up the next time it calls allowGLReadPreemption.
+extern std::atomic<int> gil_drop_request;
+#elif THREADING_USE_GRWL
+// The number of threads waiting to get the GRWL in write mode; threads holding it in read mode let them in the next
+// time they call allowGLReadPreemption.
+extern std::atomic<int> grwl_writers_waiting;
+#endif
+
+#if THREADING_USE_GIL || THREADING_USE_GRWL
 extern "C" inline void allowGLReadPreemption() __attribute__((visibility("default")));
 extern "C" inline void allowGLReadPreemption() {
 #if ENABLE_SAMPLING_PROFILER
@@ -119,19 +127,25 @@ extern "C" inline void allowGLReadPreemption() {
         gc::callPendingDestructionLogic();
     }
 
-    // Double-checked locking: first read with no ordering constraint:
-    if (!threads_waiting_on_gil.load(std::memory_order_relaxed))
+    // This is only a request, so it can be read with no ordering constraint:
+#if THREADING_USE_GIL
+    if (likely(!gil_drop_request.load(std::memory_order_relaxed)))
         return;
-
-    gil_check_count++;
-    if (likely(gil_check_count < GIL_CHECK_INTERVAL))
+#else
+    if (likely(!grwl_writers_waiting.load(std::memory_order_relaxed)))
         return;
+#endif
 
     _allowGLReadPreemption();
 }
+#endif
 // Note: promoteGL is free to drop the lock and then reacquire
 void promoteGL();
 void demoteGL();
+// Whether this thread is the only one that can be looking at the heap right now, ie whether it is allowed to change
+// the layout of objects (add attributes, resize lists, etc).  If not, it has to promoteGL() first; since that can
+// drop the lock, anything read before promoting has to be looked up again afterwards.
+bool isGLPromoted();
 
 
 
@@ -169,6 +183,9 @@ inline void promoteGL() {
 }
 inline void demoteGL() {
 }
+inline bool isGLPromoted() {
+    return true;
+}
 #endif
 
 #if !THREADING_USE_GIL && !THREADING_USE_GRWL
@@ -184,6 +201,9 @@ inline void promoteGL() {
 }
 inline void demoteGL() {
 }
+inline bool isGLPromoted() {
+    return true;
+}
 extern "C" inline void allowGLReadPreemption() __attribute__((visibility("default")));
 extern "C" inline void allowGLReadPreemption() {
 }
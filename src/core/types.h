@@ -261,6 +261,9 @@ public:
     int64_t times_called, times_speculation_failed;
     ICInvalidator dependent_callsites;
 
+    // Set once a more optimized version has been queued up for the background compile thread.
+    bool reopt_queued;
+
     LocationMap* location_map;
 
     std::vector<ICInfo*> ics;
@@ -338,6 +341,8 @@ public:
 
     // For use by the interpreter/baseline jit:
     int times_interpreted;
+    // Whether a compile of this function is waiting in the background compile queue:
+    bool compile_queued;
     std::vector<std::unique_ptr<JitCodeBlock>> code_blocks;
     ICInvalidator dependent_interp_callsites;
 
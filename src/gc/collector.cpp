@@ -14,13 +14,16 @@
 
 #include "gc/collector.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
+#include <sched.h>
 
 #include "codegen/ast_interpreter.h"
 #include "codegen/codegen.h"
 #include "core/common.h"
+#include "core/options.h"
 #include "core/threading.h"
 #include "core/types.h"
 #include "core/util.h"
@@ -47,6 +50,10 @@ std::list<Box*> objects_with_ordered_finalizers;
 static std::unordered_set<void*> roots;
 static std::vector<std::pair<void*, void*>> potential_root_ranges;
 
+// Every weakref object that might still be alive.  These are not roots; we use this list to find
+// weakly-referenced garbage right after the mark phase (see handleDeadWeakrefs()).
+static std::unordered_set<PyWeakReference*> all_weakrefs;
+
 // BoxedClasses in the program that are still needed.
 static std::unordered_set<BoxedClass*> class_objects;
 
@@ -64,11 +71,88 @@ static std::unordered_set<GCRootHandle*>* getRootHandles() {
 
 static int ncollections = 0;
 
+// Generational mode (GC_GENERATIONAL) support.
+//
+// The collector doesn't move objects, so the generations are tracked with "sticky" mark bits instead: objects that
+// survive a collection keep their mark bit, which makes them old, and minor collections only trace the objects that
+// aren't marked yet.  Every GC_MINOR_COLLECTIONS_PER_MAJOR collections we clear all the mark bits and do a major
+// collection of the whole heap.
+//
+// Old objects that had a reference stored into them since the last collection; see writeBarrier().
+static std::vector<void*> remembered_set;
+// Old objects that don't go through write barriers, and so have to be rescanned by every minor collection.
+// Rebuilt by every major collection, and can contain duplicates or stale entries.
+static std::vector<void*> old_unbarriered_objects;
+static int minor_collections_since_major = 0;
+
+// The amount of memory that survived the last collection.  Minor collections only add the objects that they
+// promoted, so in generational mode this overestimates until the next major collection.
+static uint64_t live_bytes = 0;
+
+static void remember(GCAllocation* al) {
+    setRemembered(al);
+    remembered_set.push_back(al->user_data);
+}
+
+// With the GRWL, write barriers can run in several threads that only hold the read lock:
+static DS_DEFINE_MUTEX(remembered_set_lock);
+
+void _rememberObject(GCAllocation* al) {
+    LOCK_REGION(&remembered_set_lock);
+    if (isRemembered(al))
+        return;
+
+    static StatCounter sc("gc_write_barrier_remembered_objects");
+    sc.log();
+
+    remember(al);
+}
+
+// Whether we can rely on the stores into instances of this class to call writeBarrier().  This only covers the
+// classes that commonly point to young objects; instances of any other class get rescanned every minor collection.
+// Dicts aren't on it (storing into a dict doesn't call writeBarrier()), so every minor collection rescans all of
+// the old dicts, which visits their entry tables too.
+static bool hasWriteBarriers(BoxedClass* cls) {
+    if (cls->gc_visit != &boxGCHandler && cls->gc_visit != &listGCHandler && cls->gc_visit != &tupleGCHandler
+        && cls->gc_visit != &BoxedString::gcHandler)
+        return false;
+
+    // Slots get set directly by their member descriptors:
+    if ((cls->tp_flags & Py_TPFLAGS_HEAPTYPE) && static_cast<BoxedHeapClass*>(cls)->nslots())
+        return false;
+
+    return true;
+}
+
+static bool needsRescanning(GCAllocation* al) {
+    switch (al->kind_id) {
+        case GCKind::CONSERVATIVE:
+        case GCKind::CONSERVATIVE_PYTHON:
+        case GCKind::HIDDEN_CLASS:
+            return true;
+        case GCKind::PYTHON: {
+            // The cls can be NULL if the object is still being constructed.
+            BoxedClass* cls = reinterpret_cast<Box*>(al->user_data)->cls;
+            return !cls || !hasWriteBarriers(cls);
+        }
+        default:
+            // PRECISE allocations get traced again through the objects that point to them.
+            return false;
+    }
+}
+
 static bool gc_enabled = true;
 static bool should_not_reenter_gc = false;
 
 enum TraceStackType {
     MarkPhase,
+    // Same as MarkPhase, but other threads may be marking at the same time:
+    ParallelMarkPhase,
+    // Generational mode: a major collection.  Same as MarkPhase, but also keeps track of the objects that
+    // will need to be rescanned by every minor collection.
+    PromotingMarkPhase,
+    // Generational mode: a minor collection, which only traces objects that aren't old yet.
+    MinorMarkPhase,
     FinalizationOrderingFindReachable,
     FinalizationOrderingRemoveTemporaries,
 };
@@ -78,8 +162,14 @@ private:
     const int CHUNK_SIZE = 256;
     const int MAX_FREE_CHUNKS = 50;
 
-    std::vector<void**> chunks;
+    // Full chunks.  During a parallel mark phase, other marking threads are allowed to steal
+    // chunks from the front of this (the oldest ones), so accesses need to hold chunks_lock.
+    std::deque<void**> chunks;
+    threading::PthreadSpinLock chunks_lock;
+    std::atomic<int> num_chunks;
+
     static std::vector<void**> free_chunks;
+    static threading::PthreadSpinLock free_chunks_lock;
 
     void** cur;
     void** start;
@@ -87,36 +177,65 @@ private:
 
     TraceStackType visit_type;
 
+    // If set, collects everything that gets pushed (only supported by the generational mark phases).
+    std::vector<void*>* record_pushes;
+
+    // The size of the objects that this stack marked.
+    uint64_t marked_bytes;
+
     void get_chunk() {
-        if (free_chunks.size()) {
-            start = free_chunks.back();
-            free_chunks.pop_back();
-        } else {
-            start = (void**)malloc(sizeof(void*) * CHUNK_SIZE);
+        {
+            LOCK_REGION(&free_chunks_lock);
+            if (free_chunks.size()) {
+                start = free_chunks.back();
+                free_chunks.pop_back();
+            } else {
+                start = NULL;
+            }
         }
+        if (!start)
+            start = (void**)malloc(sizeof(void*) * CHUNK_SIZE);
 
         cur = start;
         end = start + CHUNK_SIZE;
     }
     void release_chunk(void** chunk) {
+        LOCK_REGION(&free_chunks_lock);
         if (free_chunks.size() == MAX_FREE_CHUNKS)
             free(chunk);
         else
             free_chunks.push_back(chunk);
     }
-    void pop_chunk() {
+    bool pop_chunk() {
+        LOCK_REGION(&chunks_lock);
+        if (chunks.empty())
+            return false;
+
         start = chunks.back();
         chunks.pop_back();
+        num_chunks--;
         end = start + CHUNK_SIZE;
         cur = end;
+        return true;
+    }
+    void push_chunk() {
+        {
+            LOCK_REGION(&chunks_lock);
+            chunks.push_back(start);
+            num_chunks++;
+        }
+        get_chunk();
     }
 
 public:
-    TraceStack(TraceStackType type) : visit_type(type) { get_chunk(); }
-    TraceStack(TraceStackType type, const std::unordered_set<void*>& root_handles) : visit_type(type) {
+    TraceStack(TraceStackType type) : num_chunks(0), visit_type(type), record_pushes(NULL), marked_bytes(0) {
+        get_chunk();
+    }
+    TraceStack(TraceStackType type, const std::unordered_set<void*>& root_handles)
+        : num_chunks(0), visit_type(type), record_pushes(NULL), marked_bytes(0) {
         get_chunk();
         for (void* p : root_handles) {
-            assert(!isMarked(GCAllocation::fromUserData(p)));
+            assert(!isMarked(GCAllocation::fromUserData(p)) || type == TraceStackType::MinorMarkPhase);
             push(p);
         }
     }
@@ -159,6 +278,35 @@ public:
                 } else {
                     setMark(al);
                 }
+                marked_bytes += global_heap.allocationSize(al);
+                break;
+            case TraceStackType::ParallelMarkPhase:
+                // Do a cheap non-atomic check first, since most pushes are for already-marked objects:
+                if (isMarked(al) || !trySetMarkAtomic(al))
+                    return;
+                marked_bytes += global_heap.allocationSize(al);
+                break;
+            case TraceStackType::PromotingMarkPhase:
+            case TraceStackType::MinorMarkPhase:
+                if (record_pushes)
+                    record_pushes->push_back(p);
+
+                if (isMarked(al)) {
+                    // Stores into an old precise array don't go through a write barrier, only stores into the
+                    // object that owns it do, so we have to look at the array again when we get to it.
+                    // (Rescanning more arrays than that is harmless.)
+                    if (visit_type == TraceStackType::MinorMarkPhase && al->kind_id == GCKind::PRECISE
+                        && !isRemembered(al)) {
+                        remember(al);
+                        break;
+                    }
+                    return;
+                }
+
+                setMark(al);
+                marked_bytes += global_heap.allocationSize(al);
+                if (needsRescanning(al))
+                    old_unbarriered_objects.push_back(p);
                 break;
             // See PyPy's finalization ordering algorithm:
             // http://pypy.readthedocs.org/en/latest/discussion/finalizer-order.html
@@ -183,16 +331,33 @@ public:
         }
 
         *cur++ = p;
-        if (cur == end) {
-            chunks.push_back(start);
-            get_chunk();
-        }
+        if (cur == end)
+            push_chunk();
+    }
+
+    // Generational mode: trace an old object again, even though it's already marked.
+    void pushOld(void* p) {
+        assert(isMarked(GCAllocation::fromUserData(p)));
+
+        *cur++ = p;
+        if (cur == end)
+            push_chunk();
+    }
+
+    uint64_t takeMarkedBytes() {
+        uint64_t rtn = marked_bytes;
+        marked_bytes = 0;
+        return rtn;
+    }
+
+    void setRecordPushes(std::vector<void*>* v) {
+        assert(visit_type == TraceStackType::PromotingMarkPhase || visit_type == TraceStackType::MinorMarkPhase);
+        record_pushes = v;
     }
 
     void* pop_chunk_and_item() {
         release_chunk(start);
-        if (chunks.size()) {
-            pop_chunk();
+        if (pop_chunk()) {
             assert(cur == end);
             return *--cur; // no need for any bounds checks here since we're guaranteed we're CHUNK_SIZE from the start
         } else {
@@ -210,8 +375,34 @@ public:
 
         return pop_chunk_and_item();
     }
+
+    // Work-stealing support for the parallel mark phase.  Only full chunks are ever handed out,
+    // and the owner of the stack keeps working on its current chunk.
+    bool hasStealableWork() { return num_chunks.load() > 0; }
+
+    bool stealFrom(TraceStack* victim) {
+        assert(cur == start && "should only steal when out of work");
+
+        void** stolen;
+        {
+            LOCK_REGION(&victim->chunks_lock);
+            if (victim->chunks.empty())
+                return false;
+
+            stolen = victim->chunks.front();
+            victim->chunks.pop_front();
+            victim->num_chunks--;
+        }
+
+        release_chunk(start);
+        start = stolen;
+        end = start + CHUNK_SIZE;
+        cur = end;
+        return true;
+    }
 };
 std::vector<void**> TraceStack::free_chunks;
+threading::PthreadSpinLock TraceStack::free_chunks_lock;
 
 void registerPermanentRoot(void* obj, bool allow_duplicates) {
     assert(global_heap.getAllocationFromInteriorPointer(obj));
@@ -242,6 +433,11 @@ extern "C" PyObject* PyGC_AddRoot(PyObject* obj) noexcept {
     return obj;
 }
 
+extern "C" void PyGC_RegisterWeakref(PyObject* wr) noexcept {
+    assert(PyWeakref_Check(wr));
+    all_weakrefs.insert((PyWeakReference*)wr);
+}
+
 void registerNonheapRootObject(void* obj, int size) {
     // I suppose that things could work fine even if this were true, but why would it happen?
     assert(global_heap.getAllocationFromInteriorPointer(obj) == NULL);
@@ -411,9 +607,16 @@ static __attribute__((always_inline)) void visitByGCKind(void* p, GCVisitor& vis
     }
 }
 
-static void markRoots(GCVisitor& visitor) {
+// If stack_references is set, everything directly referenced from the thread stacks gets added to it.
+static void markRoots(GCVisitor& visitor, std::vector<void*>* stack_references = NULL) {
     GC_TRACE_LOG("Looking at the stack\n");
-    threading::visitAllStacks(&visitor);
+    if (stack_references) {
+        visitor.stack->setRecordPushes(stack_references);
+        threading::visitAllStacks(&visitor);
+        visitor.stack->setRecordPushes(NULL);
+    } else {
+        threading::visitAllStacks(&visitor);
+    }
 
     GC_TRACE_LOG("Looking at root handles\n");
     for (auto h : *getRootHandles()) {
@@ -509,25 +712,204 @@ static void orderFinalizers() {
     sc_us.log(us);
 }
 
+// Parallel mark phase support.
+//
+// The collecting thread plus up to (GC_MARK_THREADS - 1) helper threads each trace from their own
+// TraceStack, and threads that run out of work steal full chunks from the other threads' stacks.
+// A thread only goes idle once its own stack is empty, and only the owner of a stack can add work
+// to it, so once every thread is idle the traversal is done.
+//
+// The helper threads are not Python threads; they only do anything during the mark phase, while
+// the collecting thread holds the GIL and the rest of the world is stopped.
+class ParallelMarker {
+private:
+    static const int MAX_THREADS = 64;
+
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t traversal_started = PTHREAD_COND_INITIALIZER;
+    pthread_cond_t traversal_done = PTHREAD_COND_INITIALIZER;
+
+    // Guarded by mutex:
+    int num_helpers = 0;
+    pid_t helpers_pid = 0; // helper threads don't survive a fork()
+    int64_t generation = 0;
+    int num_participating = 0;
+    int helpers_running = 0;
+
+    // stacks[0] belongs to the collecting thread, and the rest are owned by the helpers.
+    TraceStack* stacks[MAX_THREADS];
+    std::atomic<int> num_idle;
+    std::atomic<uint64_t> num_marked;
+    // Objects marked by the helper threads' stacks:
+    std::atomic<uint64_t> helper_marked_bytes;
+
+    static void* helperMain(void* arg);
+
+    bool steal(int id) {
+        for (int i = 1; i < num_participating; i++) {
+            TraceStack* victim = stacks[(id + i) % num_participating];
+            if (victim->hasStealableWork() && stacks[id]->stealFrom(victim))
+                return true;
+        }
+        return false;
+    }
+
+    bool anyStealableWork() {
+        for (int i = 0; i < num_participating; i++) {
+            if (stacks[i]->hasStealableWork())
+                return true;
+        }
+        return false;
+    }
+
+    void work(int id) {
+        static StatCounter sc_steals("gc_mark_steals");
+
+        TraceStack* stack = stacks[id];
+        GCVisitor visitor(stack);
+        uint64_t nmarked = 0;
+        uint64_t nsteals = 0;
+
+        while (true) {
+            while (void* p = stack->pop()) {
+                nmarked++;
+
+                assert(isMarked(GCAllocation::fromUserData(p)));
+                visitByGCKind(p, visitor);
+            }
+
+            if (steal(id)) {
+                nsteals++;
+                continue;
+            }
+
+            num_idle++;
+            bool done = false;
+            while (true) {
+                if (num_idle.load() == num_participating) {
+                    done = true;
+                    break;
+                }
+                if (anyStealableWork()) {
+                    num_idle--;
+                    break;
+                }
+                sched_yield();
+            }
+            if (done)
+                break;
+        }
+
+        num_marked += nmarked;
+        if (id != 0)
+            helper_marked_bytes += stack->takeMarkedBytes();
+        sc_steals.log(nsteals);
+    }
+
+    void startHelpers(int nhelpers) {
+        if (helpers_pid != getpid()) {
+            // We forked since starting the helpers, so they're gone:
+            num_helpers = 0;
+            helpers_pid = getpid();
+        }
+
+        while (num_helpers < nhelpers) {
+            int id = ++num_helpers;
+            stacks[id] = new TraceStack(TraceStackType::ParallelMarkPhase);
+
+            pthread_t thread_id;
+            int code = pthread_create(&thread_id, NULL, &ParallelMarker::helperMain, (void*)(intptr_t)id);
+            RELEASE_ASSERT(code == 0, "");
+            pthread_detach(thread_id);
+        }
+    }
+
+public:
+    ParallelMarker() : num_idle(0), num_marked(0), helper_marked_bytes(0) {}
+
+    static int numThreads() { return std::max(1, std::min((int)GC_MARK_THREADS, MAX_THREADS)); }
+
+    // Returns the number of objects that were traced.
+    uint64_t traverse(TraceStack* main_stack) {
+        int nthreads = numThreads();
+        assert(nthreads > 1);
+
+        pthread_mutex_lock(&mutex);
+        startHelpers(nthreads - 1);
+
+        stacks[0] = main_stack;
+        num_participating = nthreads;
+        helpers_running = nthreads - 1;
+        num_idle = 0;
+        num_marked = 0;
+        generation++;
+        pthread_cond_broadcast(&traversal_started);
+        pthread_mutex_unlock(&mutex);
+
+        work(0);
+
+        pthread_mutex_lock(&mutex);
+        while (helpers_running)
+            pthread_cond_wait(&traversal_done, &mutex);
+        pthread_mutex_unlock(&mutex);
+
+        return num_marked;
+    }
+
+    uint64_t takeHelperMarkedBytes() { return helper_marked_bytes.exchange(0); }
+};
+static ParallelMarker parallel_marker;
+
+void* ParallelMarker::helperMain(void* arg) {
+    int id = (int)(intptr_t)arg;
+    ParallelMarker* self = &parallel_marker;
+
+    // We get started while holding the mutex, and the traversal that wanted us is about to begin:
+    pthread_mutex_lock(&self->mutex);
+    int64_t seen_generation = self->generation - 1;
+
+    while (true) {
+        while (self->generation == seen_generation || id >= self->num_participating) {
+            seen_generation = self->generation;
+            pthread_cond_wait(&self->traversal_started, &self->mutex);
+        }
+        seen_generation = self->generation;
+        pthread_mutex_unlock(&self->mutex);
+
+        self->work(id);
+
+        pthread_mutex_lock(&self->mutex);
+        self->helpers_running--;
+        if (self->helpers_running == 0)
+            pthread_cond_signal(&self->traversal_done);
+    }
+
+    return NULL;
+}
+
 static void graphTraversalMarking(TraceStack& stack, GCVisitor& visitor) {
     static StatCounter sc_us("us_gc_mark_phase_graph_traversal");
     static StatCounter sc_marked_objs("gc_marked_object_count");
     Timer _t("traversing", /*min_usec=*/10000);
 
-    while (void* p = stack.pop()) {
-        sc_marked_objs.log();
+    if (ParallelMarker::numThreads() > 1 && !GC_GENERATIONAL) {
+        sc_marked_objs.log(parallel_marker.traverse(&stack));
+    } else {
+        while (void* p = stack.pop()) {
+            sc_marked_objs.log();
 
-        GCAllocation* al = GCAllocation::fromUserData(p);
+            GCAllocation* al = GCAllocation::fromUserData(p);
 
 #if TRACE_GC_MARKING
-        if (al->kind_id == GCKind::PYTHON || al->kind_id == GCKind::CONSERVATIVE_PYTHON)
-            GC_TRACE_LOG("Looking at %s object %p\n", static_cast<Box*>(p)->cls->tp_name, p);
-        else
-            GC_TRACE_LOG("Looking at non-python allocation %p\n", p);
+            if (al->kind_id == GCKind::PYTHON || al->kind_id == GCKind::CONSERVATIVE_PYTHON)
+                GC_TRACE_LOG("Looking at %s object %p\n", static_cast<Box*>(p)->cls->tp_name, p);
+            else
+                GC_TRACE_LOG("Looking at non-python allocation %p\n", p);
 #endif
 
-        assert(isMarked(al));
-        visitByGCKind(p, visitor);
+            assert(isMarked(al));
+            visitByGCKind(p, visitor);
+        }
     }
 
     long us = _t.end();
@@ -598,6 +980,9 @@ static void callPendingWeakrefCallbacks() {
 }
 
 void callPendingDestructionLogic() {
+    // The pending lists (and callingPending) are shared between all the threads:
+    threading::GLPromoteRegion _lock;
+
     static bool callingPending = false;
 
     // Calling finalizers is likely going to lead to another call to allowGLReadPreemption
@@ -629,7 +1014,101 @@ static void prepareWeakrefCallbacks(Box* box) {
     }
 }
 
-static void markPhase() {
+// Take care of the weakly-referenced garbage right after the mark phase, instead of waiting for the sweep
+// phase to come across it: with lazy sweeping that could be much later, and until then the weakrefs would
+// keep handing out the dead objects.
+static void handleDeadWeakrefs() {
+    static StatCounter sc_us("us_gc_handle_dead_weakrefs");
+    Timer _t("handleDeadWeakrefs", /*min_usec=*/10000);
+
+    // First unlink the weakrefs that are garbage themselves.  Their callbacks shouldn't get called, and they
+    // shouldn't be left around in the weakref lists of live objects until their block gets swept.
+    for (auto it = all_weakrefs.begin(); it != all_weakrefs.end();) {
+        PyWeakReference* wr = *it;
+        if (!isMarked(GCAllocation::fromUserData(wr))) {
+            if (wr->wr_object != Py_None)
+                _PyWeakref_ClearRef(wr);
+            it = all_weakrefs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (PyWeakReference* wr : all_weakrefs) {
+        // If several weakrefs point to the same garbage object, only the first one we look at will still
+        // have wr_object set.
+        Box* referent = wr->wr_object;
+        if (referent == Py_None)
+            continue;
+
+        // The referent could be a nonheap object, in which case it's never garbage:
+        GCAllocation* al = global_heap.getAllocationFromInteriorPointer(referent);
+        if (!al || isMarked(al))
+            continue;
+
+        // Same as what runCollection() does with the weakly_referenced list:
+        prepareWeakrefCallbacks(referent);
+        global_heap.free(al);
+    }
+
+    sc_us.log(_t.end());
+}
+
+// Whether p is still an old object; objects can get freed explicitly (and their memory reused) at any time.
+static bool isOldObject(void* p) {
+    GCAllocation* al = global_heap.getAllocationFromInteriorPointer(p);
+    return al && al->user_data == p && isMarked(al);
+}
+
+// Minor collections: push the old objects that might point to young ones.
+static void pushOldObjects(TraceStack& stack) {
+    static StatCounter sc_remembered("gc_minor_remembered_objects");
+    static StatCounter sc_unbarriered("gc_minor_unbarriered_objects");
+
+    std::vector<void*> remembered;
+    std::swap(remembered, remembered_set);
+    for (void* p : remembered) {
+        if (!isOldObject(p) || !isRemembered(GCAllocation::fromUserData(p)))
+            continue;
+
+        clearRemembered(GCAllocation::fromUserData(p));
+        stack.pushOld(p);
+        sc_remembered.log();
+    }
+
+    old_unbarriered_objects.erase(
+        std::remove_if(old_unbarriered_objects.begin(), old_unbarriered_objects.end(),
+                       [](void* p) { return !isOldObject(p); }),
+        old_unbarriered_objects.end());
+    for (void* p : old_unbarriered_objects) {
+        stack.pushOld(p);
+    }
+    sc_unbarriered.log(old_unbarriered_objects.size());
+}
+
+// Objects that are referenced from the stack might be in the middle of getting initialized (for instance,
+// C code filling in a tuple), which doesn't go through the write barriers.  So rescan them during the next
+// minor collection as well.
+static void rememberStackReferences(const std::vector<void*>& stack_references) {
+    // At this point, remembered_set only has the precise arrays from this minor collection:
+    for (void* p : remembered_set) {
+        clearRemembered(GCAllocation::fromUserData(p));
+    }
+    remembered_set.clear();
+
+    for (void* p : stack_references) {
+        GCAllocation* al = GCAllocation::fromUserData(p);
+        assert(isMarked(al));
+
+        if (isRemembered(al) || (al->kind_id != GCKind::PYTHON && al->kind_id != GCKind::PRECISE))
+            continue;
+        if (al->kind_id == GCKind::PYTHON && needsRescanning(al))
+            continue;
+        remember(al);
+    }
+}
+
+static void markPhase(bool minor) {
     static StatCounter sc_us("us_gc_mark_phase");
     Timer _t("markPhase", /*min_usec=*/10000);
 
@@ -641,11 +1120,29 @@ static void markPhase() {
 
     GC_TRACE_LOG("Starting collection %d\n", ncollections);
 
+    if (GC_GENERATIONAL && !minor) {
+        // Make everything young again:
+        global_heap.clearMarks();
+        remembered_set.clear();
+        old_unbarriered_objects.clear();
+    }
+
     GC_TRACE_LOG("Looking at roots\n");
-    TraceStack stack(TraceStackType::MarkPhase, roots);
+    TraceStackType stack_type;
+    if (minor)
+        stack_type = TraceStackType::MinorMarkPhase;
+    else if (GC_GENERATIONAL)
+        stack_type = TraceStackType::PromotingMarkPhase;
+    else
+        stack_type = ParallelMarker::numThreads() > 1 ? TraceStackType::ParallelMarkPhase : TraceStackType::MarkPhase;
+    TraceStack stack(stack_type, roots);
     GCVisitor visitor(&stack);
 
-    markRoots(visitor);
+    if (minor)
+        pushOldObjects(stack);
+
+    std::vector<void*> stack_references;
+    markRoots(visitor, GC_GENERATIONAL ? &stack_references : NULL);
 
     graphTraversalMarking(stack, visitor);
 
@@ -684,6 +1181,12 @@ static void markPhase() {
     // pending finalization list.
     orderFinalizers();
 
+    if (GC_GENERATIONAL)
+        rememberStackReferences(stack_references);
+
+    uint64_t marked_bytes = stack.takeMarkedBytes() + parallel_marker.takeHelperMarkedBytes();
+    live_bytes = minor ? live_bytes + marked_bytes : marked_bytes;
+
 #if TRACE_GC_MARKING
     fclose(trace_fp);
     trace_fp = NULL;
@@ -721,6 +1224,28 @@ void disableGC() {
     gc_enabled = false;
 }
 
+void updateCollectionTrigger() {
+    static StatCounter sc_disabled("gc_trigger_disabled");
+    static StatCounter sc_min_bytes("gc_trigger_min_bytes");
+    static StatCounter sc_heap_growth("gc_trigger_heap_growth");
+
+    if (GC_MIN_BYTES_PER_COLLECTION <= 0) {
+        // Like gc.set_threshold(0) in CPython: no more automatic collections.
+        sc_disabled.log();
+        bytesPerCollection = std::numeric_limits<size_t>::max();
+        return;
+    }
+
+    uint64_t growth_bytes = live_bytes * std::max(GC_HEAP_GROWTH_PERCENT, 0) / 100;
+    if (growth_bytes > (uint64_t)GC_MIN_BYTES_PER_COLLECTION) {
+        sc_heap_growth.log();
+        bytesPerCollection = growth_bytes;
+    } else {
+        sc_min_bytes.log();
+        bytesPerCollection = GC_MIN_BYTES_PER_COLLECTION;
+    }
+}
+
 void startGCUnexpectedRegion() {
     RELEASE_ASSERT(!should_not_reenter_gc, "");
     should_not_reenter_gc = true;
@@ -731,7 +1256,7 @@ void endGCUnexpectedRegion() {
     should_not_reenter_gc = false;
 }
 
-void runCollection() {
+static void _runCollection(bool force_major) {
     static StatCounter sc_us("us_gc_collections");
     static StatCounter sc("gc_collections");
     sc.log();
@@ -740,8 +1265,19 @@ void runCollection() {
 
     ncollections++;
 
+    bool minor = GC_GENERATIONAL && !force_major && minor_collections_since_major < GC_MINOR_COLLECTIONS_PER_MAJOR;
+    if (minor) {
+        static StatCounter sc_minor("gc_minor_collections");
+        sc_minor.log();
+        minor_collections_since_major++;
+    } else if (GC_GENERATIONAL) {
+        static StatCounter sc_major("gc_major_collections");
+        sc_major.log();
+        minor_collections_since_major = 0;
+    }
+
     if (VERBOSITY("gc") >= 2)
-        printf("Collection #%d\n", ncollections);
+        printf("Collection #%d%s\n", ncollections, minor ? " (minor)" : "");
 
     // The bulk of the GC work is not reentrant-safe.
     // In theory we should never try to reenter that section, but it's happened due to bugs,
@@ -772,13 +1308,19 @@ void runCollection() {
     // inside a finalizer call. To be safe, it's better to invalidate the list again.
     invalidateOrderedFinalizerList();
 
-    markPhase();
+    markPhase(minor);
+
+    // Weakly-referenced garbage is normally dealt with here, since the sweep phase might be lazy.
+    handleDeadWeakrefs();
 
     // The sweep phase will not free weakly-referenced objects, so that we can inspect their
     // weakrefs_list.  We want to defer looking at those lists until the end of the sweep phase,
     // since the deallocation of other objects (namely, the weakref objects themselves) can affect
     // those lists, and we want to see the final versions.
+    // (handleDeadWeakrefs() should have already taken care of all of these, so this is only a fallback.)
     std::vector<Box*> weakly_referenced;
+    global_heap.sweep_keeps_marks = GC_GENERATIONAL;
+    global_heap.sweep_nursery_only = minor;
     sweepPhase(weakly_referenced);
 
     // Handle weakrefs in two passes:
@@ -801,8 +1343,12 @@ void runCollection() {
 
     global_heap.cleanupAfterCollection();
 
-    if (VERBOSITY("gc") >= 2)
+    updateCollectionTrigger();
+
+    if (VERBOSITY("gc") >= 2) {
+        printf("%ld bytes survived, next collection after %ld more bytes\n", live_bytes, bytesPerCollection);
         printf("Collection #%d done\n\n", ncollections);
+    }
 
     long us = _t.end();
     sc_us.log(us);
@@ -810,5 +1356,13 @@ void runCollection() {
     // dumpHeapStatistics();
 }
 
+void runCollection() {
+    _runCollection(false);
+}
+
+void runMajorCollection() {
+    _runCollection(true);
+}
+
 } // namespace gc
 } // namespace pyston
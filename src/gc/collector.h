@@ -65,6 +65,13 @@ public:
 
 void callPendingDestructionLogic();
 void runCollection();
+// Same as runCollection(), except that in generational mode (GC_GENERATIONAL) this is always a major collection.
+void runMajorCollection();
+
+// Decides how much allocation should trigger the next collection: GC_HEAP_GROWTH_PERCENT of the memory that
+// survived the last collection, but at least GC_MIN_BYTES_PER_COLLECTION.  Called after every collection,
+// and by gc.set_threshold().
+void updateCollectionTrigger();
 
 // Python programs are allowed to pause the GC.  This is supposed to pause automatic GC,
 // but does not seem to pause manual calls to gc.collect().  So, callers should check gcIsEnabled(),
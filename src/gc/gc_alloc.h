@@ -101,6 +101,9 @@ extern "C" inline void* gc_alloc(size_t bytes, GCKind kind_id) {
         ((Box*)r)->cls = NULL;
     }
 
+    if (unlikely(--heap_profile_countdown == 0))
+        heapProfilerSample(alloc, bytes);
+
 #ifndef NDEBUG
 // I think I have a suspicion: the gc will see the constant and treat it as a
 // root.  So instead, shift to hide the pointer
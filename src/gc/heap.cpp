@@ -17,8 +17,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <unordered_set>
 
 #include "core/common.h"
+#include "core/options.h"
 #include "core/util.h"
 #include "gc/gc_alloc.h"
 #include "runtime/objmodel.h"
@@ -87,13 +90,16 @@ template <class ListT, typename Func> inline void forEach(ListT* list, Func func
 }
 
 template <class ListT, typename Free>
-inline void sweepList(ListT* head, std::vector<Box*>& weakly_referenced, Free free_func) {
+inline void sweepList(ListT* head, std::vector<Box*>& weakly_referenced, bool keep_marks, Free free_func) {
     auto cur = head;
     while (cur) {
         GCAllocation* al = cur->data;
         clearOrderingState(al);
         if (isMarked(al)) {
-            clearMark(al);
+            if (!keep_marks)
+                clearMark(al);
+            if (unlikely(isHeapSampled(al)))
+                heapProfilerSurvived(al);
             cur = cur->next;
         } else {
             if (_doFree(al, &weakly_referenced)) {
@@ -109,7 +115,8 @@ inline void sweepList(ListT* head, std::vector<Box*>& weakly_referenced, Free fr
     }
 }
 
-unsigned bytesAllocatedSinceCollection;
+size_t bytesAllocatedSinceCollection;
+size_t bytesPerCollection = GC_MIN_BYTES_PER_COLLECTION;
 static StatCounter gc_registered_bytes("gc_registered_bytes");
 void _bytesAllocatedTripped() {
     gc_registered_bytes.log(bytesAllocatedSinceCollection);
@@ -188,6 +195,9 @@ __attribute__((always_inline)) bool _doFree(GCAllocation* al, std::vector<Box*>*
         ASSERT(!hasOrderedFinalizer(b->cls) || hasFinalized(al) || alloc_kind == GCKind::CONSERVATIVE_PYTHON, "%s",
                getTypeName(b));
 
+        if (unlikely(isHeapSampled(al)))
+            heapProfilerFreed(al);
+
         if (b->cls->tp_dealloc != dealloc_null && b->cls->has_safe_tp_dealloc) {
             gc_safe_destructors.log();
 
@@ -198,6 +208,8 @@ __attribute__((always_inline)) bool _doFree(GCAllocation* al, std::vector<Box*>*
             // Don't bother setting the finalized flag since the object is getting freed right now.
             b->cls->tp_dealloc(b);
         }
+    } else if (unlikely(isHeapSampled(al))) {
+        heapProfilerFreed(al);
     }
     return true;
 }
@@ -236,8 +248,15 @@ struct HeapStatistics {
     TypeStats python, conservative, conservative_python, untracked, hcls, precise;
     TypeStats total;
 
+    // Number of SmallArena blocks, and how many of them haven't been (lazily) swept since the last collection:
+    int64_t num_small_blocks, num_unswept_blocks;
+
     HeapStatistics(bool collect_cls_stats, bool collect_hcls_stats)
-        : collect_cls_stats(collect_cls_stats), collect_hcls_stats(collect_hcls_stats), num_hcls_by_attrs_exceed(0) {
+        : collect_cls_stats(collect_cls_stats),
+          collect_hcls_stats(collect_hcls_stats),
+          num_hcls_by_attrs_exceed(0),
+          num_small_blocks(0),
+          num_unswept_blocks(0) {
         memset(num_hcls_by_attrs, 0, sizeof(num_hcls_by_attrs));
     }
 };
@@ -336,6 +355,11 @@ void Heap::dumpHeapStatistics(int level) {
     }
 
     stats.total.print("Total");
+    fprintf(stderr, "%ld of %ld small-object blocks still need to be swept\n", stats.num_unswept_blocks,
+            stats.num_small_blocks);
+    fprintf(stderr, "%.1fMB of empty heap blocks currently returned to the OS (%.1fMB returned in total)\n",
+            (small_arena.releasedBytes() + large_arena.releasedBytes()) / 1024.0 / 1024.0,
+            reclaimed_bytes / 1024.0 / 1024.0);
 
     if (collect_hcls_stats) {
         fprintf(stderr, "%ld hidden classes currently alive\n", stats.hcls.nallocs);
@@ -354,6 +378,20 @@ void dumpHeapStatistics(int level) {
     global_heap.dumpHeapStatistics(level);
 }
 
+void Heap::releaseFreeMemory() {
+    static StatCounter sc_us("us_gc_release_free_memory");
+    static StatCounter sc_bytes("gc_reclaimed_bytes");
+    Timer _t("releaseFreeMemory", /*min_usec=*/10000);
+
+    size_t retain_bytes = std::max(GC_FREE_MEMORY_WATERMARK, 0);
+    size_t released = small_arena.releaseFreeMemory(&retain_bytes);
+    released += large_arena.releaseFreeMemory(&retain_bytes);
+
+    reclaimed_bytes += released;
+    sc_bytes.log(released);
+    sc_us.log(_t.end());
+}
+
 //////
 /// Small Arena
 
@@ -414,6 +452,10 @@ GCAllocation* SmallArena::allocationFrom(void* ptr) {
 void SmallArena::freeUnmarked(std::vector<Box*>& weakly_referenced) {
     thread_caches.forEachValue([this, &weakly_referenced](ThreadBlockCache* cache) {
         for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
+            // Any objects allocated since the last collection are in blocks that are in a thread cache:
+            forEach(cache->cache_free_heads[bidx], [](Block* b) { b->in_nursery = true; });
+            forEach(cache->cache_full_heads[bidx], [](Block* b) { b->in_nursery = true; });
+
             Block* h = cache->cache_free_heads[bidx];
             // Try to limit the amount of unused memory a thread can hold onto;
             // currently pretty dumb, just limit the number of blocks in the free-list
@@ -455,6 +497,8 @@ void SmallArena::freeUnmarked(std::vector<Box*>& weakly_referenced) {
 
 // TODO: copy-pasted from freeUnmarked()
 void SmallArena::getStatistics(HeapStatistics* stats) {
+    _flushBumpRegions();
+
     thread_caches.forEachValue([this, stats](ThreadBlockCache* cache) {
         for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
             Block* h = cache->cache_free_heads[bidx];
@@ -473,47 +517,194 @@ void SmallArena::getStatistics(HeapStatistics* stats) {
 
 SmallArena::Block** SmallArena::_freeChain(Block** head, std::vector<Box*>& weakly_referenced) {
     while (Block* b = *head) {
+        // After a minor collection, everything outside of the nursery is either free or old (and still
+        // marked), so there's nothing to sweep there.
+        if (!heap->sweep_nursery_only || b->in_nursery) {
+            // With lazy sweeping, the block gets swept the next time someone tries to allocate from it
+            // (or at the start of the next collection, whichever comes first).  The collector has already
+            // dealt with any unmarked objects that were weakly referenced, so we won't need the
+            // weakly_referenced list for those blocks.
+            if (GC_LAZY_SWEEP)
+                b->needs_sweep = true;
+            else
+                _sweepBlock(b, &weakly_referenced);
+        }
+        b->in_nursery = false;
+
+        head = &b->next;
+    }
+    return head;
+}
+
+void SmallArena::_sweepBlock(Block* b, std::vector<Box*>* weakly_referenced) {
+    int num_objects = b->numObjects();
+    int first_obj = b->minObjIndex();
+    int atoms_per_obj = b->atomsPerObj();
+
+    for (int atom_idx = first_obj * atoms_per_obj; atom_idx < num_objects * atoms_per_obj; atom_idx += atoms_per_obj) {
+
+        // Note(kmod): it seems like there's some optimizations that could happen in this
+        // function -- isSet() and set() do roughly the same computation, and set() will
+        // load the value again before or'ing it and storing it back.
+        // I tried looking into a bunch of that and it didn't seem to make that much
+        // of a difference; my guess is that this function is memory-bound so a few
+        // extra shifts doesn't hurt.
+        if (b->isfree.isSet(atom_idx))
+            continue;
+
+        void* p = &b->atoms[atom_idx];
+        GCAllocation* al = reinterpret_cast<GCAllocation*>(p);
+
+        clearOrderingState(al);
+        if (isMarked(al)) {
+            if (!heap->sweep_keeps_marks)
+                clearMark(al);
+            if (unlikely(isHeapSampled(al)))
+                heapProfilerSurvived(al);
+        } else {
+            if (_doFree(al, weakly_referenced)) {
+                GC_TRACE_LOG("freeing %p\n", al->user_data);
+                b->isfree.set(atom_idx);
+#ifndef NDEBUG
+                memset(al->user_data, 0xbb, b->size - sizeof(GCAllocation));
+#endif
+            }
+        }
+    }
+
+    // Objects might have been freed before the scanner's current position:
+    b->next_to_check.reset();
+    b->needs_sweep = false;
+}
+
+void SmallArena::_sweepChain(Block** head) {
+    while (Block* b = *head) {
+        if (b->needs_sweep)
+            _sweepBlock(b, NULL);
+        head = &b->next;
+    }
+}
+
+void SmallArena::prepareForCollection() {
+    // Any blocks that nobody allocated from since the last collection still have last collection's
+    // mark bits (and garbage) in them, so finish sweeping them before we start marking again.
+    finishLazySweep();
+}
+
+void SmallArena::finishLazySweep() {
+    static StatCounter sc_us("us_gc_sweep_unswept_blocks");
+    Timer _t("finishing lazy sweep", /*min_usec=*/10000);
+
+    _flushBumpRegions();
+
+    thread_caches.forEachValue([this](ThreadBlockCache* cache) {
+        for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
+            _sweepChain(&cache->cache_free_heads[bidx]);
+            _sweepChain(&cache->cache_full_heads[bidx]);
+        }
+    });
+
+    for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
+        _sweepChain(&heads[bidx]);
+        _sweepChain(&full_heads[bidx]);
+    }
+
+    sc_us.log(_t.end());
+}
+
+void SmallArena::_clearChainMarks(Block** head) {
+    while (Block* b = *head) {
+        assert(!b->needs_sweep);
+
         int num_objects = b->numObjects();
         int first_obj = b->minObjIndex();
         int atoms_per_obj = b->atomsPerObj();
 
         for (int atom_idx = first_obj * atoms_per_obj; atom_idx < num_objects * atoms_per_obj;
              atom_idx += atoms_per_obj) {
-
-            // Note(kmod): it seems like there's some optimizations that could happen in this
-            // function -- isSet() and set() do roughly the same computation, and set() will
-            // load the value again before or'ing it and storing it back.
-            // I tried looking into a bunch of that and it didn't seem to make that much
-            // of a difference; my guess is that this function is memory-bound so a few
-            // extra shifts doesn't hurt.
             if (b->isfree.isSet(atom_idx))
                 continue;
 
-            void* p = &b->atoms[atom_idx];
-            GCAllocation* al = reinterpret_cast<GCAllocation*>(p);
-
-            clearOrderingState(al);
-            if (isMarked(al)) {
+            GCAllocation* al = reinterpret_cast<GCAllocation*>(&b->atoms[atom_idx]);
+            if (isMarked(al))
                 clearMark(al);
-            } else {
-                if (_doFree(al, &weakly_referenced)) {
-                    GC_TRACE_LOG("freeing %p\n", al->user_data);
-                    b->isfree.set(atom_idx);
-#ifndef NDEBUG
-                    memset(al->user_data, 0xbb, b->size - sizeof(GCAllocation));
-#endif
-                }
-            }
+            if (isRemembered(al))
+                clearRemembered(al);
         }
 
         head = &b->next;
     }
-    return head;
 }
 
+// TODO: copy-pasted from prepareForCollection()
+void SmallArena::clearMarks() {
+    _flushBumpRegions();
+
+    thread_caches.forEachValue([this](ThreadBlockCache* cache) {
+        for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
+            _clearChainMarks(&cache->cache_free_heads[bidx]);
+            _clearChainMarks(&cache->cache_full_heads[bidx]);
+        }
+    });
+
+    for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
+        _clearChainMarks(&heads[bidx]);
+        _clearChainMarks(&full_heads[bidx]);
+    }
+}
+
+
+size_t SmallArena::releaseFreeMemory(size_t* retain_bytes) {
+    LOCK_REGION(heap->lock);
+
+    size_t released = 0;
+
+    // Only look at the global free lists; the blocks in the thread caches are the ones getting allocated from.
+    for (int bidx = 0; bidx < NUM_BUCKETS; bidx++) {
+        Block** prev = &heads[bidx];
+        while (Block* b = *prev) {
+            bool empty = !b->needs_sweep;
+            int atoms_per_obj = b->atomsPerObj();
+            for (int obj_idx = b->minObjIndex(); empty && obj_idx < b->numObjects(); obj_idx++) {
+                if (!b->isfree.isSet(obj_idx * atoms_per_obj))
+                    empty = false;
+            }
+
+            if (!empty || *retain_bytes >= BLOCK_SIZE) {
+                if (empty)
+                    *retain_bytes -= BLOCK_SIZE;
+                prev = &b->next;
+                continue;
+            }
+
+            removeFromLLAndNull(b);
+
+            // Keep the header page: conservative references into this block can still show up, and
+            // allocationFrom() needs the header (which says that everything is free) to deal with those.
+            int r = madvise((char*)b + PAGE_SIZE, BLOCK_SIZE - PAGE_SIZE, MADV_DONTNEED);
+            RELEASE_ASSERT(r == 0, "madvise failed: %d", errno);
+
+            released_blocks.push_back(b);
+            released += BLOCK_SIZE - PAGE_SIZE;
+        }
+    }
+
+    return released;
+}
+
+size_t SmallArena::releasedBytes() {
+    return released_blocks.size() * (BLOCK_SIZE - PAGE_SIZE);
+}
 
 SmallArena::Block* SmallArena::_allocBlock(uint64_t size, Block** prev) {
-    Block* rtn = (Block*)allocFromArena(sizeof(Block));
+    Block* rtn;
+    if (!released_blocks.empty()) {
+        // The released pages will come back zero-filled the next time they get touched.
+        rtn = released_blocks.back();
+        released_blocks.pop_back();
+    } else {
+        rtn = (Block*)allocFromArena(sizeof(Block));
+    }
     assert(rtn);
     rtn->size = size;
     rtn->num_obj = BLOCK_SIZE / size;
@@ -532,6 +723,8 @@ SmallArena::Block* SmallArena::_allocBlock(uint64_t size, Block** prev) {
     // Don't think I need to do this:
     rtn->isfree.setAllZero();
     rtn->next_to_check.reset();
+    rtn->needs_sweep = false;
+    rtn->in_nursery = false;
 
     int num_objects = rtn->numObjects();
     int num_lost = rtn->minObjIndex();
@@ -551,20 +744,31 @@ SmallArena::Block* SmallArena::_allocBlock(uint64_t size, Block** prev) {
 SmallArena::ThreadBlockCache::~ThreadBlockCache() {
     LOCK_REGION(heap->lock);
 
+    for (int i = 0; i < NUM_BUMP_BUCKETS; i++)
+        small->_flushBumpRegion(&bump_regions[i]);
+
     for (int i = 0; i < NUM_BUCKETS; i++) {
         while (Block* b = cache_free_heads[i]) {
             removeFromLLAndNull(b);
+            b->in_nursery = true;
             insertIntoLL(&small->heads[i], b);
         }
 
         while (Block* b = cache_full_heads[i]) {
             removeFromLLAndNull(b);
+            b->in_nursery = true;
             insertIntoLL(&small->full_heads[i], b);
         }
     }
 }
 
 GCAllocation* SmallArena::_allocFromBlock(Block* b) {
+    if (unlikely(b->needs_sweep)) {
+        static StatCounter sc("gc_lazily_swept_blocks");
+        sc.log();
+        _sweepBlock(b, NULL);
+    }
+
     int idx = b->isfree.scanForNext(b->next_to_check);
     if (idx == -1)
         return NULL;
@@ -583,13 +787,39 @@ SmallArena::Block* SmallArena::_claimBlock(size_t rounded_size, Block** free_hea
     return _allocBlock(rounded_size, NULL);
 }
 
+__thread SmallArena::BumpRegion* SmallArena::thread_bump_regions = NULL;
+
+void SmallArena::_flushBumpRegion(BumpRegion* region) {
+    if (region->cursor && region->cursor < region->limit) {
+        // Hand the part of the block that never got bumped into back to the free bitmap:
+        Block* b = Block::forPointer(region->cursor);
+        int atoms_per_obj = b->atomsPerObj();
+        int first_atom = (region->cursor - (char*)b) / ATOM_SIZE;
+        int end_atom = (region->limit - (char*)b) / ATOM_SIZE;
+        for (int atom_idx = first_atom; atom_idx < end_atom; atom_idx += atoms_per_obj)
+            b->isfree.set(atom_idx);
+        b->next_to_check.reset();
+    }
+
+    region->cursor = region->limit = NULL;
+}
+
+void SmallArena::_flushBumpRegions() {
+    thread_caches.forEachValue([this](ThreadBlockCache* cache) {
+        for (int bidx = 0; bidx < NUM_BUMP_BUCKETS; bidx++)
+            _flushBumpRegion(&cache->bump_regions[bidx]);
+    });
+}
+
 GCAllocation* SmallArena::_alloc(size_t rounded_size, int bucket_idx) {
     Block** free_head = &heads[bucket_idx];
     Block** full_head = &full_heads[bucket_idx];
 
     static __thread ThreadBlockCache* cache = NULL;
-    if (!cache)
+    if (!cache) {
         cache = thread_caches.get();
+        thread_bump_regions = cache->bump_regions;
+    }
 
     Block** cache_head = &cache->cache_free_heads[bucket_idx];
 
@@ -618,6 +848,24 @@ GCAllocation* SmallArena::_alloc(size_t rounded_size, int bucket_idx) {
 
         assert(*cache_head == NULL);
 
+        if (bucket_idx < NUM_BUMP_BUCKETS && !heads[bucket_idx]) {
+            static StatCounter sc_bump_blocks("gc_bump_blocks");
+            sc_bump_blocks.log();
+
+            // Nothing to reuse, so carve up a brand new block by bumping a pointer through it.  The block
+            // goes straight into the full list with every object marked as allocated; _flushBumpRegion()
+            // gives back whatever doesn't get used.
+            Block* b = _allocBlock(rounded_size, NULL);
+            b->isfree.setAllZero();
+            insertIntoLL(&cache->cache_full_heads[bucket_idx], b);
+
+            BumpRegion& region = cache->bump_regions[bucket_idx];
+            assert(!region.cursor || region.cursor == region.limit);
+            region.cursor = (char*)b + b->minObjIndex() * rounded_size + rounded_size;
+            region.limit = (char*)b + b->numObjects() * rounded_size;
+            return reinterpret_cast<GCAllocation*>((char*)b + b->minObjIndex() * rounded_size);
+        }
+
         // should probably be called allocBlock:
         Block* myblock = _claimBlock(rounded_size, &heads[bucket_idx]);
         assert(myblock);
@@ -630,9 +878,14 @@ GCAllocation* SmallArena::_alloc(size_t rounded_size, int bucket_idx) {
     }
 }
 
-// TODO: copy-pasted from _freeChain
+// TODO: copy-pasted from _sweepBlock
 void SmallArena::_getChainStatistics(HeapStatistics* stats, Block** head) {
     while (Block* b = *head) {
+        // Note: the objects in unswept blocks get counted regardless of whether they're garbage.
+        stats->num_small_blocks++;
+        if (b->needs_sweep)
+            stats->num_unswept_blocks++;
+
         int num_objects = b->numObjects();
         int first_obj = b->minObjIndex();
         int atoms_per_obj = b->atomsPerObj();
@@ -738,7 +991,16 @@ void LargeArena::cleanupAfterCollection() {
 }
 
 void LargeArena::freeUnmarked(std::vector<Box*>& weakly_referenced) {
-    sweepList(head, weakly_referenced, [this](LargeObj* ptr) { _freeLargeObj(ptr); });
+    sweepList(head, weakly_referenced, heap->sweep_keeps_marks, [this](LargeObj* ptr) { _freeLargeObj(ptr); });
+}
+
+void LargeArena::clearMarks() {
+    forEach(head, [](LargeObj* obj) {
+        if (isMarked(obj->data))
+            clearMark(obj->data);
+        if (isRemembered(obj->data))
+            clearRemembered(obj->data);
+    });
 }
 
 void LargeArena::getStatistics(HeapStatistics* stats) {
@@ -824,7 +1086,12 @@ retry:
     if (free_chunks)
         return (LargeObj*)free_chunks;
 
-    section = (LargeBlock*)allocFromArena(BLOCK_SIZE);
+    if (!released_blocks.empty()) {
+        section = released_blocks.back();
+        released_blocks.pop_back();
+    } else {
+        section = (LargeBlock*)allocFromArena(BLOCK_SIZE);
+    }
 
     if (!section)
         return NULL;
@@ -880,6 +1147,48 @@ void LargeArena::_freeLargeObj(LargeObj* obj) {
     add_free_chunk((LargeFreeChunk*)obj, size);
 }
 
+size_t LargeArena::releaseFreeMemory(size_t* retain_bytes) {
+    LOCK_REGION(heap->lock);
+
+    std::unordered_set<LargeBlock*> to_release;
+    LargeBlock** prev = &blocks;
+    while (LargeBlock* section = *prev) {
+        if (section->num_free_chunks != LARGE_BLOCK_NUM_CHUNKS || *retain_bytes >= BLOCK_SIZE) {
+            if (section->num_free_chunks == LARGE_BLOCK_NUM_CHUNKS)
+                *retain_bytes -= BLOCK_SIZE;
+            prev = &section->next;
+            continue;
+        }
+
+        *prev = section->next;
+        to_release.insert(section);
+    }
+
+    if (to_release.empty())
+        return 0;
+
+    // The free chunks in these blocks can't be handed out anymore:
+    for (int i = 0; i < NUM_FREE_LISTS; i++) {
+        LargeFreeChunk** list = &free_lists[i];
+        while (LargeFreeChunk* chunk = *list) {
+            if (to_release.count(LARGE_BLOCK_FOR_OBJ(chunk)))
+                *list = chunk->next_size;
+            else
+                list = &chunk->next_size;
+        }
+    }
+
+    for (LargeBlock* section : to_release) {
+        // The first chunk holds the block header; we reinitialize it when we reuse the block, but keep it mapped
+        // like the SmallArena does.
+        int r = madvise((char*)section + CHUNK_SIZE, BLOCK_SIZE - CHUNK_SIZE, MADV_DONTNEED);
+        RELEASE_ASSERT(r == 0, "madvise failed: %d", errno);
+        released_blocks.push_back(section);
+    }
+
+    return to_release.size() * (BLOCK_SIZE - CHUNK_SIZE);
+}
+
 //////
 /// Huge Arena
 
@@ -949,7 +1258,16 @@ void HugeArena::cleanupAfterCollection() {
 }
 
 void HugeArena::freeUnmarked(std::vector<Box*>& weakly_referenced) {
-    sweepList(head, weakly_referenced, [this](HugeObj* ptr) { _freeHugeObj(ptr); });
+    sweepList(head, weakly_referenced, heap->sweep_keeps_marks, [this](HugeObj* ptr) { _freeHugeObj(ptr); });
+}
+
+void HugeArena::clearMarks() {
+    forEach(head, [](HugeObj* obj) {
+        if (isMarked(obj->data))
+            clearMark(obj->data);
+        if (isRemembered(obj->data))
+            clearRemembered(obj->data);
+    });
 }
 
 void HugeArena::getStatistics(HeapStatistics* stats) {
@@ -21,8 +21,10 @@
 #include <sys/mman.h>
 
 #include "core/common.h"
+#include "core/options.h"
 #include "core/threading.h"
 #include "core/types.h"
+#include "gc/heap_profiler.h"
 
 namespace pyston {
 
@@ -75,8 +77,10 @@ class conservative_unordered_map
 
 namespace gc {
 
-extern unsigned bytesAllocatedSinceCollection;
-#define ALLOCBYTES_PER_COLLECTION 10000000
+extern size_t bytesAllocatedSinceCollection;
+// The amount of allocation that triggers the next collection.  This gets recomputed after every collection,
+// based on how much memory survived it; see updateCollectionTrigger().
+extern size_t bytesPerCollection;
 void _bytesAllocatedTripped();
 
 // Notify the gc of n bytes as being under GC management.
@@ -86,7 +90,7 @@ void _bytesAllocatedTripped();
 // such as memory that will get freed by a gc destructor.
 inline void registerGCManagedBytes(size_t bytes) {
     bytesAllocatedSinceCollection += bytes;
-    if (unlikely(bytesAllocatedSinceCollection >= ALLOCBYTES_PER_COLLECTION)) {
+    if (unlikely(bytesAllocatedSinceCollection >= bytesPerCollection)) {
         _bytesAllocatedTripped();
     }
 }
@@ -116,6 +120,10 @@ static_assert(sizeof(GCAllocation) <= sizeof(void*),
 // reserved bit - along with MARK_BIT, encodes the states of finalization order
 #define ORDERING_EXTRA_BIT 0x2
 #define FINALIZER_HAS_RUN_BIT 0x4
+// Generational mode: the object is in the remembered set (see writeBarrier()).
+#define REMEMBERED_BIT 0x8
+// The heap profiler sampled this allocation (see heap_profiler.h).
+#define HEAP_SAMPLED_BIT 0x10
 
 #define ORDERING_BITS (MARK_BIT | ORDERING_EXTRA_BIT)
 
@@ -137,6 +145,14 @@ inline void setMark(GCAllocation* header) {
     header->gc_flags |= MARK_BIT;
 }
 
+// Thread-safe version of setMark() for the parallel mark phase.  Returns whether this call was
+// the one that set the bit, ie whether the caller is responsible for tracing the object.
+// gc_flags is the first byte of the header, so we can do an atomic byte-sized or on it.
+inline bool trySetMarkAtomic(GCAllocation* header) {
+    uint8_t* flags = reinterpret_cast<uint8_t*>(header);
+    return (__atomic_fetch_or(flags, MARK_BIT, __ATOMIC_RELAXED) & MARK_BIT) == 0;
+}
+
 inline void clearMark(GCAllocation* header) {
     assert(isMarked(header));
     header->gc_flags &= ~MARK_BIT;
@@ -165,9 +181,33 @@ inline void clearOrderingState(GCAllocation* header) {
     header->gc_flags &= ~ORDERING_EXTRA_BIT;
 }
 
+inline bool isRemembered(GCAllocation* header) {
+    return (header->gc_flags & REMEMBERED_BIT) != 0;
+}
+
+inline void setRemembered(GCAllocation* header) {
+    assert(!isRemembered(header));
+    header->gc_flags |= REMEMBERED_BIT;
+}
+
+inline void clearRemembered(GCAllocation* header) {
+    assert(isRemembered(header));
+    header->gc_flags &= ~REMEMBERED_BIT;
+}
+
+inline bool isHeapSampled(GCAllocation* header) {
+    return (header->gc_flags & HEAP_SAMPLED_BIT) != 0;
+}
+
+inline void setHeapSampled(GCAllocation* header) {
+    header->gc_flags |= HEAP_SAMPLED_BIT;
+}
+
 #undef MARK_BIT
 #undef ORDERING_EXTRA_BIT
 #undef FINALIZER_HAS_RUN_BIT
+#undef REMEMBERED_BIT
+#undef HEAP_SAMPLED_BIT
 #undef ORDERING_BITS
 
 bool hasOrderedFinalizer(BoxedClass* cls);
@@ -222,6 +262,25 @@ constexpr uintptr_t SMALL_ARENA_START = 0x1270000000L;
 constexpr uintptr_t LARGE_ARENA_START = 0x2270000000L;
 constexpr uintptr_t HUGE_ARENA_START = 0x3270000000L;
 
+// Write barrier for the generational mode (GC_GENERATIONAL).  In that mode, objects that survive a collection
+// keep their mark bit and don't get traced again by minor collections, so whenever a reference gets stored
+// into an existing object, that object has to be passed to writeBarrier() afterwards.
+// Objects whose classes the collector doesn't trust to do this (see hasWriteBarriers() in collector.cpp)
+// get rescanned by every minor collection instead.
+void _rememberObject(GCAllocation* al);
+extern "C" inline void writeBarrier(void* obj) {
+    if (likely(!GC_GENERATIONAL))
+        return;
+
+    // Nonheap objects get scanned as roots anyway:
+    if ((uintptr_t)obj < SMALL_ARENA_START || (uintptr_t)obj >= HUGE_ARENA_START + ARENA_SIZE)
+        return;
+
+    GCAllocation* al = GCAllocation::fromUserData(obj);
+    if (isMarked(al) && !isRemembered(al))
+        _rememberObject(al);
+}
+
 
 //
 // The SmallArena allocates objects <= 3584 bytes.
@@ -250,13 +309,13 @@ public:
     GCAllocation* __attribute__((__malloc__)) alloc(size_t bytes) {
         registerGCManagedBytes(bytes);
         if (bytes <= 16)
-            return _alloc(16, 0);
+            return _allocFast(16, 0);
         else if (bytes <= 32)
-            return _alloc(32, 1);
+            return _allocFast(32, 1);
         else {
             for (int i = 2; i < NUM_BUCKETS; i++) {
                 if (sizes[i] >= bytes) {
-                    return _alloc(sizes[i], i);
+                    return _allocFast(sizes[i], i);
                 }
             }
             return NULL;
@@ -270,8 +329,18 @@ public:
     void freeUnmarked(std::vector<Box*>& weakly_referenced);
 
     void getStatistics(HeapStatistics* stats);
+    void clearMarks();
+
+    size_t allocationSize(GCAllocation* alloc) { return Block::forPointer(alloc)->size; }
 
-    void prepareForCollection() {}
+    // Returns the memory of empty blocks to the OS, once the amount of empty-block memory we've kept exceeds
+    // *retain_bytes (which gets decremented by what we keep).  Returns the number of bytes released.
+    size_t releaseFreeMemory(size_t* retain_bytes);
+    size_t releasedBytes();
+
+    // Sweeps every block that the last collection left to be swept lazily.
+    void finishLazySweep();
+    void prepareForCollection();
     void cleanupAfterCollection() {}
 
 private:
@@ -286,7 +355,7 @@ private:
 
         struct Scanner {
         private:
-            int64_t next_to_check;
+            int32_t next_to_check;
             friend class Bitmap<N>;
 
         public:
@@ -358,6 +427,12 @@ public:
                 uint8_t atoms_per_obj;
                 Bitmap<ATOMS_PER_BLOCK> isfree;
                 Bitmap<ATOMS_PER_BLOCK>::Scanner next_to_check;
+                // Set by freeUnmarked() when lazy sweeping is enabled: the unmarked objects in this block
+                // haven't been freed yet, and the block has to be swept before we can allocate from it.
+                bool needs_sweep;
+                // Whether the block might contain objects that were allocated since the last collection;
+                // minor collections only sweep these blocks.  Blocks in a thread cache always count.
+                bool in_nursery;
                 void* _header_end[0];
             };
             Atoms atoms[ATOMS_PER_BLOCK];
@@ -376,19 +451,50 @@ public:
     static_assert(offsetof(Block, _header_end) <= BLOCK_HEADER_SIZE, "bad header size");
 
 private:
+    // The smallest size classes (ints, floats, small tuples, ...) get allocated by bumping a pointer through
+    // blocks that a thread claimed fresh, rather than by scanning a block's free bitmap.  The objects in the
+    // rest of the region are already marked as allocated in the bitmap, so anything that looks at the bitmap
+    // has to call _flushBumpRegions() first to give them back.
+    static constexpr int NUM_BUMP_BUCKETS = 4;
+    struct BumpRegion {
+        char* cursor;
+        char* limit;
+    };
+
     struct ThreadBlockCache {
         Heap* heap;
         SmallArena* small;
         Block* cache_free_heads[NUM_BUCKETS];
         Block* cache_full_heads[NUM_BUCKETS];
+        BumpRegion bump_regions[NUM_BUMP_BUCKETS];
 
         ThreadBlockCache(Heap* heap, SmallArena* small) : heap(heap), small(small) {
             memset(cache_free_heads, 0, sizeof(cache_free_heads));
             memset(cache_full_heads, 0, sizeof(cache_full_heads));
+            memset(bump_regions, 0, sizeof(bump_regions));
         }
         ~ThreadBlockCache();
     };
 
+    // The current thread's bump regions (in its ThreadBlockCache), or NULL if it hasn't allocated yet.
+    static __thread BumpRegion* thread_bump_regions;
+
+    GCAllocation* _allocFast(size_t rounded_size, int bucket_idx) {
+        if (bucket_idx < NUM_BUMP_BUCKETS && likely(thread_bump_regions != NULL)) {
+            BumpRegion& region = thread_bump_regions[bucket_idx];
+            char* rtn = region.cursor;
+            // An unused region is all-NULL, so this fails for it too:
+            if (likely(rtn + rounded_size <= region.limit && rtn)) {
+                region.cursor = rtn + rounded_size;
+                return reinterpret_cast<GCAllocation*>(rtn);
+            }
+        }
+        return _alloc(rounded_size, bucket_idx);
+    }
+
+    void _flushBumpRegion(BumpRegion* region);
+    void _flushBumpRegions();
+
 
     Block* heads[NUM_BUCKETS];
     Block* full_heads[NUM_BUCKETS];
@@ -396,6 +502,9 @@ private:
     friend struct ThreadBlockCache;
 
     Heap* heap;
+    // Blocks whose memory (except for the header page) has been returned to the OS; _allocBlock() reuses these
+    // first.  Protected by heap->lock.
+    std::vector<Block*> released_blocks;
     // TODO only use thread caches if we're in GRWL mode?
     threading::PerThreadSet<ThreadBlockCache, Heap*, SmallArena*> thread_caches;
 
@@ -403,6 +512,9 @@ private:
     GCAllocation* _allocFromBlock(Block* b);
     Block* _claimBlock(size_t rounded_size, Block** free_head);
     Block** _freeChain(Block** head, std::vector<Box*>& weakly_referenced);
+    void _sweepBlock(Block* b, std::vector<Box*>* weakly_referenced);
+    void _sweepChain(Block** head);
+    void _clearChainMarks(Block** head);
     void _getChainStatistics(HeapStatistics* stats, Block** head);
 
     GCAllocation* __attribute__((__malloc__)) _alloc(size_t bytes, int bucket_idx);
@@ -466,6 +578,8 @@ private:
     Heap* heap;
     LargeObj* head;
     LargeBlock* blocks;
+    // Empty blocks whose memory (except for the header chunk) has been returned to the OS:
+    std::vector<LargeBlock*> released_blocks;
     LargeFreeChunk* free_lists[NUM_FREE_LISTS]; /* 0 is for larger sizes */
 
     void add_free_chunk(LargeFreeChunk* free_chunks, size_t size);
@@ -487,6 +601,13 @@ public:
     void freeUnmarked(std::vector<Box*>& weakly_referenced);
 
     void getStatistics(HeapStatistics* stats);
+    void clearMarks();
+
+    size_t allocationSize(GCAllocation* alloc) { return LargeObj::fromAllocation(alloc)->size; }
+
+    // Same as SmallArena::releaseFreeMemory(), but for completely empty large blocks.
+    size_t releaseFreeMemory(size_t* retain_bytes);
+    size_t releasedBytes() { return released_blocks.size() * (BLOCK_SIZE - CHUNK_SIZE); }
 
     void prepareForCollection();
     void cleanupAfterCollection();
@@ -508,6 +629,9 @@ public:
     void freeUnmarked(std::vector<Box*>& weakly_referenced);
 
     void getStatistics(HeapStatistics* stats);
+    void clearMarks();
+
+    size_t allocationSize(GCAllocation* alloc) { return HugeObj::fromAllocation(alloc)->size; }
 
     void prepareForCollection();
     void cleanupAfterCollection();
@@ -556,7 +680,21 @@ private:
     DS_DEFINE_SPINLOCK(lock);
 
 public:
-    Heap() : small_arena(this), large_arena(this), huge_arena(this) {}
+    // Set by the collector before sweeping, and they stay valid until the next collection (since blocks can get
+    // swept lazily until then): whether surviving objects should keep their mark bit (generational mode), and
+    // whether this was a minor collection, in which case only the nursery needs to be swept.
+    bool sweep_keeps_marks, sweep_nursery_only;
+
+    // The total number of bytes that releaseFreeMemory() returned to the OS.
+    uint64_t reclaimed_bytes;
+
+    Heap()
+        : small_arena(this),
+          large_arena(this),
+          huge_arena(this),
+          sweep_keeps_marks(false),
+          sweep_nursery_only(false),
+          reclaimed_bytes(0) {}
 
     GCAllocation* realloc(GCAllocation* alloc, size_t bytes) {
 
@@ -575,6 +713,17 @@ public:
             rtn = small_arena.realloc(alloc, bytes);
         }
 
+        // The arenas copy the header along with the data.  The new allocation shouldn't inherit a mark
+        // bit: with lazy sweeping, the old object's mark can still be set at this point.
+        if (rtn != alloc) {
+            bool sampled = isHeapSampled(rtn);
+            rtn->gc_flags = 0;
+            if (unlikely(sampled)) {
+                setHeapSampled(rtn);
+                heapProfilerMoved(alloc, rtn);
+            }
+        }
+
         return rtn;
     }
 
@@ -606,6 +755,16 @@ public:
         small_arena.free(alloc);
     }
 
+    // Doesn't modify the heap, so it's safe to call from the mark threads:
+    size_t allocationSize(GCAllocation* alloc) {
+        if (large_arena.contains(alloc))
+            return large_arena.allocationSize(alloc);
+        if (huge_arena.contains(alloc))
+            return huge_arena.allocationSize(alloc);
+        assert(small_arena.contains(alloc));
+        return small_arena.allocationSize(alloc);
+    }
+
     // not thread safe:
     GCAllocation* getAllocationFromInteriorPointer(void* ptr) {
         if (large_arena.contains(ptr)) {
@@ -626,18 +785,42 @@ public:
         huge_arena.freeUnmarked(weakly_referenced);
     }
 
+    // Clears the mark and remembered bits of every object; not thread safe:
+    void clearMarks() {
+        small_arena.clearMarks();
+        large_arena.clearMarks();
+        huge_arena.clearMarks();
+    }
+
+    // Frees all of the garbage from the last collection that lazy sweeping hasn't gotten to yet:
+    void finishLazySweep() {
+        small_arena.finishLazySweep();
+        releaseFreeMemory();
+    }
+
     void prepareForCollection() {
         small_arena.prepareForCollection();
         large_arena.prepareForCollection();
         huge_arena.prepareForCollection();
+
+        // Every block has been swept at this point, including the ones that the last collection left for later:
+        releaseFreeMemory();
     }
 
     void cleanupAfterCollection() {
         small_arena.cleanupAfterCollection();
         large_arena.cleanupAfterCollection();
         huge_arena.cleanupAfterCollection();
+
+        // The large objects and any eagerly-swept small blocks have been freed by now; the small blocks that are
+        // still waiting on the lazy sweep get released once they've been swept.
+        releaseFreeMemory();
     }
 
+    // Gives the memory of empty blocks back to the OS, keeping up to GC_FREE_MEMORY_WATERMARK bytes of it around
+    // for future allocations.  (Huge objects already get unmapped when they're freed.)
+    void releaseFreeMemory();
+
     void dumpHeapStatistics(int level);
 };
 
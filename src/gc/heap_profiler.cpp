@@ -0,0 +1,388 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gc/heap_profiler.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "codegen/unwinding.h"
+#include "core/common.h"
+#include "core/stats.h"
+#include "core/threading.h"
+#include "gc/collector.h"
+#include "gc/heap.h"
+#include "runtime/types.h"
+
+namespace pyston {
+namespace gc {
+
+// New threads check whether sampling is on with their first allocation:
+__thread uint64_t heap_profile_countdown = 1;
+
+namespace {
+
+// How many allocations a thread makes between checks of whether sampling has been turned on:
+static const uint64_t HEAP_PROFILE_RECHECK_INTERVAL = 1 << 20;
+
+// The sampling decisions are made per thread; the state for them:
+static __thread uint64_t rand_state = 0;
+
+class HeapProfiler {
+public:
+    struct Sample {
+        size_t bytes;
+        int site;
+        int type; // -1 until we've looked at the object
+    };
+
+    struct Counts {
+        int64_t alloc_objects, alloc_bytes;
+        int64_t inuse_objects, inuse_bytes;
+
+        Counts() : alloc_objects(0), alloc_bytes(0), inuse_objects(0), inuse_bytes(0) {}
+    };
+
+    // Protects everything below (other than interval), since with the GRWL several threads can be allocating, and
+    // sweeping, at once:
+    DS_DEFINE_MUTEX(lock);
+
+    int64_t interval;
+
+    // Call sites and type names, which are also the start of the pprof string table:
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, int> string_ids;
+
+    std::unordered_map<GCAllocation*, Sample> live;
+    // Keyed by (site, type):
+    std::map<std::pair<int, int>, Counts> counts;
+
+    HeapProfiler() : interval(0) { intern(""); }
+
+    int intern(const std::string& s) {
+        auto it = string_ids.find(s);
+        if (it != string_ids.end())
+            return it->second;
+        int id = strings.size();
+        strings.push_back(s);
+        string_ids[s] = id;
+        return id;
+    }
+
+    // Sets up this thread's countdown.
+    void scheduleNext() {
+        int64_t interval = this->interval;
+        if (!interval) {
+            heap_profile_countdown = HEAP_PROFILE_RECHECK_INTERVAL;
+            return;
+        }
+
+        if (!rand_state)
+            rand_state = 0x9e3779b97f4a7c15UL ^ (uint64_t)pthread_self();
+
+        // xorshift64; pick uniformly from [1, 2 * interval) so that the average spacing is the interval.
+        rand_state ^= rand_state << 13;
+        rand_state ^= rand_state >> 7;
+        rand_state ^= rand_state << 17;
+        heap_profile_countdown = 1 + rand_state % (2 * interval - 1);
+    }
+
+    static std::string typeName(GCAllocation* al) {
+        switch (al->kind_id) {
+            case GCKind::PYTHON:
+            case GCKind::CONSERVATIVE_PYTHON: {
+                Box* b = (Box*)al->user_data;
+                if (!b->cls)
+                    return "(uninitialized object)";
+                return getFullNameOfClass(b->cls);
+            }
+            case GCKind::CONSERVATIVE:
+                return "(conservative)";
+            case GCKind::PRECISE:
+                return "(precise)";
+            case GCKind::UNTRACKED:
+                return "(untracked)";
+            case GCKind::HIDDEN_CLASS:
+                return "(hidden class)";
+            default:
+                RELEASE_ASSERT(0, "%d", (int)al->kind_id);
+        }
+    }
+
+    // The first time we look at a sampled object after its constructor has run, we find out what type it is
+    // and count it:
+    void resolve(GCAllocation* al, Sample& sample) {
+        if (sample.type != -1)
+            return;
+
+        sample.type = intern(typeName(al));
+        Counts& c = counts[std::make_pair(sample.site, sample.type)];
+        c.alloc_objects++;
+        c.alloc_bytes += sample.bytes;
+        c.inuse_objects++;
+        c.inuse_bytes += sample.bytes;
+    }
+};
+
+HeapProfiler& profiler() {
+    static HeapProfiler* p = new HeapProfiler();
+    return *p;
+}
+
+// Just enough of a protobuf encoder to write out pprof's profile.proto.
+class ProtoWriter {
+private:
+    std::string buf;
+
+    void tag(int field, int wire_type) { varint((field << 3) | wire_type); }
+
+public:
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            buf.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        buf.push_back((char)v);
+    }
+
+    void intField(int field, int64_t v) {
+        tag(field, 0);
+        varint(v);
+    }
+
+    void bytesField(int field, const std::string& s) {
+        tag(field, 2);
+        varint(s.size());
+        buf += s;
+    }
+
+    void messageField(int field, const ProtoWriter& m) { bytesField(field, m.buf); }
+
+    void packedField(int field, const std::vector<int64_t>& vals) {
+        ProtoWriter p;
+        for (int64_t v : vals)
+            p.varint(v);
+        bytesField(field, p.buf);
+    }
+
+    const std::string& str() const { return buf; }
+};
+
+// Field numbers from profile.proto:
+enum {
+    PROFILE_SAMPLE_TYPE = 1,
+    PROFILE_SAMPLE = 2,
+    PROFILE_LOCATION = 4,
+    PROFILE_FUNCTION = 5,
+    PROFILE_STRING_TABLE = 6,
+    PROFILE_PERIOD_TYPE = 11,
+    PROFILE_PERIOD = 12,
+    PROFILE_DEFAULT_SAMPLE_TYPE = 14,
+
+    VALUE_TYPE_TYPE = 1,
+    VALUE_TYPE_UNIT = 2,
+
+    SAMPLE_LOCATION_ID = 1,
+    SAMPLE_VALUE = 2,
+    SAMPLE_LABEL = 3,
+
+    LABEL_KEY = 1,
+    LABEL_STR = 2,
+
+    LOCATION_ID = 1,
+    LOCATION_LINE = 4,
+
+    LINE_FUNCTION_ID = 1,
+    LINE_LINE = 2,
+
+    FUNCTION_ID = 1,
+    FUNCTION_NAME = 2,
+    FUNCTION_FILENAME = 4,
+};
+}
+
+void setHeapProfileInterval(int64_t interval) {
+    assert(interval >= 0);
+    profiler().interval = interval;
+    profiler().scheduleNext();
+}
+
+int64_t getHeapProfileInterval() {
+    return profiler().interval;
+}
+
+void heapProfilerSample(GCAllocation* al, size_t bytes) {
+    HeapProfiler& p = profiler();
+
+    // Sampling is off; this is just the periodic check of whether it got turned on:
+    if (!p.interval) {
+        p.scheduleNext();
+        return;
+    }
+
+    static StatCounter sc_samples("gc_heap_profile_samples");
+    sc_samples.log();
+
+    // Finding the call site allocates; don't sample those allocations, and don't let them start a collection
+    // before our caller has had a chance to initialize this object.
+    heap_profile_countdown = 0;
+    bool gc_was_enabled = gcIsEnabled();
+    disableGC();
+    std::string site = getCurrentPythonLine();
+    if (gc_was_enabled)
+        enableGC();
+
+    {
+        LOCK_REGION(&p.lock);
+        setHeapSampled(al);
+        p.live[al] = HeapProfiler::Sample({.bytes = bytes, .site = p.intern(site), .type = -1 });
+    }
+    p.scheduleNext();
+}
+
+void heapProfilerSurvived(GCAllocation* al) {
+    HeapProfiler& p = profiler();
+    LOCK_REGION(&p.lock);
+    auto it = p.live.find(al);
+    assert(it != p.live.end());
+    p.resolve(al, it->second);
+}
+
+void heapProfilerFreed(GCAllocation* al) {
+    HeapProfiler& p = profiler();
+    LOCK_REGION(&p.lock);
+    auto it = p.live.find(al);
+    assert(it != p.live.end());
+    p.resolve(al, it->second);
+
+    HeapProfiler::Counts& c = p.counts[std::make_pair(it->second.site, it->second.type)];
+    c.inuse_objects--;
+    c.inuse_bytes -= it->second.bytes;
+    p.live.erase(it);
+}
+
+void heapProfilerMoved(GCAllocation* from, GCAllocation* to) {
+    HeapProfiler& p = profiler();
+    LOCK_REGION(&p.lock);
+    auto it = p.live.find(from);
+    assert(it != p.live.end());
+    HeapProfiler::Sample sample = it->second;
+    p.live.erase(it);
+    p.live[to] = sample;
+}
+
+void dumpHeapProfile(FILE* f) {
+    threading::GLPromoteRegion _gl_lock;
+
+    // The sampled objects that died in the last collection only get taken out of the profile once they get swept,
+    // so finish the lazy sweep first:
+    global_heap.finishLazySweep();
+
+    HeapProfiler& p = profiler();
+    LOCK_REGION(&p.lock);
+
+    // Objects allocated since the last sweep haven't been looked at yet:
+    for (auto& e : p.live)
+        p.resolve(e.first, e.second);
+
+    int64_t scale = std::max(p.interval, (int64_t)1);
+
+    ProtoWriter profile;
+    std::vector<std::string> strings = p.strings;
+    std::unordered_map<std::string, int> string_ids = p.string_ids;
+    auto intern = [&](const std::string& s) {
+        auto it = string_ids.find(s);
+        if (it != string_ids.end())
+            return (int64_t)it->second;
+        strings.push_back(s);
+        string_ids[s] = strings.size() - 1;
+        return (int64_t)strings.size() - 1;
+    };
+
+    auto valueType = [&](const char* type, const char* unit) {
+        ProtoWriter vt;
+        vt.intField(VALUE_TYPE_TYPE, intern(type));
+        vt.intField(VALUE_TYPE_UNIT, intern(unit));
+        return vt;
+    };
+
+    profile.messageField(PROFILE_SAMPLE_TYPE, valueType("alloc_objects", "count"));
+    profile.messageField(PROFILE_SAMPLE_TYPE, valueType("alloc_space", "bytes"));
+    profile.messageField(PROFILE_SAMPLE_TYPE, valueType("inuse_objects", "count"));
+    profile.messageField(PROFILE_SAMPLE_TYPE, valueType("inuse_space", "bytes"));
+    profile.messageField(PROFILE_PERIOD_TYPE, valueType("objects", "count"));
+    profile.intField(PROFILE_PERIOD, scale);
+    profile.intField(PROFILE_DEFAULT_SAMPLE_TYPE, intern("inuse_space"));
+
+    // Every site and type name gets its own function and location, with the same id as its string.
+    std::vector<bool> emitted(p.strings.size(), false);
+    auto location = [&](int id) {
+        if (emitted[id])
+            return;
+        emitted[id] = true;
+
+        // Sites look like "filename:lineno":
+        const std::string& name = p.strings[id];
+        size_t colon = name.rfind(':');
+        int64_t line = 0;
+        int64_t filename = intern("");
+        if (colon != std::string::npos) {
+            line = std::max(atol(name.c_str() + colon + 1), 0L);
+            filename = intern(name.substr(0, colon));
+        }
+
+        ProtoWriter func;
+        func.intField(FUNCTION_ID, id);
+        func.intField(FUNCTION_NAME, id);
+        func.intField(FUNCTION_FILENAME, filename);
+        profile.messageField(PROFILE_FUNCTION, func);
+
+        ProtoWriter l;
+        l.intField(LINE_FUNCTION_ID, id);
+        l.intField(LINE_LINE, line);
+        ProtoWriter loc;
+        loc.intField(LOCATION_ID, id);
+        loc.messageField(LOCATION_LINE, l);
+        profile.messageField(PROFILE_LOCATION, loc);
+    };
+
+    int64_t type_key = intern("type");
+    for (const auto& e : p.counts) {
+        int site = e.first.first, type = e.first.second;
+        const HeapProfiler::Counts& c = e.second;
+
+        location(site);
+        location(type);
+
+        ProtoWriter sample;
+        sample.packedField(SAMPLE_LOCATION_ID, { type, site });
+        sample.packedField(SAMPLE_VALUE, { c.alloc_objects * scale, c.alloc_bytes * scale, c.inuse_objects * scale,
+                                           c.inuse_bytes * scale });
+        ProtoWriter label;
+        label.intField(LABEL_KEY, type_key);
+        label.intField(LABEL_STR, type);
+        sample.messageField(SAMPLE_LABEL, label);
+        profile.messageField(PROFILE_SAMPLE, sample);
+    }
+
+    for (const auto& s : strings)
+        profile.bytesField(PROFILE_STRING_TABLE, s);
+
+    fwrite(profile.str().data(), 1, profile.str().size(), f);
+}
+}
+}
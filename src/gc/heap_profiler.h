@@ -0,0 +1,55 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_GC_HEAPPROFILER_H
+#define PYSTON_GC_HEAPPROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace pyston {
+namespace gc {
+
+struct GCAllocation;
+
+// A sampling heap profiler, meant to be cheap enough to leave on in production.  About one in every N
+// allocations (the exact spacing is randomized, so that periodic allocation patterns don't skew the
+// results) gets its Python call site recorded and HEAP_SAMPLED_BIT set in its header.  The sweep then
+// looks up the sampled objects as it comes across them, which keeps the tables of live bytes by call site
+// and by type up to date.  Everything that isn't sampled only pays for the countdown in gc_alloc.
+
+// This thread's allocations left until the next one that gets sampled.  (When sampling is off, it just
+// counts down to the next time that the thread checks whether it has been turned on.)
+extern __thread uint64_t heap_profile_countdown;
+
+// Turns on sampling of one in every interval allocations on average, or turns it off if interval is 0.
+void setHeapProfileInterval(int64_t interval);
+int64_t getHeapProfileInterval();
+
+void heapProfilerSample(GCAllocation* al, size_t bytes);
+// Called by the sweep for sampled objects that are still alive:
+void heapProfilerSurvived(GCAllocation* al);
+// Called whenever a sampled object gets freed, before its contents are destroyed:
+void heapProfilerFreed(GCAllocation* al);
+void heapProfilerMoved(GCAllocation* from, GCAllocation* to);
+
+// Writes out the profile in pprof's (uncompressed) protobuf format.  The values are estimates for the
+// whole heap, ie they are scaled up by the sampling interval.  Each sample's stack is the allocation site,
+// with the object's type as a pseudo-frame on top, so that "pprof -top" shows live bytes by type.
+void dumpHeapProfile(FILE* f);
+}
+}
+
+#endif
@@ -224,6 +224,14 @@ int handleArg(char code) {
         ENABLE_TRACEBACKS = false;
     } else if (code == 'G') {
         enableGdbSegfaultWatcher();
+    } else if (code == 'g') {
+        GC_GENERATIONAL = true;
+    } else if (code == 'C') {
+        ENABLE_BASELINEJIT_CACHE = true;
+    } else if (code == 'J') {
+        // Only use the interpreter, for measuring it on its own:
+        FORCE_INTERPRETER = true;
+        ENABLE_BASELINEJIT = false;
     } else {
         fprintf(stderr, "Unknown option: -%c\n", code);
         return 2;
@@ -301,7 +309,7 @@ static int main(int argc, char** argv) {
 
         // Suppress getopt errors so we can throw them ourselves
         opterr = 0;
-        while ((code = getopt(argc, argv, "+:OqdIibpjtrsSvnxEac:FuPTGm:")) != -1) {
+        while ((code = getopt(argc, argv, "+:OqdIibpjtrsSvnxEac:FuPTGgCJm:")) != -1) {
             if (code == 'c') {
                 assert(optarg);
                 command = optarg;
@@ -12,14 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "core/options.h"
 #include "core/types.h"
 #include "gc/collector.h"
+#include "gc/heap_profiler.h"
+#include "runtime/objmodel.h"
 #include "runtime/types.h"
 
 namespace pyston {
 
 static Box* gcCollect() {
-    gc::runCollection();
+    gc::runMajorCollection();
 
     // I think it's natural that the user would expect the finalizers to get run here if we're forcing
     // a GC pass. It should be safe to do, and makes testing easier also.
@@ -42,6 +45,66 @@ static Box* enable() {
     return None;
 }
 
+static int thresholdArg(Box* b) {
+    if (!isSubclass(b->cls, int_cls))
+        raiseExcHelper(TypeError, "an integer is required");
+
+    int64_t n = static_cast<BoxedInt*>(b)->n;
+    if (n < 0 || n > INT_MAX)
+        raiseExcHelper(ValueError, "threshold out of range");
+    return n;
+}
+
+// Our thresholds don't mean the same thing as CPython's, but they play the same roles:
+// - threshold0: the minimum number of bytes to allocate between collections (0 disables automatic collection)
+// - threshold1: how much the heap can grow between collections, as a percentage of the memory that survived
+// - threshold2: the number of minor collections per major collection, if the generational mode is enabled
+static Box* setThreshold(Box* threshold0, Box* threshold1, Box* threshold2) {
+    GC_MIN_BYTES_PER_COLLECTION = thresholdArg(threshold0);
+    if (threshold1)
+        GC_HEAP_GROWTH_PERCENT = thresholdArg(threshold1);
+    if (threshold2)
+        GC_MINOR_COLLECTIONS_PER_MAJOR = thresholdArg(threshold2);
+
+    gc::updateCollectionTrigger();
+    return None;
+}
+
+static Box* getThreshold() {
+    return BoxedTuple::create({ boxInt(GC_MIN_BYTES_PER_COLLECTION), boxInt(GC_HEAP_GROWTH_PERCENT),
+                                boxInt(GC_MINOR_COLLECTIONS_PER_MAJOR) });
+}
+
+// Pyston addition: how much memory the gc has given back to the OS so far.
+static Box* getReclaimedBytes() {
+    return boxInt(gc::global_heap.reclaimed_bytes);
+}
+
+// Pyston addition: sample roughly one out of every n allocations for the heap profiler, or stop sampling if n is 0.
+static Box* setHeapProfileInterval(Box* n) {
+    if (!isSubclass(n->cls, int_cls))
+        raiseExcHelper(TypeError, "an integer is required");
+    if (static_cast<BoxedInt*>(n)->n < 0)
+        raiseExcHelper(ValueError, "interval must be non-negative");
+
+    gc::setHeapProfileInterval(static_cast<BoxedInt*>(n)->n);
+    return None;
+}
+
+// Pyston addition: write out what the heap profiler has seen so far, in pprof's format.
+static Box* dumpHeapProfile(Box* fn) {
+    if (!isSubclass(fn->cls, str_cls))
+        raiseExcHelper(TypeError, "dump_heap_profile() argument must be a string, not '%s'", getTypeName(fn));
+
+    BoxedString* s = static_cast<BoxedString*>(fn);
+    FILE* f = fopen(s->c_str(), "w");
+    if (!f)
+        raiseExcHelper(IOError, "[Errno %d] %s: '%s'", errno, strerror(errno), s->c_str());
+    gc::dumpHeapProfile(f);
+    fclose(f);
+    return None;
+}
+
 void setupGC() {
     BoxedModule* gc_module = createModule("gc");
 
@@ -51,5 +114,19 @@ void setupGC() {
                         new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)isEnabled, BOXED_BOOL, 0), "isenabled"));
     gc_module->giveAttr("disable", new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)disable, NONE, 0), "disable"));
     gc_module->giveAttr("enable", new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)enable, NONE, 0), "enable"));
+    gc_module->giveAttr("set_threshold",
+                        new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)setThreshold, NONE, 3, 2, false, false),
+                                                         "set_threshold", { NULL, NULL }));
+    gc_module->giveAttr("get_threshold", new BoxedBuiltinFunctionOrMethod(
+                                             boxRTFunction((void*)getThreshold, BOXED_TUPLE, 0), "get_threshold"));
+    gc_module->giveAttr("get_reclaimed_bytes",
+                        new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)getReclaimedBytes, BOXED_INT, 0),
+                                                         "get_reclaimed_bytes"));
+    gc_module->giveAttr("set_heap_profile_interval",
+                        new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)setHeapProfileInterval, NONE, 1),
+                                                         "set_heap_profile_interval"));
+    gc_module->giveAttr("dump_heap_profile",
+                        new BoxedBuiltinFunctionOrMethod(boxRTFunction((void*)dumpHeapProfile, NONE, 1),
+                                                         "dump_heap_profile"));
 }
 }
@@ -42,9 +42,22 @@ static Box* setOption(Box* option, Box* value) {
     else CHECK(OSR_THRESHOLD_INTERPRETER);
     else CHECK(REOPT_THRESHOLD_BASELINE);
     else CHECK(OSR_THRESHOLD_BASELINE);
+    else CHECK(REOPT_THRESHOLD_T2);
+    else CHECK(ENABLE_BACKGROUND_COMPILE);
+    else CHECK(ENABLE_BASELINEJIT_CACHE);
+    else CHECK(ENABLE_BASELINEJIT);
+    else CHECK(ENABLE_INTERPRETER_CACHES);
+    else CHECK(ENABLE_BLOCK_COUNTS);
+    else CHECK(ENABLE_TYPE_HISTOGRAMS);
     else CHECK(SPECULATION_THRESHOLD);
     else CHECK(ENABLE_ICS);
     else CHECK(ENABLE_ICGETATTRS);
+    else CHECK(GC_MARK_THREADS);
+    else CHECK(GC_LAZY_SWEEP);
+    else CHECK(GC_MINOR_COLLECTIONS_PER_MAJOR);
+    else CHECK(GC_MIN_BYTES_PER_COLLECTION);
+    else CHECK(GC_HEAP_GROWTH_PERCENT);
+    else CHECK(GC_FREE_MEMORY_WATERMARK);
     else raiseExcHelper(ValueError, "unknown option name '%s", option_string->data());
 
     return None;
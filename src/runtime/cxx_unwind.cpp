@@ -565,7 +565,7 @@ static inline void unwind_loop(ExcInfo* exc_data) {
             pyston::StatTimer::finishOverride();
 #endif
         }
-        static_assert(THREADING_USE_GIL, "have to make the unwind session usage in this file thread safe!");
+        // (The unwind session is per-thread, so this is fine with the GRWL too.)
         // there is a python unwinding implementation detail leaked
         // here - that the unwind session can be ended but its
         // exception storage is still around.
@@ -50,6 +50,7 @@ Box* dictRepr(BoxedDict* self) {
 }
 
 Box* dictClear(BoxedDict* self) {
+    threading::GLPromoteRegion _lock;
     if (!isSubclass(self->cls, dict_cls))
         raiseExcHelper(TypeError, "descriptor 'clear' requires a 'dict' object but received a '%s'", getTypeName(self));
 
@@ -62,7 +63,7 @@ Box* dictCopy(BoxedDict* self) {
         raiseExcHelper(TypeError, "descriptor 'copy' requires a 'dict' object but received a '%s'", getTypeName(self));
 
     BoxedDict* r = new BoxedDict();
-    r->d.insert(self->d.begin(), self->d.end());
+    r->d.copyFrom(self->d);
     return r;
 }
 
@@ -165,6 +166,7 @@ extern "C" Py_ssize_t PyDict_Size(PyObject* op) noexcept {
 }
 
 extern "C" void PyDict_Clear(PyObject* op) noexcept {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(PyDict_Check(op), "");
     static_cast<BoxedDict*>(op)->d.clear();
 }
@@ -269,40 +271,16 @@ extern "C" int PyDict_Next(PyObject* op, Py_ssize_t* ppos, PyObject** pkey, PyOb
     assert(isSubclass(op->cls, dict_cls));
     BoxedDict* self = static_cast<BoxedDict*>(op);
 
-    // Callers of PyDict_New() provide a pointer to some storage for this function to use, in
-    // the form of a Py_ssize_t* -- ie they allocate a Py_ssize_t on their stack, and let us use
-    // it.
-    //
-    // We want to store an unordered_map::iterator in that.  In my glibc it would fit, but to keep
-    // things a little bit more portable, allocate separate storage for the iterator, and store the
-    // pointer to this storage in the Py_ssize_t slot.
-    //
-    // Results in lots of indirection unfortunately.  If it becomes an issue we can try to switch
-    // to storing the iterator directly in the stack slot.
-
-    typedef BoxedDict::DictMap::iterator iterator;
-
-    static_assert(sizeof(Py_ssize_t) == sizeof(iterator*), "");
-    iterator** it_ptr = reinterpret_cast<iterator**>(ppos);
-
-    // Clients are supposed to zero-initialize *ppos:
-    if (*it_ptr == NULL) {
-        *it_ptr = (iterator*)malloc(sizeof(iterator));
-        **it_ptr = self->d.begin();
-    }
-
-    iterator* it = *it_ptr;
-
-    if (*it == self->d.end()) {
-        free(it);
+    // Like in CPython, *ppos is a position in the entries array (and clients zero-initialize it):
+    static_assert(sizeof(Py_ssize_t) == sizeof(size_t), "");
+    DictEntry* e = self->d.next(reinterpret_cast<size_t*>(ppos));
+    if (!e)
         return 0;
-    }
-
-    *pkey = (*it)->first;
-    *pvalue = (*it)->second;
-
-    ++(*it);
 
+    if (pkey)
+        *pkey = e->first;
+    if (pvalue)
+        *pvalue = e->second;
     return 1;
 }
 
@@ -319,7 +297,21 @@ extern "C" PyObject* PyDict_GetItemString(PyObject* dict, const char* key) noexc
     return PyDict_GetItem(dict, key_s);
 }
 
+// Anything that can add or remove entries has to promote the GRWL first (see threading::isGLPromoted()), since
+// that can rehash the table out from under other threads' lookups.
 Box* dictSetitem(BoxedDict* self, Box* k, Box* v) {
+    // Replacing the value of an existing key doesn't change the table, so that's fine to do in read mode:
+    if (!threading::isGLPromoted()) {
+        auto it = self->d.find(k);
+        if (it != self->d.end()) {
+            it->second = v;
+            return None;
+        }
+
+        threading::GLPromoteRegion _lock;
+        return dictSetitem(self, k, v);
+    }
+
     // printf("Starting setitem\n");
     Box*& pos = self->d[k];
     // printf("Got the pos\n");
@@ -334,6 +326,7 @@ Box* dictSetitem(BoxedDict* self, Box* k, Box* v) {
 }
 
 Box* dictDelitem(BoxedDict* self, Box* k) {
+    threading::GLPromoteRegion _lock;
     if (!isSubclass(self->cls, dict_cls))
         raiseExcHelper(TypeError, "descriptor '__delitem__' requires a 'dict' object but received a '%s'",
                        getTypeName(self));
@@ -371,6 +364,7 @@ extern "C" int PyDict_DelItemString(PyObject* v, const char* key) noexcept {
 }
 
 Box* dictPop(BoxedDict* self, Box* k, Box* d) {
+    threading::GLPromoteRegion _lock;
     if (!isSubclass(self->cls, dict_cls))
         raiseExcHelper(TypeError, "descriptor 'pop' requires a 'dict' object but received a '%s'", getTypeName(self));
 
@@ -388,15 +382,17 @@ Box* dictPop(BoxedDict* self, Box* k, Box* d) {
 }
 
 Box* dictPopitem(BoxedDict* self) {
+    threading::GLPromoteRegion _lock;
     if (!isSubclass(self->cls, dict_cls))
         raiseExcHelper(TypeError, "descriptor 'popitem' requires a 'dict' object but received a '%s'",
                        getTypeName(self));
 
-    auto it = self->d.begin();
-    if (it == self->d.end()) {
+    if (self->d.empty()) {
         raiseExcHelper(KeyError, "popitem(): dictionary is empty");
     }
 
+    // Take the most recently added item, which is the cheap one to remove:
+    auto it = self->d.last();
     Box* key = it->first;
     Box* value = it->second;
     self->d.erase(it);
@@ -417,16 +413,12 @@ Box* dictGet(BoxedDict* self, Box* k, Box* d) {
 }
 
 Box* dictSetdefault(BoxedDict* self, Box* k, Box* v) {
+    threading::GLPromoteRegion _lock;
     if (!isSubclass(self->cls, dict_cls))
         raiseExcHelper(TypeError, "descriptor 'setdefault' requires a 'dict' object but received a '%s'",
                        getTypeName(self));
 
-    auto it = self->d.find(k);
-    if (it != self->d.end())
-        return it->second;
-
-    self->d.insert(it, std::make_pair(k, v));
-    return v;
+    return self->d.insert(k, v).first->second;
 }
 
 Box* dictContains(BoxedDict* self, Box* k) {
@@ -518,7 +510,13 @@ extern "C" Box* dictNew(Box* _cls, BoxedTuple* args, BoxedDict* kwargs) {
 }
 
 void dictMerge(BoxedDict* self, Box* other) {
+    threading::GLPromoteRegion _lock;
     if (isSubclass(other->cls, dict_cls)) {
+        if (self->d.empty()) {
+            self->d.copyFrom(static_cast<BoxedDict*>(other)->d);
+            return;
+        }
+
         for (const auto& p : static_cast<BoxedDict*>(other)->d)
             self->d[p.first] = p.second;
         return;
@@ -535,6 +533,7 @@ void dictMerge(BoxedDict* self, Box* other) {
 }
 
 void dictMergeFromSeq2(BoxedDict* self, Box* other) {
+    threading::GLPromoteRegion _lock;
     int idx = 0;
 
     // raises if not iterable
@@ -662,8 +661,8 @@ static Box* dict_repr(PyObject* self) noexcept {
 }
 
 void setupDict() {
-    dict_iterator_cls = BoxedHeapClass::create(type_cls, object_cls, &dictIteratorGCHandler, 0, 0, sizeof(BoxedDict),
-                                               false, "dictionary-itemiterator");
+    dict_iterator_cls = BoxedHeapClass::create(type_cls, object_cls, &dictIteratorGCHandler, 0, 0,
+                                               sizeof(BoxedDictIterator), false, "dictionary-itemiterator");
 
     dict_keys_cls = BoxedHeapClass::create(type_cls, object_cls, &dictViewGCHandler, 0, 0, sizeof(BoxedDictView), false,
                                            "dict_keys");
@@ -29,8 +29,9 @@ public:
     enum IteratorType { KeyIterator, ValueIterator, ItemIterator };
 
     BoxedDict* d;
-    BoxedDict::DictMap::iterator it;
-    const BoxedDict::DictMap::iterator itEnd;
+    // A position in d's entries array; see DictMap::next().
+    size_t pos;
+    const size_t orig_size;
     const IteratorType type;
 
     BoxedDictIterator(BoxedDict* d, IteratorType type);
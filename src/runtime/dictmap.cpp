@@ -0,0 +1,249 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/dictmap.h"
+
+#include <cstring>
+
+#include "core/stats.h"
+#include "gc/collector.h"
+#include "runtime/types.h"
+
+namespace pyston {
+
+int64_t DictMap::lookup(Box* key, size_t hash, size_t* slot_out) {
+restart:
+    if (!table)
+        return EMPTY;
+
+    size_t mask = ((size_t)1 << log_size) - 1;
+    size_t i = hash & mask;
+    size_t perturb = hash;
+    bool have_free_slot = false;
+
+    while (true) {
+        int64_t ix = getIndex(i);
+        if (ix == EMPTY) {
+            if (!have_free_slot)
+                *slot_out = i;
+            return EMPTY;
+        }
+
+        if (ix == DUMMY) {
+            if (!have_free_slot) {
+                *slot_out = i;
+                have_free_slot = true;
+            }
+        } else {
+            DictEntry* e = &entries[ix];
+            if (e->first == key) {
+                *slot_out = i;
+                return ix;
+            }
+
+            if (e->hash == hash) {
+                Box* startkey = e->first;
+                void* starttable = table;
+                bool eq = PyEq()(startkey, key);
+
+                // The comparison can run arbitrary code, including code that changes this dict:
+                if (table != starttable || entries[ix].first != startkey)
+                    goto restart;
+
+                if (eq) {
+                    *slot_out = i;
+                    return ix;
+                }
+            }
+        }
+
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+}
+
+size_t DictMap::slotForEntry(size_t hash, int64_t ix) const {
+    size_t mask = ((size_t)1 << log_size) - 1;
+    size_t i = hash & mask;
+    size_t perturb = hash;
+    while (true) {
+        int64_t cur = getIndex(i);
+        assert(cur != EMPTY);
+        if (cur == ix)
+            return i;
+
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+}
+
+size_t DictMap::findEmptySlot(size_t hash) const {
+    size_t mask = ((size_t)1 << log_size) - 1;
+    size_t i = hash & mask;
+    size_t perturb = hash;
+    while (getIndex(i) >= 0) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+    return i;
+}
+
+void DictMap::resize() {
+    static StatCounter sc_resizes("dict_resizes");
+    sc_resizes.log();
+
+    // Leave room for the dict to double in size before the next resize:
+    size_t new_log_size = MIN_LOG_SIZE;
+    while (((size_t)1 << new_log_size) <= num_items * 3)
+        new_log_size++;
+
+    size_t index_bytes = indexWidth(new_log_size) << new_log_size;
+    void* new_table
+        = gc_alloc(index_bytes + usable(new_log_size) * sizeof(DictEntry), gc::GCKind::UNTRACKED);
+    memset(new_table, 0xff, index_bytes); // all EMPTY
+    DictEntry* new_entries = reinterpret_cast<DictEntry*>((char*)new_table + index_bytes);
+
+    size_t n = 0;
+    for (size_t i = 0; i < num_entries; i++) {
+        if (entries[i].first)
+            new_entries[n++] = entries[i];
+    }
+    assert(n == num_items);
+
+    void* old_table = table;
+    table = new_table;
+    entries = new_entries;
+    log_size = new_log_size;
+    num_entries = n;
+    usable_left = usable(new_log_size) - n;
+
+    for (size_t i = 0; i < n; i++) {
+        setIndex(findEmptySlot(new_entries[i].hash), i);
+    }
+
+    if (old_table)
+        gc::gc_free(old_table);
+}
+
+size_t DictMap::insertNew(Box* key, size_t hash, Box* value, size_t slot) {
+    if (usable_left == 0) {
+        resize();
+        slot = findEmptySlot(hash);
+    }
+
+    size_t ix = num_entries++;
+    entries[ix].first = key;
+    entries[ix].second = value;
+    entries[ix].hash = hash;
+    setIndex(slot, ix);
+
+    num_items++;
+    usable_left--;
+    return ix;
+}
+
+DictMap::iterator DictMap::find(Box* key) {
+    if (num_items == 0)
+        return end();
+
+    size_t slot;
+    int64_t ix = lookup(key, PyHasher()(key), &slot);
+    if (ix == EMPTY)
+        return end();
+    return iterator(&entries[ix], entries + num_entries);
+}
+
+Box*& DictMap::operator[](Box* key) {
+    size_t hash = PyHasher()(key);
+    size_t slot;
+    int64_t ix = lookup(key, hash, &slot);
+    if (ix == EMPTY)
+        ix = insertNew(key, hash, NULL, slot);
+    return entries[ix].second;
+}
+
+std::pair<DictMap::iterator, bool> DictMap::insert(Box* key, Box* value) {
+    size_t hash = PyHasher()(key);
+    size_t slot;
+    int64_t ix = lookup(key, hash, &slot);
+    bool inserted = (ix == EMPTY);
+    if (inserted)
+        ix = insertNew(key, hash, value, slot);
+    return std::make_pair(iterator(&entries[ix], entries + num_entries), inserted);
+}
+
+void DictMap::erase(iterator it) {
+    int64_t ix = it.cur - entries;
+    assert(ix >= 0 && (size_t)ix < num_entries && it.cur->first);
+
+    setIndex(slotForEntry(it.cur->hash, ix), DUMMY);
+    it.cur->first = NULL;
+    it.cur->second = NULL;
+    num_items--;
+
+    // Keep the last entry live, so that popping items off the end doesn't have to skip over
+    // more and more deleted entries:
+    while (num_entries && !entries[num_entries - 1].first)
+        num_entries--;
+}
+
+DictMap::size_type DictMap::erase(Box* key) {
+    auto it = find(key);
+    if (it == end())
+        return 0;
+    erase(it);
+    return 1;
+}
+
+void DictMap::clear() {
+    void* old_table = table;
+
+    table = NULL;
+    entries = NULL;
+    num_items = num_entries = usable_left = log_size = 0;
+
+    if (old_table)
+        gc::gc_free(old_table);
+}
+
+void DictMap::copyFrom(const DictMap& other) {
+    assert(num_items == 0);
+    if (other.num_items == 0)
+        return;
+    clear();
+
+    size_t index_bytes = indexWidth(other.log_size) << other.log_size;
+    void* new_table = gc_alloc(index_bytes + usable(other.log_size) * sizeof(DictEntry), gc::GCKind::UNTRACKED);
+    memcpy(new_table, other.table, index_bytes + other.num_entries * sizeof(DictEntry));
+
+    table = new_table;
+    entries = reinterpret_cast<DictEntry*>((char*)new_table + index_bytes);
+    num_items = other.num_items;
+    num_entries = other.num_entries;
+    usable_left = other.usable_left;
+    log_size = other.log_size;
+}
+
+void DictMap::gcVisit(gc::GCVisitor* v) {
+    if (!table)
+        return;
+
+    v->visit(table);
+    for (size_t i = 0; i < num_entries; i++) {
+        // The value can be NULL for a moment after operator[] inserts a new key:
+        v->visitIf(entries[i].first);
+        v->visitIf(entries[i].second);
+    }
+}
+}
@@ -0,0 +1,199 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_RUNTIME_DICTMAP_H
+#define PYSTON_RUNTIME_DICTMAP_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace pyston {
+
+class Box;
+namespace gc {
+class GCVisitor;
+}
+
+// The members are named like std::pair's, so that code that iterates over a dict doesn't have to
+// care how the dict is stored.
+struct DictEntry {
+    Box* first; // the key, or NULL if the entry has been deleted
+    Box* second;
+    size_t hash;
+};
+
+// The storage for BoxedDict, laid out the way CPython 3.6 lays out its dicts: the entries live in a
+// dense array in insertion order, and lookups go through a separate open-addressing table of indices
+// into that array.  The index table uses the narrowest integer type that can address all the entries,
+// so most of the memory goes to the entries themselves, the hashes are cached next to the keys, and
+// iteration is a linear scan.
+//
+// Both arrays are in a single gc allocation that is only reachable from the DictMap, which traces the
+// keys and values precisely.  An all-zero DictMap is a valid empty one.
+//
+// As with the STL containers, iterators and references into the map are invalidated by insertions;
+// code that has to survive the dict changing underneath it (PyDict_Next, dict iterator objects) should
+// iterate by position with next().
+class DictMap {
+public:
+    typedef size_t size_type;
+    typedef DictEntry value_type;
+
+    class iterator {
+    private:
+        DictEntry* cur;
+        DictEntry* end;
+
+        void skipDeleted() {
+            while (cur != end && !cur->first)
+                ++cur;
+        }
+
+    public:
+        iterator() : cur(NULL), end(NULL) {}
+        iterator(DictEntry* cur, DictEntry* end) : cur(cur), end(end) { skipDeleted(); }
+
+        DictEntry& operator*() const { return *cur; }
+        DictEntry* operator->() const { return cur; }
+        iterator& operator++() {
+            ++cur;
+            skipDeleted();
+            return *this;
+        }
+        bool operator==(const iterator& rhs) const { return cur == rhs.cur; }
+        bool operator!=(const iterator& rhs) const { return cur != rhs.cur; }
+
+        friend class DictMap;
+    };
+
+private:
+    // The index table (1 << log_size slots, each indexWidth(log_size) bytes wide) followed by room
+    // for usable(log_size) entries.
+    void* table;
+    DictEntry* entries;
+    size_t num_items;   // live entries
+    size_t num_entries; // entries in use, including deleted ones; entries[num_entries - 1] is always live
+    size_t usable_left; // how many more entries can be added before the table has to be resized
+    size_t log_size;
+
+    // Index table values that don't refer to an entry:
+    static const int64_t EMPTY = -1;
+    static const int64_t DUMMY = -2; // the entry was deleted; lookups have to keep probing
+
+    static const size_t MIN_LOG_SIZE = 3;
+    static const int PERTURB_SHIFT = 5;
+
+    // Keep the index table at most 2/3 full:
+    static size_t usable(size_t log_size) { return ((size_t)2 << log_size) / 3; }
+    static size_t indexWidth(size_t log_size) {
+        if (log_size < 8)
+            return 1;
+        if (log_size < 16)
+            return 2;
+        if (log_size < 32)
+            return 4;
+        return 8;
+    }
+
+    int64_t getIndex(size_t slot) const {
+        switch (indexWidth(log_size)) {
+            case 1:
+                return ((int8_t*)table)[slot];
+            case 2:
+                return ((int16_t*)table)[slot];
+            case 4:
+                return ((int32_t*)table)[slot];
+            default:
+                return ((int64_t*)table)[slot];
+        }
+    }
+
+    void setIndex(size_t slot, int64_t ix) {
+        switch (indexWidth(log_size)) {
+            case 1:
+                ((int8_t*)table)[slot] = ix;
+                break;
+            case 2:
+                ((int16_t*)table)[slot] = ix;
+                break;
+            case 4:
+                ((int32_t*)table)[slot] = ix;
+                break;
+            default:
+                ((int64_t*)table)[slot] = ix;
+                break;
+        }
+    }
+
+    // Returns the position of the key's entry, or EMPTY.  *slot_out is set to the index slot that
+    // refers to the entry, or to the slot a new entry for the key should use.
+    int64_t lookup(Box* key, size_t hash, size_t* slot_out);
+    // Finds the index slot that refers to the given entry, without doing any comparisons.
+    size_t slotForEntry(size_t hash, int64_t ix) const;
+    size_t findEmptySlot(size_t hash) const;
+    size_t insertNew(Box* key, size_t hash, Box* value, size_t slot);
+    // Rebuilds the table to fit the live entries with room to grow, dropping the deleted entries.
+    void resize();
+
+public:
+    DictMap() : table(NULL), entries(NULL), num_items(0), num_entries(0), usable_left(0), log_size(0) {}
+    DictMap(const DictMap&) = delete;
+    DictMap& operator=(const DictMap&) = delete;
+
+    size_type size() const { return num_items; }
+    bool empty() const { return num_items == 0; }
+
+    iterator begin() { return iterator(entries, entries + num_entries); }
+    iterator end() { return iterator(entries + num_entries, entries + num_entries); }
+
+    iterator find(Box* key);
+    size_type count(Box* key) { return find(key) != end(); }
+
+    // Inserts the key with a NULL value if it isn't in the map yet.
+    Box*& operator[](Box* key);
+    // Inserts the key if it isn't in the map yet; returns the key's entry, and whether it got inserted.
+    std::pair<iterator, bool> insert(Box* key, Box* value);
+
+    void erase(iterator it);
+    size_type erase(Box* key);
+    void clear();
+
+    // Copies all of the items from other into this map, which has to be empty.  This is much faster
+    // than inserting them one by one, since nothing needs to be hashed or compared.
+    void copyFrom(const DictMap& other);
+
+    // The most recently inserted item.
+    iterator last() {
+        assert(num_items);
+        return iterator(&entries[num_entries - 1], entries + num_entries);
+    }
+
+    // Position-based iteration, which is safe against the map changing in between calls: returns the
+    // first live entry at or after position *pos and moves *pos past it, or returns NULL at the end.
+    DictEntry* next(size_t* pos) {
+        while (*pos < num_entries) {
+            DictEntry* e = &entries[(*pos)++];
+            if (e->first)
+                return e;
+        }
+        return NULL;
+    }
+
+    void gcVisit(gc::GCVisitor* v);
+};
+}
+
+#endif
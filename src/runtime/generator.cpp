@@ -36,6 +36,8 @@
 
 namespace pyston {
 
+// Protects next_stack_addr and available_addrs:
+static DS_DEFINE_MUTEX(generator_stacks_lock);
 static uint64_t next_stack_addr = 0x4270000000L;
 static std::deque<uint64_t> available_addrs;
 
@@ -46,8 +48,8 @@ static std::deque<uint64_t> available_addrs;
 #define STACK_REDZONE_SIZE PAGE_SIZE
 #define MAX_STACK_SIZE (4 * 1024 * 1024)
 
+static DS_DEFINE_MUTEX(generator_map_lock);
 static std::unordered_map<void*, BoxedGenerator*> s_generator_map;
-static_assert(THREADING_USE_GIL, "have to make the generator map thread safe!");
 
 class RegisterHelper {
 private:
@@ -55,9 +57,11 @@ private:
 
 public:
     RegisterHelper(BoxedGenerator* generator, void* frame_addr) : frame_addr(frame_addr) {
+        LOCK_REGION(&generator_map_lock);
         s_generator_map[frame_addr] = generator;
     }
     ~RegisterHelper() {
+        LOCK_REGION(&generator_map_lock);
         assert(s_generator_map.count(frame_addr));
         s_generator_map.erase(frame_addr);
     }
@@ -67,6 +71,7 @@ static void freeGeneratorStack(BoxedGenerator* g) {
     if (g->stack_begin == NULL)
         return;
 
+    LOCK_REGION(&generator_stacks_lock);
     available_addrs.push_back((uint64_t)g->stack_begin);
     // Limit the number of generator stacks we keep around:
     if (available_addrs.size() > 5) {
@@ -80,6 +85,7 @@ static void freeGeneratorStack(BoxedGenerator* g) {
 }
 
 Context* getReturnContextForGeneratorFrame(void* frame_addr) {
+    LOCK_REGION(&generator_map_lock);
     BoxedGenerator* generator = s_generator_map[frame_addr];
     assert(generator);
     return generator->returnContext;
@@ -320,13 +326,25 @@ extern "C" BoxedGenerator::BoxedGenerator(BoxedFunctionBase* function, Box* arg1
     static StatCounter generator_stack_reused("generator_stack_reused");
     static StatCounter generator_stack_created("generator_stack_created");
 
+    // Only hold the lock while picking the stack: registerGCManagedBytes can start a collection.
+    uint64_t reused_stack_high = 0;
+    uint64_t stack_low = 0;
+    {
+        LOCK_REGION(&generator_stacks_lock);
+        if (available_addrs.empty()) {
+            stack_low = next_stack_addr;
+            next_stack_addr = stack_low + MAX_STACK_SIZE;
+        } else {
+            reused_stack_high = available_addrs.back();
+            available_addrs.pop_back();
+        }
+    }
+
     void* initial_stack_limit;
-    if (available_addrs.size() == 0) {
+    if (!reused_stack_high) {
         generator_stack_created.log();
 
-        uint64_t stack_low = next_stack_addr;
         uint64_t stack_high = stack_low + MAX_STACK_SIZE;
-        next_stack_addr = stack_high;
 
 #if STACK_GROWS_DOWN
         this->stack_begin = (void*)stack_high;
@@ -364,10 +382,9 @@ extern "C" BoxedGenerator::BoxedGenerator(BoxedFunctionBase* function, Box* arg1
         generator_stack_reused.log();
 
 #if STACK_GROWS_DOWN
-        uint64_t stack_high = available_addrs.back();
+        uint64_t stack_high = reused_stack_high;
         this->stack_begin = (void*)stack_high;
         initial_stack_limit = (void*)(stack_high - INITIAL_STACK_SIZE);
-        available_addrs.pop_back();
 #else
 #error "implement me"
 #endif
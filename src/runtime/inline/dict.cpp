@@ -20,7 +20,7 @@
 namespace pyston {
 
 BoxedDictIterator::BoxedDictIterator(BoxedDict* d, IteratorType type)
-    : d(d), it(d->d.begin()), itEnd(d->d.end()), type(type) {
+    : d(d), pos(0), orig_size(d->d.size()), type(type) {
 }
 
 Box* dictIterKeys(Box* s) {
@@ -49,7 +49,13 @@ i1 dictIterHasnextUnboxed(Box* s) {
     assert(s->cls == dict_iterator_cls);
     BoxedDictIterator* self = static_cast<BoxedDictIterator*>(s);
 
-    return self->it != self->itEnd;
+    // Let next() raise the error:
+    if (self->d->d.size() != self->orig_size)
+        return true;
+
+    // Look past any deleted entries, without consuming the next item:
+    size_t pos = self->pos;
+    return self->d->d.next(&pos) != NULL;
 }
 
 Box* dictIterHasnext(Box* s) {
@@ -60,18 +66,21 @@ Box* dictIterNext(Box* s) {
     assert(s->cls == dict_iterator_cls);
     BoxedDictIterator* self = static_cast<BoxedDictIterator*>(s);
 
-    if (self->it == self->itEnd)
+    if (self->d->d.size() != self->orig_size)
+        raiseExcHelper(RuntimeError, "dictionary changed size during iteration");
+
+    DictEntry* e = self->d->d.next(&self->pos);
+    if (!e)
         raiseExcHelper(StopIteration, "");
 
     Box* rtn = nullptr;
     if (self->type == BoxedDictIterator::KeyIterator) {
-        rtn = self->it->first;
+        rtn = e->first;
     } else if (self->type == BoxedDictIterator::ValueIterator) {
-        rtn = self->it->second;
+        rtn = e->second;
     } else if (self->type == BoxedDictIterator::ItemIterator) {
-        rtn = BoxedTuple::create({ self->it->first, self->it->second });
+        rtn = BoxedTuple::create({ e->first, e->second });
     }
-    ++self->it;
     return rtn;
 }
 
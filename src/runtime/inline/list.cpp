@@ -125,10 +125,12 @@ extern "C" void listAppendArrayInternal(Box* s, Box** v, int nelts) {
     memcpy(&self->elts->elts[self->size], &v[0], nelts * sizeof(Box*));
 
     self->size += nelts;
+    gc::writeBarrier(self);
 }
 
 // TODO the inliner doesn't want to inline these; is there any point to having them in the inline section?
 extern "C" Box* listAppend(Box* s, Box* v) {
+    threading::GLPromoteRegion _lock;
     assert(isSubclass(s->cls, list_cls));
     BoxedList* self = static_cast<BoxedList*>(s);
 
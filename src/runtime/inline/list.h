@@ -54,6 +54,7 @@ extern "C" inline void listAppendInternal(Box* s, Box* v) {
     assert(self->size < self->capacity);
     self->elts->elts[self->size] = v;
     self->size++;
+    gc::writeBarrier(self);
 }
 }
 
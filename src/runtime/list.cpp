@@ -33,7 +33,10 @@
 
 namespace pyston {
 
+// Everything that changes the size or the order of a list has to promote the GRWL first (see
+// threading::isGLPromoted()).  Storing into an existing slot doesn't, since that's just a pointer write.
 extern "C" int PyList_Append(PyObject* op, PyObject* newitem) noexcept {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(PyList_Check(op), "");
     try {
         listAppendInternal(op, newitem);
@@ -87,6 +90,7 @@ extern "C" Box* listNonzero(BoxedList* self) {
 }
 
 extern "C" Box* listPop(BoxedList* self, Box* idx) {
+    threading::GLPromoteRegion _lock;
     if (idx == None) {
         if (self->size == 0) {
             raiseExcHelper(IndexError, "pop from empty list");
@@ -252,6 +256,7 @@ static void _listSetitem(BoxedList* self, int64_t n, Box* v) {
     }
 
     self->elts->elts[n] = v;
+    gc::writeBarrier(self);
 }
 
 extern "C" Box* listSetitemUnboxed(BoxedList* self, int64_t n, Box* v) {
@@ -281,6 +286,7 @@ extern "C" int PyList_SetItem(PyObject* op, Py_ssize_t i, PyObject* newitem) noe
     p = ((PyListObject*)op)->ob_item + i;
     olditem = *p;
     *p = newitem;
+    gc::writeBarrier(op);
     Py_XDECREF(olditem);
     return 0;
 }
@@ -289,6 +295,7 @@ Box* listIAdd(BoxedList* self, Box* _rhs);
 
 // Copied from CPython's list_ass_subscript
 int list_ass_ext_slice(BoxedList* self, PyObject* item, PyObject* value) {
+    threading::GLPromoteRegion _lock;
     Py_ssize_t start, stop, step, slicelength;
 
     if (PySlice_GetIndicesEx((PySliceObject*)item, Py_SIZE(self), &start, &stop, &step, &slicelength) < 0) {
@@ -405,6 +412,7 @@ int list_ass_ext_slice(BoxedList* self, PyObject* item, PyObject* value) {
             Py_INCREF(ins);
             selfitems[cur] = ins;
         }
+        gc::writeBarrier(self);
 
         for (i = 0; i < slicelength; i++) {
             Py_DECREF(garbage[i]);
@@ -418,6 +426,7 @@ int list_ass_ext_slice(BoxedList* self, PyObject* item, PyObject* value) {
 }
 
 Box* listSetitemSliceInt64(BoxedList* self, i64 start, i64 stop, i64 step, Box* v) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(step == 1, "step sizes must be 1 in this code path");
 
     boundSliceWithLength(&start, &stop, start, stop, self->size);
@@ -456,6 +465,7 @@ Box* listSetitemSliceInt64(BoxedList* self, i64 start, i64 stop, i64 step, Box*
     }
 
     self->size += delts;
+    gc::writeBarrier(self);
 
     return None;
 }
@@ -509,6 +519,7 @@ extern "C" Box* listSetitem(BoxedList* self, Box* slice, Box* v) {
 }
 
 extern "C" Box* listDelitemInt(BoxedList* self, BoxedInt* slice) {
+    threading::GLPromoteRegion _lock;
     int64_t n = slice->n;
     if (n < 0)
         n = self->size + n;
@@ -531,6 +542,7 @@ extern "C" Box* listDelslice(BoxedList* self, Box* start, Box* stop) {
 }
 
 extern "C" Box* listDelitem(BoxedList* self, Box* slice) {
+    threading::GLPromoteRegion _lock;
     Box* rtn;
     if (PyIndex_Check(slice)) {
         Py_ssize_t i = PyNumber_AsSsize_t(slice, PyExc_IndexError);
@@ -547,6 +559,7 @@ extern "C" Box* listDelitem(BoxedList* self, Box* slice) {
 }
 
 extern "C" Box* listInsert(BoxedList* self, Box* idx, Box* v) {
+    threading::GLPromoteRegion _lock;
     if (idx->cls != int_cls) {
         raiseExcHelper(TypeError, "an integer is required");
     }
@@ -567,6 +580,7 @@ extern "C" Box* listInsert(BoxedList* self, Box* idx, Box* v) {
 
         self->size++;
         self->elts->elts[n] = v;
+        gc::writeBarrier(self);
     }
 
     return None;
@@ -614,6 +628,7 @@ Box* listMul(BoxedList* self, Box* rhs) {
 }
 
 Box* listIAdd(BoxedList* self, Box* _rhs) {
+    threading::GLPromoteRegion _lock;
     if (_rhs->cls == list_cls) {
         // This branch is safe if self==rhs:
         BoxedList* rhs = static_cast<BoxedList*>(_rhs);
@@ -628,6 +643,7 @@ Box* listIAdd(BoxedList* self, Box* _rhs) {
 
         memcpy(self->elts->elts + s1, rhs->elts->elts, sizeof(rhs->elts->elts[0]) * s2);
         self->size = s1 + s2;
+        gc::writeBarrier(self);
         return self;
     }
 
@@ -659,6 +675,7 @@ Box* listAdd(BoxedList* self, Box* _rhs) {
 }
 
 Box* listReverse(BoxedList* self) {
+    threading::GLPromoteRegion _lock;
     assert(isSubclass(self->cls, list_cls));
     for (int i = 0, j = self->size - 1; i < j; i++, j--) {
         Box* e = self->elts->elts[i];
@@ -699,6 +716,7 @@ public:
 };
 
 void listSort(BoxedList* self, Box* cmp, Box* key, Box* reverse) {
+    threading::GLPromoteRegion _lock;
     assert(isSubclass(self->cls, list_cls));
 
     if (cmp == None)
@@ -739,6 +757,7 @@ void listSort(BoxedList* self, Box* cmp, Box* key, Box* reverse) {
                     Box* new_obj = BoxedTuple::create({ key_val, boxInt(i), *obj_loc });
 
                     *obj_loc = new_obj;
+                    gc::writeBarrier(self);
                     num_keys_added++;
                 }
             }
@@ -867,6 +886,7 @@ Box* listIndex(BoxedList* self, Box* elt, BoxedInt* _start, Box** args) {
 }
 
 Box* listRemove(BoxedList* self, Box* elt) {
+    threading::GLPromoteRegion _lock;
     assert(isSubclass(self->cls, list_cls));
 
     for (int i = 0; i < self->size; i++) {
@@ -902,6 +922,7 @@ Box* listNew(BoxedClass* cls, Box* container) {
 }
 
 Box* listInit(BoxedList* self, Box* container) {
+    threading::GLPromoteRegion _lock;
     assert(isSubclass(self->cls, list_cls));
 
     if (container != None) {
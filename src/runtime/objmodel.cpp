@@ -125,11 +125,8 @@ size_t PyHasher::operator()(Box* b) const {
 #if EXPENSIVE_STAT_TIMERS
     ScopedStatTimer _st(pyhasher_timer_counter, 10);
 #endif
-    if (b->cls == str_cls) {
-        StringHash<char> H;
-        auto s = static_cast<BoxedString*>(b);
-        return H(s->data(), s->size());
-    }
+    if (b->cls == str_cls)
+        return strHashUnboxed(static_cast<BoxedString*>(b));
 
     return hashUnboxed(b);
 }
@@ -419,6 +416,7 @@ BoxedClass::BoxedClass(BoxedClass* base, gcvisit_func gc_visit, int attrs_offset
     tp_weaklistoffset = weaklist_offset;
 
     tp_flags |= Py_TPFLAGS_DEFAULT_EXTERNAL;
+    tp_flags |= Py_TPFLAGS_HAVE_VERSION_TAG;
     tp_flags |= Py_TPFLAGS_CHECKTYPES;
     tp_flags |= Py_TPFLAGS_BASETYPE;
     tp_flags |= Py_TPFLAGS_HAVE_GC;
@@ -899,10 +897,13 @@ void Box::appendNewHCAttr(Box* new_attr, SetattrRewriteArgs* rewrite_args) {
     if (rewrite_args) {
         r_new_array2->setAttr(numattrs * sizeof(Box*) + offsetof(HCAttrs::AttrList, attrs), rewrite_args->attrval);
         rewrite_args->obj->setAttr(cls->attrs_offset + offsetof(HCAttrs, attr_list), r_new_array2);
+        if (GC_GENERATIONAL)
+            rewrite_args->rewriter->call(false, (void*)gc::writeBarrier, rewrite_args->obj);
 
         rewrite_args->out_success = true;
     }
     attrs->attr_list->attrs[numattrs] = new_attr;
+    gc::writeBarrier(this);
 }
 
 void Box::setattr(BoxedString* attr, Box* val, SetattrRewriteArgs* rewrite_args) {
@@ -918,6 +919,19 @@ void Box::setattr(BoxedString* attr, Box* val, SetattrRewriteArgs* rewrite_args)
     // Only matters if we end up getting multiple classes with the same
     // structure (ex user class) and the same hidden classes, because
     // otherwise the guard will fail anyway.;
+    // Types cache their attribute lookups (see typeLookup), so the cache has to hear about every change.  Setting
+    // attributes on types is rare enough that it's not worth rewriting.
+    if (unlikely(PyType_Check(this))) {
+        // Other threads could be using the old version tag, so this needs the GRWL in write mode:
+        if (!threading::isGLPromoted()) {
+            threading::GLPromoteRegion _lock;
+            setattr(attr, val, NULL);
+            return;
+        }
+        PyType_Modified(static_cast<BoxedClass*>(this));
+        rewrite_args = NULL;
+    }
+
     if (rewrite_args)
         rewrite_args->obj->addAttrGuard(offsetof(Box, cls), (intptr_t)cls);
 
@@ -958,6 +972,7 @@ void Box::setattr(BoxedString* attr, Box* val, SetattrRewriteArgs* rewrite_args)
             assert(offset < hcls->attributeArraySize());
             Box* prev = attrs->attr_list->attrs[offset];
             attrs->attr_list->attrs[offset] = val;
+            gc::writeBarrier(this);
 
             if (rewrite_args) {
 
@@ -970,6 +985,8 @@ void Box::setattr(BoxedString* attr, Box* val, SetattrRewriteArgs* rewrite_args)
 
                     r_hattrs->setAttr(offset * sizeof(Box*) + offsetof(HCAttrs::AttrList, attrs),
                                       rewrite_args->attrval);
+                    if (GC_GENERATIONAL)
+                        rewrite_args->rewriter->call(false, (void*)gc::writeBarrier, rewrite_args->obj);
 
                     rewrite_args->out_success = true;
                 }
@@ -980,6 +997,14 @@ void Box::setattr(BoxedString* attr, Box* val, SetattrRewriteArgs* rewrite_args)
 
         assert(offset == -1);
 
+        // Adding an attribute changes the layout of the object (and maybe the hidden class tree), which other
+        // threads could be in the middle of reading.  Promoting can drop the lock, so start over once we have it:
+        if (!threading::isGLPromoted()) {
+            threading::GLPromoteRegion _lock;
+            setattr(attr, val, NULL);
+            return;
+        }
+
         if (hcls->type == HiddenClass::NORMAL) {
             HiddenClass* new_hcls = hcls->getOrMakeChild(attr);
             // make sure we don't need to rearrange the attributes
@@ -1011,6 +1036,7 @@ void Box::setattr(BoxedString* attr, Box* val, SetattrRewriteArgs* rewrite_args)
     }
 
     if (cls->instancesHaveDictAttrs()) {
+        threading::GLPromoteRegion _lock;
         BoxedDict* d = getDict();
         d->d[attr] = val;
         return;
@@ -1030,12 +1056,186 @@ extern "C" PyObject* _PyType_Lookup(PyTypeObject* type, PyObject* name) noexcept
     }
 }
 
+// A process-wide cache of typeLookup results, keyed by the class's version tag and the attribute, like CPython's
+// method cache.  A class only has a valid version tag (Py_TPFLAGS_VALID_VERSION_TAG) until something in its mro
+// changes: PyType_Modified clears it (and resets tp_version_tag to 0) for the class and all of its subclasses, and
+// the next lookup assigns a new one.
+//
+// Until the tags wrap around, a tag is never handed out twice, so the rewritten version of typeLookup can guard on
+// just the tag: if it matches, the class and everything in its mro is the same as when the IC was written.
+#define MCACHE_SIZE_EXP 10
+#define MCACHE_HASH(version, name)                                                                                     \
+    (((unsigned int)(version) * (unsigned int)((uintptr_t)(name) >> 4)) >> (8 * sizeof(unsigned int) - MCACHE_SIZE_EXP))
+
+namespace {
+// With the GRWL, lookups read the entries without taking any locks, while another thread might be filling the same
+// entry in.  So each entry is a seqlock: the writer makes seq odd while it changes the other fields, and a reader
+// only uses what it read if seq was even and the same before and after.
+struct MethodCacheEntry {
+    unsigned int seq;
+    unsigned int version;
+    BoxedString* name;
+    Box* value; // NULL if the lookup failed
+};
+}
+
+static MethodCacheEntry method_cache[1 << MCACHE_SIZE_EXP];
+// Serializes the writers: filling in entries, and assigning version tags.  Everything that invalidates version tags
+// (PyType_Modified) runs with the GRWL promoted, so no lookups happen at the same time as that.
+static DS_DEFINE_MUTEX(method_cache_lock);
+static unsigned int next_version_tag = 1;
+static bool version_tags_wrapped = false;
+
+void setupMethodCache() {
+    // The entries keep the attribute names alive, so that a new string can't show up at the same address:
+    gc::registerPotentialRootRange(method_cache, method_cache + (1 << MCACHE_SIZE_EXP));
+}
+
+// Must be called with method_cache_lock held.
+static bool assignVersionTag(BoxedClass* cls) {
+    if (PyType_HasFeature(cls, Py_TPFLAGS_VALID_VERSION_TAG))
+        return true;
+    // Classes that are still being set up aren't linked into their bases' tp_subclasses yet, so they wouldn't hear
+    // about changes to them:
+    if (!PyType_HasFeature(cls, Py_TPFLAGS_HAVE_VERSION_TAG) || !cls->tp_mro || !cls->tp_bases)
+        return false;
+
+    if (next_version_tag == 0) {
+        // Invalidating every tag isn't safe while other threads could be using them (see ensureVersionTag):
+        if (!threading::isGLPromoted())
+            return false;
+
+        // We wrapped around, so old entries might match new tags.  There's no cheap way to find the ICs that guard
+        // on the old tags, so stop letting new ICs use them.
+        memset(method_cache, 0, sizeof(method_cache));
+        PyType_Modified(object_cls);
+        version_tags_wrapped = true;
+        next_version_tag = 1;
+        return false;
+    }
+    cls->tp_version_tag = next_version_tag++;
+
+    for (auto b : *static_cast<BoxedTuple*>(cls->tp_bases)) {
+        if (!PyType_Check(b) || !assignVersionTag(static_cast<BoxedClass*>(b)))
+            return false;
+    }
+    // Lookups check the flag without the lock, so it has to become visible after the tag:
+    __atomic_store_n(&cls->tp_flags, cls->tp_flags | Py_TPFLAGS_VALID_VERSION_TAG, __ATOMIC_RELEASE);
+    return true;
+}
+
+static bool hasValidVersionTag(BoxedClass* cls) {
+    return __atomic_load_n(&cls->tp_flags, __ATOMIC_ACQUIRE) & Py_TPFLAGS_VALID_VERSION_TAG;
+}
+
+static bool ensureVersionTag(BoxedClass* cls) {
+    if (hasValidVersionTag(cls))
+        return true;
+
+    // Running out of tags means invalidating all of them, which needs the other threads to be stopped.  We can't
+    // promote the GRWL while holding method_cache_lock, so do it first:
+    if (unlikely(__atomic_load_n(&next_version_tag, __ATOMIC_RELAXED) == 0) && !threading::isGLPromoted()) {
+        threading::GLPromoteRegion _lock;
+        return ensureVersionTag(cls);
+    }
+
+    LOCK_REGION(&method_cache_lock);
+    return assignVersionTag(cls);
+}
+
+// Returns whether the cache had an entry for this lookup, and puts the result in *value if so.
+static bool methodCacheGet(BoxedClass* cls, BoxedString* attr, Box** value) {
+    if (!hasValidVersionTag(cls))
+        return false;
+    unsigned int version = cls->tp_version_tag;
+    MethodCacheEntry* entry = &method_cache[MCACHE_HASH(version, attr)];
+
+    unsigned int seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+        return false;
+    bool match = __atomic_load_n(&entry->version, __ATOMIC_RELAXED) == version
+                 && __atomic_load_n(&entry->name, __ATOMIC_RELAXED) == attr;
+    Box* rtn = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+    // Order the reads of the fields before the second read of seq:
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!match || __atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq)
+        return false;
+
+    *value = rtn;
+    return true;
+}
+
+static void methodCachePut(BoxedClass* cls, BoxedString* attr, Box* value) {
+    // Once the class has a tag, it keeps it until PyType_Modified, which can't run until we're done since it needs the
+    // GRWL promoted.
+    if (!ensureVersionTag(cls))
+        return;
+
+    LOCK_REGION(&method_cache_lock);
+    MethodCacheEntry* entry = &method_cache[MCACHE_HASH(cls->tp_version_tag, attr)];
+    unsigned int seq = entry->seq;
+    __atomic_store_n(&entry->seq, seq + 1, __ATOMIC_RELAXED);
+    // Order the odd seq before the writes of the fields:
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&entry->version, cls->tp_version_tag, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->name, attr, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Classes whose attributes live in a real dict can get changed without us finding out, so lookups through them
+// can't be cached.
+static bool mroIsCacheable(BoxedClass* cls) {
+    for (auto b : *static_cast<BoxedTuple*>(cls->tp_mro)) {
+        if (b->cls->instancesHaveHCAttrs() && b->getHCAttrsPtr()->hcls->type == HiddenClass::DICT_BACKED)
+            return false;
+    }
+    return true;
+}
+
+static Box* typeLookupUncached(BoxedClass* cls, BoxedString* attr) {
+    assert(cls->tp_mro);
+    assert(cls->tp_mro->cls == tuple_cls);
+    for (auto b : *static_cast<BoxedTuple*>(cls->tp_mro)) {
+        // object_cls will get checked very often, but it only
+        // has attributes that start with an underscore.
+        if (b == object_cls) {
+            if (attr->data()[0] != '_') {
+                assert(!b->getattr(attr, NULL));
+                continue;
+            }
+        }
+
+        Box* val = b->getattr(attr, NULL);
+        if (val)
+            return val;
+    }
+    return NULL;
+}
+
 Box* typeLookup(BoxedClass* cls, BoxedString* attr, GetattrRewriteArgs* rewrite_args) {
     Box* val;
 
     if (rewrite_args) {
         assert(!rewrite_args->out_success);
 
+        if (!version_tags_wrapped && mroIsCacheable(cls) && ensureVersionTag(cls)) {
+            static StatCounter sc_tag_guards("num_typelookup_version_tag_guards");
+            sc_tag_guards.log();
+
+            // The tag pins down the whole mro and all of the attributes on it, so the result is a constant.  It
+            // stays alive for as long as the guard can pass, since the class still refers to it.
+            RewriterVar* r_tag = rewrite_args->obj->getAttr(offsetof(BoxedClass, tp_version_tag), Location::any(),
+                                                            assembler::MovType::ZLQ);
+            r_tag->addGuard(cls->tp_version_tag);
+
+            val = typeLookupUncached(cls, attr);
+            if (val)
+                rewrite_args->out_rtn = rewrite_args->rewriter->loadConst((intptr_t)val, Location::any());
+            rewrite_args->out_success = true;
+            return val;
+        }
+
         RewriterVar* obj_saved = rewrite_args->obj;
 
         auto _mro = cls->tp_mro;
@@ -1074,23 +1274,20 @@ Box* typeLookup(BoxedClass* cls, BoxedString* attr, GetattrRewriteArgs* rewrite_
     } else {
         assert(attr->interned_state != SSTATE_NOT_INTERNED);
 
-        assert(cls->tp_mro);
-        assert(cls->tp_mro->cls == tuple_cls);
-        for (auto b : *static_cast<BoxedTuple*>(cls->tp_mro)) {
-            // object_cls will get checked very often, but it only
-            // has attributes that start with an underscore.
-            if (b == object_cls) {
-                if (attr->data()[0] != '_') {
-                    assert(!b->getattr(attr, NULL));
-                    continue;
-                }
-            }
+        static StatCounter sc_hits("num_method_cache_hits");
+        static StatCounter sc_misses("num_method_cache_misses");
 
-            val = b->getattr(attr, NULL);
-            if (val)
-                return val;
+        if (methodCacheGet(cls, attr, &val)) {
+            sc_hits.log();
+            return val;
         }
-        return NULL;
+        sc_misses.log();
+
+        val = typeLookupUncached(cls, attr);
+
+        if (mroIsCacheable(cls))
+            methodCachePut(cls, attr, val);
+        return val;
     }
 }
 
@@ -2050,6 +2247,145 @@ extern "C" Box* getattr(Box* obj, BoxedString* attr) {
     raiseAttributeError(obj, attr->s());
 }
 
+static bool isCacheableDescriptor(Box* descr) {
+    BoxedClass* descr_cls = descr->cls;
+    // A user-defined class could get a __get__ later on without the class we're looking at changing:
+    if (descr_cls->tp_flags & Py_TPFLAGS_HEAPTYPE)
+        return false;
+    if (descr_cls == function_cls)
+        return true;
+    if (descr_cls->tp_descr_get || descr_cls->tp_descr_set)
+        return false;
+    // These get special-cased by getattrInternalGeneric, whether or not they have the tp_descr slots:
+    if (isNondataDescriptorInstanceSpecialCase(descr) || descr_cls == method_cls || descr_cls == member_descriptor_cls
+        || descr_cls == property_cls || descr_cls == pyston_getset_cls || descr_cls == capi_getset_cls)
+        return false;
+    return true;
+}
+
+static void fillGetattrCache(Box* obj, BoxedString* attr, GetattrCache* cache) {
+    cache->kind = GetattrCache::EMPTY;
+
+    if (version_tags_wrapped)
+        return;
+
+    BoxedClass* cls = obj->cls;
+    if (PyType_Check(obj) || cls == instancemethod_cls)
+        return;
+    if ((cls->tp_getattro && cls->tp_getattro != PyObject_GenericGetAttr) || cls->tp_getattr)
+        return;
+
+    HiddenClass* hcls = NULL;
+    if (cls->instancesHaveHCAttrs()) {
+        hcls = obj->getHCAttrsPtr()->hcls;
+        // Singleton hidden classes can get freed, and a new one could show up at the same address:
+        if (hcls->type != HiddenClass::NORMAL)
+            return;
+    } else if (cls->instancesHaveDictAttrs()) {
+        return;
+    }
+
+    if (!mroIsCacheable(cls) || !ensureVersionTag(cls))
+        return;
+
+    Box* descr = typeLookup(cls, attr, NULL);
+    int offset = hcls ? hcls->getOffset(attr) : -1;
+
+    GetattrCache::Kind kind;
+    if (descr) {
+        if (!isCacheableDescriptor(descr))
+            return;
+        if (offset != -1)
+            kind = GetattrCache::INSTANCE_ATTR;
+        else if (descr->cls == function_cls)
+            kind = GetattrCache::METHOD;
+        else
+            kind = GetattrCache::CLASS_ATTR;
+    } else {
+        if (offset == -1)
+            return;
+        kind = GetattrCache::INSTANCE_ATTR;
+    }
+
+    cache->kind = kind;
+    cache->version_tag = cls->tp_version_tag;
+    cache->cls = cls;
+    cache->hcls = hcls;
+    cache->offset = offset;
+    cache->descr = descr;
+}
+
+// Returns the attribute, or NULL if the cache doesn't apply.  If the attribute is a method and bind_obj_out is
+// given, this returns the unbound function and sets *bind_obj_out to the object, like getattrInternalEx does.
+static inline Box* lookupGetattrCache(Box* obj, GetattrCache* cache, Box** bind_obj_out) {
+    // The version tag of a class that has been modified is 0, which never matches a filled-in cache.  Once the tags
+    // wrap around, old caches could match new tags.
+    BoxedClass* cls = obj->cls;
+    if (cache->cls != cls || cache->version_tag != cls->tp_version_tag || unlikely(version_tags_wrapped))
+        return NULL;
+    if (cache->hcls && obj->getHCAttrsPtr()->hcls != cache->hcls)
+        return NULL;
+
+    switch (cache->kind) {
+        case GetattrCache::INSTANCE_ATTR:
+            return obj->getHCAttrsPtr()->attr_list->attrs[cache->offset];
+        case GetattrCache::CLASS_ATTR:
+            return cache->descr;
+        case GetattrCache::METHOD:
+            if (bind_obj_out) {
+                *bind_obj_out = obj;
+                return cache->descr;
+            }
+            return boxInstanceMethod(obj, cache->descr, cls);
+        default:
+            return NULL;
+    }
+}
+
+Box* getattrCached(Box* obj, BoxedString* attr, GetattrCache* cache) {
+    static StatCounter sc_hits("num_getattr_cache_hits");
+    static StatCounter sc_misses("num_getattr_cache_misses");
+
+    Box* r = lookupGetattrCache(obj, cache, NULL);
+    if (r) {
+        sc_hits.log();
+        return r;
+    }
+    sc_misses.log();
+
+    // Do the real lookup first, so that the cache only gets filled if it succeeds:
+    r = getattr(obj, attr);
+    fillGetattrCache(obj, attr, cache);
+    return r;
+}
+
+Box* callattrCached(Box* obj, BoxedString* attr, GetattrCache* cache, CallattrFlags flags, Box* arg1, Box* arg2,
+                    Box* arg3, Box** args, const std::vector<BoxedString*>* keyword_names) {
+    static StatCounter sc_hits("num_callattr_cache_hits");
+    static StatCounter sc_misses("num_callattr_cache_misses");
+
+    Box* bind_obj = NULL;
+    Box* func = flags.cls_only ? NULL : lookupGetattrCache(obj, cache, &bind_obj);
+    if (!func) {
+        sc_misses.log();
+        // Fill the cache before the call, since the call could run arbitrary code:
+        if (!flags.cls_only)
+            fillGetattrCache(obj, attr, cache);
+        return callattr(obj, attr, flags, arg1, arg2, arg3, args, keyword_names);
+    }
+    sc_hits.log();
+
+    ArgPassSpec argspec(flags.argspec);
+    if (!bind_obj)
+        return runtimeCallInternal(func, NULL, argspec, arg1, arg2, arg3, args, keyword_names);
+
+    Box** new_args = NULL;
+    if (argspec.totalPassed() >= 3)
+        new_args = (Box**)alloca(sizeof(Box*) * (argspec.totalPassed() + 1 - 3));
+    ArgPassSpec new_argspec = bindObjIntoArgs(bind_obj, NULL, NULL, argspec, arg1, arg2, arg3, args, new_args);
+    return runtimeCallInternal(func, NULL, new_argspec, arg1, arg2, arg3, new_args, keyword_names);
+}
+
 bool dataDescriptorSetSpecialCases(Box* obj, Box* val, Box* descr, SetattrRewriteArgs* rewrite_args,
                                    RewriterVar* r_descr, BoxedString* attr_name) {
 
@@ -4706,6 +5042,15 @@ extern "C" void delitem(Box* target, Box* slice) {
 
 void Box::delattr(BoxedString* attr, DelattrRewriteArgs* rewrite_args) {
     assert(attr->interned_state != SSTATE_NOT_INTERNED);
+
+    threading::GLPromoteRegion _lock;
+
+    // See the comment in Box::setattr
+    if (unlikely(PyType_Check(this))) {
+        PyType_Modified(static_cast<BoxedClass*>(this));
+        rewrite_args = NULL;
+    }
+
     if (cls->instancesHaveHCAttrs()) {
         // as soon as the hcls changes, the guard on hidden class won't pass.
         HCAttrs* attrs = getHCAttrsPtr();
@@ -4745,6 +5090,7 @@ void Box::delattr(BoxedString* attr, DelattrRewriteArgs* rewrite_args) {
         // guarantee the size of the attr_list equals the number of attrs
         int new_size = sizeof(HCAttrs::AttrList) + sizeof(Box*) * (num_attrs - 1);
         attrs->attr_list = (HCAttrs::AttrList*)gc::gc_realloc(attrs->attr_list, new_size);
+        gc::writeBarrier(this);
         return;
     }
 
@@ -5339,7 +5685,7 @@ Box* getFromGlobals(Box* globals, BoxedString* name) {
     if (globals->cls == module_cls) {
         return globals->getattr(name);
     } else if (globals->cls == dict_cls) {
-        auto d = static_cast<BoxedDict*>(globals)->d;
+        auto& d = static_cast<BoxedDict*>(globals)->d;
         auto it = d.find(name);
         if (it != d.end())
             return it->second;
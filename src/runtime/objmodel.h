@@ -146,6 +146,29 @@ Box* getattrInternalGeneric(Box* obj, BoxedString* attr, GetattrRewriteArgs* rew
 // appropriate order. It does not do any descriptor logic.
 Box* typeLookup(BoxedClass* cls, BoxedString* attr, GetattrRewriteArgs* rewrite_args);
 
+// Places that do attribute lookups but don't have an IC to rewrite (ie the AST interpreter) can keep one of these per
+// lookup site.  It remembers where the attribute was found for one (class, hidden class) pair: the class's version
+// tag tells us that nothing in its mro has changed, and the hidden class tells us where the instance keeps the
+// attribute.  Only the common cases get cached; everything else goes through the normal getattr / callattr.
+struct GetattrCache {
+    enum Kind : uint8_t {
+        EMPTY,
+        INSTANCE_ATTR, // the attribute lives in the instance, at 'offset'
+        CLASS_ATTR,    // 'descr' is a plain (non-descriptor) class attribute
+        METHOD,        // 'descr' is a function that gets bound to the instance
+    } kind;
+    unsigned int version_tag;
+    BoxedClass* cls;
+    HiddenClass* hcls; // NULL if instances of cls don't have attributes
+    int offset;
+    Box* descr;
+
+    GetattrCache() : kind(EMPTY), version_tag(0), cls(NULL), hcls(NULL), offset(-1), descr(NULL) {}
+};
+Box* getattrCached(Box* obj, BoxedString* attr, GetattrCache* cache);
+Box* callattrCached(Box* obj, BoxedString* attr, GetattrCache* cache, CallattrFlags flags, Box* arg1, Box* arg2,
+                    Box* arg3, Box** args, const std::vector<BoxedString*>* keyword_names);
+
 extern "C" void raiseAttributeErrorStr(const char* typeName, llvm::StringRef attr) __attribute__((__noreturn__));
 extern "C" void raiseAttributeError(Box* obj, llvm::StringRef attr) __attribute__((__noreturn__));
 extern "C" void raiseNotIterableError(const char* typeName) __attribute__((__noreturn__));
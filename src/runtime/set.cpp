@@ -32,18 +32,31 @@ namespace set {
 class BoxedSetIterator : public Box {
 public:
     BoxedSet* s;
-    decltype(BoxedSet::s)::iterator it;
+    // A slot in s's table; see SetTable::next().
+    size_t pos;
+    const size_t orig_size;
 
-    BoxedSetIterator(BoxedSet* s) : s(s), it(s->s.begin()) {}
+    BoxedSetIterator(BoxedSet* s) : s(s), pos(0), orig_size(s->s.size()) {}
 
     DEFAULT_CLASS(set_iterator_cls);
 
-    bool hasNext() { return it != s->s.end(); }
+    bool hasNext() {
+        // Let next() raise the error:
+        if (s->s.size() != orig_size)
+            return true;
+
+        size_t p = pos;
+        return s->s.next(&p) != NULL;
+    }
 
     Box* next() {
-        Box* rtn = *it;
-        ++it;
-        return rtn;
+        if (s->s.size() != orig_size)
+            raiseExcHelper(RuntimeError, "Set changed size during iteration");
+
+        SetEntry* e = s->s.next(&pos);
+        if (!e)
+            raiseExcHelper(StopIteration, "");
+        return e->key;
     }
 };
 
@@ -70,7 +83,10 @@ Box* setiteratorIter(BoxedSetIterator* self) {
     return self;
 }
 
+// Everything that adds or removes elements has to promote the GRWL first (see threading::isGLPromoted()), since
+// other threads could be looking things up in the same set.
 Box* setAdd2(Box* _self, Box* b) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(_self->cls, set_cls), "");
     BoxedSet* self = static_cast<BoxedSet*>(_self);
 
@@ -122,18 +138,18 @@ Box* frozensetRepr(BoxedSet* self) {
     return _setRepr(self, "frozenset");
 }
 
+// The binary set operations below only ever hash each element once: the tables store the hashes, so
+// elements of one set can be looked up in the other one directly.
+
 Box* setOrSet(BoxedSet* lhs, BoxedSet* rhs) {
     RELEASE_ASSERT(PyAnySet_Check(lhs), "");
     RELEASE_ASSERT(PyAnySet_Check(rhs), "");
 
     BoxedSet* rtn = new (lhs->cls) BoxedSet();
 
-    for (Box* elt : lhs->s) {
-        rtn->s.insert(elt);
-    }
-    for (Box* elt : rhs->s) {
-        rtn->s.insert(elt);
-    }
+    // This has to start with lhs, so that when the two sets have equal elements, the result keeps lhs's one:
+    rtn->s.copyFrom(lhs->s);
+    rtn->s.update(rhs->s);
     return rtn;
 }
 
@@ -143,9 +159,11 @@ Box* setAndSet(BoxedSet* lhs, BoxedSet* rhs) {
 
     BoxedSet* rtn = new (lhs->cls) BoxedSet();
 
-    for (Box* elt : lhs->s) {
-        if (rhs->s.count(elt))
-            rtn->s.insert(elt);
+    BoxedSet* bigger = lhs->s.size() >= rhs->s.size() ? lhs : rhs;
+    BoxedSet* smaller = bigger == lhs ? rhs : lhs;
+    for (auto it = smaller->s.begin(); it != smaller->s.end(); ++it) {
+        if (bigger->s.containsWithHash(*it, it.hash()))
+            rtn->s.insertWithHash(*it, it.hash());
     }
     return rtn;
 }
@@ -156,11 +174,18 @@ Box* setSubSet(BoxedSet* lhs, BoxedSet* rhs) {
 
     BoxedSet* rtn = new (lhs->cls) BoxedSet();
 
-    for (Box* elt : lhs->s) {
-        // TODO if len(rhs) << len(lhs), it might be more efficient
-        // to delete the elements of rhs from lhs?
-        if (rhs->s.count(elt) == 0)
-            rtn->s.insert(elt);
+    if (rhs->s.size() < lhs->s.size()) {
+        // Cheaper to copy lhs wholesale and take out the elements of rhs:
+        rtn->s.copyFrom(lhs->s);
+        for (auto it = rhs->s.begin(); it != rhs->s.end(); ++it) {
+            rtn->s.eraseWithHash(*it, it.hash());
+        }
+        return rtn;
+    }
+
+    for (auto it = lhs->s.begin(); it != lhs->s.end(); ++it) {
+        if (!rhs->s.containsWithHash(*it, it.hash()))
+            rtn->s.insertWithHash(*it, it.hash());
     }
     return rtn;
 }
@@ -171,14 +196,14 @@ Box* setXorSet(BoxedSet* lhs, BoxedSet* rhs) {
 
     BoxedSet* rtn = new (lhs->cls) BoxedSet();
 
-    for (Box* elt : lhs->s) {
-        if (rhs->s.count(elt) == 0)
-            rtn->s.insert(elt);
+    for (auto it = lhs->s.begin(); it != lhs->s.end(); ++it) {
+        if (!rhs->s.containsWithHash(*it, it.hash()))
+            rtn->s.insertWithHash(*it, it.hash());
     }
 
-    for (Box* elt : rhs->s) {
-        if (lhs->s.count(elt) == 0)
-            rtn->s.insert(elt);
+    for (auto it = rhs->s.begin(); it != rhs->s.end(); ++it) {
+        if (!lhs->s.containsWithHash(*it, it.hash()))
+            rtn->s.insertWithHash(*it, it.hash());
     }
 
     return rtn;
@@ -195,6 +220,7 @@ Box* setLen(BoxedSet* self) {
 }
 
 Box* setAdd(BoxedSet* self, Box* v) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(self->cls, set_cls), "%s", self->cls->tp_name);
 
     self->s.insert(v);
@@ -210,6 +236,7 @@ extern "C" int PySet_Add(PyObject* set, PyObject* key) noexcept {
         return -1;
     }
 
+    threading::GLPromoteRegion _lock;
     try {
         static_cast<BoxedSet*>(set)->s.insert(key);
         return 0;
@@ -220,6 +247,7 @@ extern "C" int PySet_Add(PyObject* set, PyObject* key) noexcept {
 }
 
 Box* setRemove(BoxedSet* self, Box* v) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(self->cls, set_cls), "");
 
     auto it = self->s.find(v);
@@ -232,6 +260,7 @@ Box* setRemove(BoxedSet* self, Box* v) {
 }
 
 Box* setDiscard(BoxedSet* self, Box* v) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(self->cls, set_cls), "");
 
     auto it = self->s.find(v);
@@ -242,6 +271,7 @@ Box* setDiscard(BoxedSet* self, Box* v) {
 }
 
 Box* setClear(BoxedSet* self, Box* v) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(self->cls, set_cls), "");
 
     self->s.clear();
@@ -253,19 +283,21 @@ extern "C" int PySet_Clear(PyObject* set) noexcept {
         PyErr_BadInternalCall();
         return -1;
     }
+    threading::GLPromoteRegion _lock;
     ((BoxedSet*)set)->s.clear();
     return 0;
 }
 
 Box* setUpdate(BoxedSet* self, BoxedTuple* args) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(self->cls, set_cls), "");
 
     assert(args->cls == tuple_cls);
 
     for (auto l : *args) {
-        if (l->cls == set_cls) {
+        if (PyAnySet_Check(l)) {
             BoxedSet* s2 = static_cast<BoxedSet*>(l);
-            self->s.insert(s2->s.begin(), s2->s.end());
+            self->s.update(s2->s);
         } else {
             for (auto e : l->pyElements()) {
                 self->s.insert(e);
@@ -281,9 +313,14 @@ Box* setUnion(BoxedSet* self, BoxedTuple* args) {
         raiseExcHelper(TypeError, "descriptor 'union' requires a 'set' object but received a '%s'", getTypeName(self));
 
     BoxedSet* rtn = new BoxedSet();
-    rtn->s.insert(self->s.begin(), self->s.end());
+    rtn->s.copyFrom(self->s);
 
     for (auto container : args->pyElements()) {
+        if (PyAnySet_Check(container)) {
+            rtn->s.update(static_cast<BoxedSet*>(container)->s);
+            continue;
+        }
+
         for (auto elt : container->pyElements()) {
             rtn->s.insert(elt);
         }
@@ -297,9 +334,18 @@ Box* setDifference(BoxedSet* self, BoxedTuple* args) {
         raiseExcHelper(TypeError, "descriptor 'difference' requires a 'set' object but received a '%s'",
                        getTypeName(self));
 
-    BoxedSet* rtn = (BoxedSet*)setNew(self->cls, self);
+    BoxedSet* rtn = new (self->cls) BoxedSet();
+    rtn->s.copyFrom(self->s);
 
     for (auto container : args->pyElements()) {
+        if (PyAnySet_Check(container)) {
+            BoxedSet* other = static_cast<BoxedSet*>(container);
+            for (auto it = other->s.begin(); it != other->s.end(); ++it) {
+                rtn->s.eraseWithHash(*it, it.hash());
+            }
+            continue;
+        }
+
         for (auto elt : container->pyElements()) {
             rtn->s.erase(elt);
         }
@@ -309,11 +355,25 @@ Box* setDifference(BoxedSet* self, BoxedTuple* args) {
 }
 
 Box* setDifferenceUpdate(BoxedSet* self, BoxedTuple* args) {
+    threading::GLPromoteRegion _lock;
     if (!PySet_Check(self))
         raiseExcHelper(TypeError, "descriptor 'difference' requires a 'set' object but received a '%s'",
                        getTypeName(self));
 
     for (auto container : args->pyElements()) {
+        if (container == self) {
+            self->s.clear();
+            continue;
+        }
+
+        if (PyAnySet_Check(container)) {
+            BoxedSet* other = static_cast<BoxedSet*>(container);
+            for (auto it = other->s.begin(); it != other->s.end(); ++it) {
+                self->s.eraseWithHash(*it, it.hash());
+            }
+            continue;
+        }
+
         for (auto elt : container->pyElements()) {
             self->s.erase(elt);
         }
@@ -331,8 +391,11 @@ static Box* setIssubset(BoxedSet* self, Box* container) {
     assert(PyAnySet_Check(container));
 
     BoxedSet* rhs = static_cast<BoxedSet*>(container);
-    for (auto e : self->s) {
-        if (rhs->s.find(e) == rhs->s.end())
+    if (self->s.size() > rhs->s.size())
+        return False;
+
+    for (auto it = self->s.begin(); it != self->s.end(); ++it) {
+        if (!rhs->s.containsWithHash(*it, it.hash()))
             return False;
     }
     return True;
@@ -347,8 +410,11 @@ static Box* setIssuperset(BoxedSet* self, Box* container) {
     assert(PyAnySet_Check(container));
 
     BoxedSet* rhs = static_cast<BoxedSet*>(container);
-    for (auto e : rhs->s) {
-        if (self->s.find(e) == self->s.end())
+    if (rhs->s.size() > self->s.size())
+        return False;
+
+    for (auto it = rhs->s.begin(); it != rhs->s.end(); ++it) {
+        if (!self->s.containsWithHash(*it, it.hash()))
             return False;
     }
     return True;
@@ -357,6 +423,17 @@ static Box* setIssuperset(BoxedSet* self, Box* container) {
 static Box* setIsdisjoint(BoxedSet* self, Box* container) {
     RELEASE_ASSERT(PyAnySet_Check(self), "");
 
+    if (PyAnySet_Check(container)) {
+        BoxedSet* other = static_cast<BoxedSet*>(container);
+        BoxedSet* bigger = self->s.size() >= other->s.size() ? self : other;
+        BoxedSet* smaller = bigger == self ? other : self;
+        for (auto it = smaller->s.begin(); it != smaller->s.end(); ++it) {
+            if (bigger->s.containsWithHash(*it, it.hash()))
+                return False;
+        }
+        return True;
+    }
+
     for (auto e : container->pyElements()) {
         if (self->s.find(e) != self->s.end())
             return False;
@@ -368,6 +445,17 @@ static BoxedSet* setIntersection2(BoxedSet* self, Box* container) {
     RELEASE_ASSERT(PyAnySet_Check(self), "");
 
     BoxedSet* rtn = new BoxedSet();
+    if (PyAnySet_Check(container)) {
+        BoxedSet* other = static_cast<BoxedSet*>(container);
+        BoxedSet* bigger = self->s.size() >= other->s.size() ? self : other;
+        BoxedSet* smaller = bigger == self ? other : self;
+        for (auto it = smaller->s.begin(); it != smaller->s.end(); ++it) {
+            if (bigger->s.containsWithHash(*it, it.hash()))
+                rtn->s.insertWithHash(*it, it.hash());
+        }
+        return rtn;
+    }
+
     for (auto elt : container->pyElements()) {
         if (self->s.count(elt))
             rtn->s.insert(elt);
@@ -391,20 +479,18 @@ Box* setCopy(BoxedSet* self) {
     RELEASE_ASSERT(PyAnySet_Check(self), "");
 
     BoxedSet* rtn = new BoxedSet();
-    rtn->s.insert(self->s.begin(), self->s.end());
+    rtn->s.copyFrom(self->s);
     return rtn;
 }
 
 Box* setPop(BoxedSet* self) {
+    threading::GLPromoteRegion _lock;
     RELEASE_ASSERT(isSubclass(self->cls, set_cls), "");
 
     if (!self->s.size())
         raiseExcHelper(KeyError, "pop from an empty set");
 
-    auto it = self->s.begin();
-    Box* rtn = *it;
-    self->s.erase(it);
-    return rtn;
+    return self->s.pop();
 }
 
 Box* setContains(BoxedSet* self, Box* v) {
@@ -420,8 +506,8 @@ Box* setEq(BoxedSet* self, BoxedSet* rhs) {
     if (self->s.size() != rhs->s.size())
         return False;
 
-    for (auto e : self->s) {
-        if (!rhs->s.count(e))
+    for (auto it = self->s.begin(); it != self->s.end(); ++it) {
+        if (!rhs->s.containsWithHash(*it, it.hash()))
             return False;
     }
     return True;
@@ -479,8 +565,8 @@ extern "C" PyObject* PyFrozenSet_New(PyObject* iterable) noexcept {
 using namespace pyston::set;
 
 void setupSet() {
-    set_iterator_cls = BoxedHeapClass::create(type_cls, object_cls, &setIteratorGCHandler, 0, 0, sizeof(BoxedSet),
-                                              false, "setiterator");
+    set_iterator_cls = BoxedHeapClass::create(type_cls, object_cls, &setIteratorGCHandler, 0, 0,
+                                              sizeof(BoxedSetIterator), false, "setiterator");
     set_iterator_cls->giveAttr(
         "__iter__", new BoxedFunction(boxRTFunction((void*)setiteratorIter, typeFromClass(set_iterator_cls), 1)));
     set_iterator_cls->giveAttr("__hasnext__",
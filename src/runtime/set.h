@@ -15,9 +15,8 @@
 #ifndef PYSTON_RUNTIME_SET_H
 #define PYSTON_RUNTIME_SET_H
 
-#include <unordered_set>
-
 #include "core/types.h"
+#include "runtime/settable.h"
 #include "runtime/types.h"
 
 namespace pyston {
@@ -29,14 +28,12 @@ extern "C" Box* createSet();
 
 class BoxedSet : public Box {
 public:
-    typedef std::unordered_set<Box*, PyHasher, PyEq, StlCompatAllocator<Box*>> Set;
+    typedef SetTable Set;
     Set s;
     Box** weakreflist; /* List of weak references */
 
     BoxedSet() __attribute__((visibility("default"))) {}
 
-    template <typename T> __attribute__((visibility("default"))) BoxedSet(T&& s) : s(std::forward<T>(s)) {}
-
     DEFAULT_CLASS(set_cls);
 };
 }
@@ -0,0 +1,244 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/settable.h"
+
+#include <cstring>
+
+#include "core/stats.h"
+#include "gc/collector.h"
+#include "runtime/types.h"
+
+namespace pyston {
+
+SetEntry* SetTable::lookup(Box* key, size_t hash) {
+restart:
+    // An __eq__ can clear the set out from under us:
+    if (!table)
+        return NULL;
+
+    size_t i = hash & mask;
+    size_t perturb = hash;
+    SetEntry* free_slot = NULL;
+
+    while (true) {
+        SetEntry* e = &table[i];
+        if (!e->key)
+            return free_slot ? free_slot : e;
+
+        if (e->key == dummy()) {
+            if (!free_slot)
+                free_slot = e;
+        } else {
+            if (e->key == key)
+                return e;
+
+            if (e->hash == hash) {
+                Box* startkey = e->key;
+                SetEntry* starttable = table;
+                bool eq = PyEq()(startkey, key);
+
+                // The comparison can run arbitrary code, including code that changes this set:
+                if (table != starttable || e->key != startkey)
+                    goto restart;
+
+                if (eq)
+                    return e;
+            }
+        }
+
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+}
+
+// Adds a key that isn't in the table yet, to a table that has no deleted entries.
+void SetTable::insertClean(Box* key, size_t hash) {
+    size_t i = hash & mask;
+    size_t perturb = hash;
+    while (table[i].key) {
+        perturb >>= PERTURB_SHIFT;
+        i = (i * 5 + perturb + 1) & mask;
+    }
+
+    table[i].key = key;
+    table[i].hash = hash;
+    fill++;
+    used++;
+}
+
+void SetTable::resize(size_t min_used) {
+    static StatCounter sc_resizes("set_resizes");
+    sc_resizes.log();
+
+    size_t new_size = MIN_SIZE;
+    while (new_size <= min_used)
+        new_size <<= 1;
+
+    SetEntry* old_table = table;
+    size_t old_size = table ? mask + 1 : 0;
+
+    SetEntry* new_table = (SetEntry*)gc_alloc(new_size * sizeof(SetEntry), gc::GCKind::UNTRACKED);
+    memset(new_table, 0, new_size * sizeof(SetEntry));
+
+    table = new_table;
+    mask = new_size - 1;
+    fill = used = 0;
+    finger = 0;
+
+    for (size_t i = 0; i < old_size; i++) {
+        if (old_table[i].isLive())
+            insertClean(old_table[i].key, old_table[i].hash);
+    }
+
+    if (old_table)
+        gc::gc_free(old_table);
+}
+
+SetTable::iterator SetTable::findWithHash(Box* key, size_t hash) {
+    if (used == 0)
+        return end();
+
+    SetEntry* e = lookup(key, hash);
+    if (!e || !e->isLive())
+        return end();
+    return iterator(e, table + mask + 1);
+}
+
+SetTable::iterator SetTable::find(Box* key) {
+    if (used == 0)
+        return end();
+    return findWithHash(key, PyHasher()(key));
+}
+
+bool SetTable::insertWithHash(Box* key, size_t hash) {
+    if (!table)
+        resize(0);
+
+    SetEntry* e = lookup(key, hash);
+    if (!e) {
+        // The set got cleared while we were comparing; the new table is empty, so this lookup can't call __eq__.
+        resize(0);
+        e = lookup(key, hash);
+    }
+    if (e->isLive())
+        return false;
+
+    if (!e->key)
+        fill++;
+    e->key = key;
+    e->hash = hash;
+    used++;
+
+    // Keep the table at most 2/3 full, counting the deleted entries.  Grow quickly while the set is
+    // small, like CPython does:
+    if (fill * 3 >= (mask + 1) * 2)
+        resize(used > 50000 ? used * 2 : used * 4);
+    return true;
+}
+
+bool SetTable::insert(Box* key) {
+    return insertWithHash(key, PyHasher()(key));
+}
+
+void SetTable::update(SetTable& other) {
+    if (&other == this)
+        return;
+
+    if (used == 0) {
+        copyFrom(other);
+        return;
+    }
+
+    // Make room for everything up front, instead of resizing as we go:
+    if ((fill + other.used) * 3 >= (mask + 1) * 2)
+        resize((used + other.used) * 2);
+
+    // Inserting can call __eq__, which could change other (or even resize it), so go by position and look at other's
+    // table again for every element:
+    size_t pos = 0;
+    while (SetEntry* e = other.next(&pos)) {
+        insertWithHash(e->key, e->hash);
+    }
+}
+
+void SetTable::erase(iterator it) {
+    assert(it.cur->isLive());
+    it.cur->key = dummy();
+    used--;
+}
+
+SetTable::size_type SetTable::eraseWithHash(Box* key, size_t hash) {
+    auto it = findWithHash(key, hash);
+    if (it == end())
+        return 0;
+    erase(it);
+    return 1;
+}
+
+SetTable::size_type SetTable::erase(Box* key) {
+    if (used == 0)
+        return 0;
+    return eraseWithHash(key, PyHasher()(key));
+}
+
+void SetTable::clear() {
+    SetEntry* old_table = table;
+
+    table = NULL;
+    mask = fill = used = finger = 0;
+
+    if (old_table)
+        gc::gc_free(old_table);
+}
+
+Box* SetTable::pop() {
+    assert(used);
+
+    size_t i = finger & mask;
+    while (!table[i].isLive())
+        i = (i + 1) & mask;
+
+    Box* key = table[i].key;
+    table[i].key = dummy();
+    used--;
+    finger = i + 1;
+    return key;
+}
+
+void SetTable::copyFrom(const SetTable& other) {
+    assert(used == 0);
+    if (other.used == 0)
+        return;
+    clear();
+
+    size_t bytes = (other.mask + 1) * sizeof(SetEntry);
+    table = (SetEntry*)gc_alloc(bytes, gc::GCKind::UNTRACKED);
+    memcpy(table, other.table, bytes);
+    mask = other.mask;
+    fill = other.fill;
+    used = other.used;
+}
+
+void SetTable::gcVisit(gc::GCVisitor* v) {
+    if (!table)
+        return;
+
+    v->visit(table);
+    for (size_t i = 0; i <= mask; i++) {
+        if (table[i].isLive())
+            v->visit(table[i].key);
+    }
+}
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYSTON_RUNTIME_SETTABLE_H
+#define PYSTON_RUNTIME_SETTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pyston {
+
+class Box;
+namespace gc {
+class GCVisitor;
+}
+
+struct SetEntry {
+    Box* key; // NULL for an unused slot, or SetTable::dummy() for a deleted one
+    size_t hash;
+
+    bool isLive() const { return (uintptr_t)key > 1; }
+};
+
+// The storage for BoxedSet: a flat open-addressing table of (key, hash) pairs, probed the same way
+// CPython probes its sets and dicts.  Since the hashes are stored next to the keys, resizing never
+// has to call back into Python, and operations between two sets can look up one set's keys in the
+// other without rehashing them (see the *WithHash functions).
+//
+// The table is a single gc allocation that is only reachable from the SetTable, which traces the keys
+// precisely.  That means that a SetTable has to live inside a gc object (ie a BoxedSet) to keep its
+// keys alive.
+class SetTable {
+public:
+    typedef size_t size_type;
+
+    class iterator {
+    private:
+        SetEntry* cur;
+        SetEntry* end;
+
+        void skipUnused() {
+            while (cur != end && !cur->isLive())
+                ++cur;
+        }
+
+    public:
+        iterator(SetEntry* cur, SetEntry* end) : cur(cur), end(end) { skipUnused(); }
+
+        Box* operator*() const { return cur->key; }
+        size_t hash() const { return cur->hash; }
+        iterator& operator++() {
+            ++cur;
+            skipUnused();
+            return *this;
+        }
+        bool operator==(const iterator& rhs) const { return cur == rhs.cur; }
+        bool operator!=(const iterator& rhs) const { return cur != rhs.cur; }
+
+        friend class SetTable;
+    };
+
+    // Marks deleted slots, which lookups have to probe past:
+    static Box* dummy() { return reinterpret_cast<Box*>(1); }
+
+private:
+    SetEntry* table;
+    size_t mask;   // the table has mask + 1 slots, or is NULL
+    size_t fill;   // live + deleted entries
+    size_t used;   // live entries
+    size_t finger; // where pop() starts looking, so that emptying a set with pop() is linear
+
+    static const size_t MIN_SIZE = 8;
+    static const int PERTURB_SHIFT = 5;
+
+    // Returns the slot that has the key, or the slot where it should be inserted (which will have a
+    // NULL or dummy() key).  Returns NULL if there's no table, which can happen if comparing the keys cleared the set.
+    SetEntry* lookup(Box* key, size_t hash);
+    void resize(size_t min_used);
+    void insertClean(Box* key, size_t hash);
+
+public:
+    SetTable() : table(NULL), mask(0), fill(0), used(0), finger(0) {}
+    SetTable(const SetTable&) = delete;
+    SetTable& operator=(const SetTable&) = delete;
+
+    size_type size() const { return used; }
+    bool empty() const { return used == 0; }
+
+    iterator begin() { return iterator(table, table ? table + mask + 1 : NULL); }
+    iterator end() {
+        SetEntry* e = table ? table + mask + 1 : NULL;
+        return iterator(e, e);
+    }
+
+    iterator findWithHash(Box* key, size_t hash);
+    iterator find(Box* key);
+    size_type count(Box* key) { return find(key) != end(); }
+    bool containsWithHash(Box* key, size_t hash) { return findWithHash(key, hash) != end(); }
+
+    // Returns whether the key was newly added.
+    bool insertWithHash(Box* key, size_t hash);
+    bool insert(Box* key);
+    // Adds all of other's keys, reusing their hashes.
+    void update(SetTable& other);
+
+    void erase(iterator it);
+    size_type eraseWithHash(Box* key, size_t hash);
+    size_type erase(Box* key);
+    void clear();
+
+    // Removes and returns an arbitrary key.  The set can't be empty.
+    Box* pop();
+
+    // Copies all of the keys from other into this table, which has to be empty.
+    void copyFrom(const SetTable& other);
+
+    // Position-based iteration, which is safe against the set changing in between calls: returns the
+    // first live entry at or after slot *pos and moves *pos past it, or returns NULL at the end.
+    SetEntry* next(size_t* pos) {
+        if (!table)
+            return NULL;
+        while (*pos <= mask) {
+            SetEntry* e = &table[(*pos)++];
+            if (e->isLive())
+                return e;
+        }
+        return NULL;
+    }
+
+    void gcVisit(gc::GCVisitor* v);
+};
+}
+
+#endif
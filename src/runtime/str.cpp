@@ -56,39 +56,126 @@ namespace pyston {
 BoxedString* EmptyString;
 BoxedString* characters[UCHAR_MAX + 1];
 
-BoxedString::BoxedString(const char* s, size_t n) : interned_state(SSTATE_NOT_INTERNED) {
+BoxedString::BoxedString(const char* s, size_t n) : hash(-1), interned_state(SSTATE_NOT_INTERNED), is_rope(false) {
     assert(s);
     RELEASE_ASSERT(n != llvm::StringRef::npos, "");
     memmove(data(), s, n);
     data()[n] = 0;
 }
 
-BoxedString::BoxedString(llvm::StringRef lhs, llvm::StringRef rhs) : interned_state(SSTATE_NOT_INTERNED) {
+BoxedString::BoxedString(llvm::StringRef lhs, llvm::StringRef rhs)
+    : hash(-1), interned_state(SSTATE_NOT_INTERNED), is_rope(false) {
     RELEASE_ASSERT(lhs.size() + rhs.size() != llvm::StringRef::npos, "");
     memmove(data(), lhs.data(), lhs.size());
     memmove(data() + lhs.size(), rhs.data(), rhs.size());
     data()[lhs.size() + rhs.size()] = 0;
 }
 
-BoxedString::BoxedString(llvm::StringRef s) : interned_state(SSTATE_NOT_INTERNED) {
+BoxedString::BoxedString(llvm::StringRef s) : hash(-1), interned_state(SSTATE_NOT_INTERNED), is_rope(false) {
     RELEASE_ASSERT(s.size() != llvm::StringRef::npos, "");
     memmove(data(), s.data(), s.size());
     data()[s.size()] = 0;
 }
 
-BoxedString::BoxedString(size_t n, char c) : interned_state(SSTATE_NOT_INTERNED) {
+BoxedString::BoxedString(size_t n, char c) : hash(-1), interned_state(SSTATE_NOT_INTERNED), is_rope(false) {
     RELEASE_ASSERT(n != llvm::StringRef::npos, "");
     memset(data(), c, n);
     data()[n] = 0;
 }
 
-BoxedString::BoxedString(size_t n) : interned_state(SSTATE_NOT_INTERNED) {
+BoxedString::BoxedString(size_t n) : hash(-1), interned_state(SSTATE_NOT_INTERNED), is_rope(false) {
     RELEASE_ASSERT(n != llvm::StringRef::npos, "");
     // Note: no memset.  add the null-terminator for good measure though
     // (CPython does the same thing).
     data()[n] = 0;
 }
 
+BoxedString::BoxedString(BoxedString* lhs, BoxedString* rhs)
+    : hash(-1), interned_state(SSTATE_NOT_INTERNED), is_rope(true) {
+    RELEASE_ASSERT(lhs->size() + rhs->size() != llvm::StringRef::npos, "");
+    ob_size = lhs->size() + rhs->size();
+
+    RopeData* rope = ropeData();
+    rope->lhs = lhs;
+    rope->rhs = rhs;
+    rope->flattened = NULL;
+}
+
+// Concatenations shorter than this just get copied; it's only worth making ropes once the copying would cost more
+// than the rope node and the eventual flattening.
+static const size_t ROPE_MIN_SIZE = 256;
+
+static StatCounter num_str_ropes("num_str_ropes");
+static StatCounter num_str_rope_flattens("num_str_rope_flattens");
+
+BoxedString* BoxedString::createRope(BoxedString* lhs, BoxedString* rhs) {
+    // If lhs is a rope that ends in a short piece (the common case when appending small pieces one at a time), merge
+    // rhs into that piece rather than adding another node, so that the ropes don't cost a node per append.
+    if (lhs->is_rope && !lhs->ropeData()->flattened && rhs->size() < ROPE_MIN_SIZE) {
+        RopeData* l = lhs->ropeData();
+        if (!l->rhs->is_rope && l->rhs->size() + rhs->size() < ROPE_MIN_SIZE)
+            return createRope(l->lhs, new (l->rhs->size() + rhs->size()) BoxedString(l->rhs->s(), rhs->s()));
+    }
+
+    num_str_ropes.log();
+    return new (sizeof(RopeData)) BoxedString(lhs, rhs);
+}
+
+char* BoxedString::flattenRope() {
+    RopeData* rope = ropeData();
+    if (rope->flattened)
+        return rope->flattened;
+
+    // Another thread could be flattening this rope (or one of its pieces) at the same time:
+    if (!threading::isGLPromoted()) {
+        threading::GLPromoteRegion _lock;
+        return flattenRope();
+    }
+
+    num_str_rope_flattens.log();
+
+    char* buf = (char*)gc_alloc(size() + 1, gc::GCKind::UNTRACKED);
+    buf[size()] = 0;
+
+    // Fill the buffer in from the back, going through the pieces right-to-left.  This has to be iterative since
+    // ropes can be arbitrarily deep (ex a loop that does s = piece + s).
+    size_t pos = size();
+    llvm::SmallVector<BoxedString*, 16> pieces;
+    pieces.push_back(this);
+    while (!pieces.empty()) {
+        BoxedString* piece = pieces.pop_back_val();
+        if (piece->is_rope && !piece->ropeData()->flattened) {
+            pieces.push_back(piece->ropeData()->lhs);
+            pieces.push_back(piece->ropeData()->rhs);
+            continue;
+        }
+
+        pos -= piece->size();
+        memcpy(buf + pos, piece->data(), piece->size());
+    }
+    assert(pos == 0);
+
+    rope->flattened = buf;
+    rope->lhs = rope->rhs = NULL;
+    gc::writeBarrier(this);
+    return buf;
+}
+
+void BoxedString::gcHandler(GCVisitor* v, Box* b) {
+    boxGCHandler(v, b);
+
+    BoxedString* s = static_cast<BoxedString*>(b);
+    if (s->is_rope) {
+        RopeData* rope = s->ropeData();
+        if (rope->flattened) {
+            v->visit(rope->flattened);
+        } else {
+            v->visit(rope->lhs);
+            v->visit(rope->rhs);
+        }
+    }
+}
+
 extern "C" char PyString_GetItem(PyObject* op, ssize_t n) noexcept {
     RELEASE_ASSERT(PyString_Check(op), "");
     return static_cast<const BoxedString*>(op)->s()[n];
@@ -349,6 +436,8 @@ extern "C" Box* strAdd(BoxedString* lhs, Box* _rhs) {
     }
 
     BoxedString* rhs = static_cast<BoxedString*>(_rhs);
+    if (lhs->size() + rhs->size() >= ROPE_MIN_SIZE && lhs->size() && rhs->size())
+        return BoxedString::createRope(lhs, rhs);
     return new (lhs->size() + rhs->size()) BoxedString(lhs->s(), rhs->s());
 }
 
@@ -359,7 +448,17 @@ extern "C" PyObject* PyString_InternFromString(const char* s) noexcept {
     return internStringImmortal(s);
 }
 
+// Other threads can be looking strings up at the same time, so adding one needs the GRWL in write mode:
 BoxedString* internStringImmortal(llvm::StringRef s) {
+    if (!threading::isGLPromoted()) {
+        auto it = interned_strings.find(s);
+        if (it != interned_strings.end())
+            return it->second;
+
+        threading::GLPromoteRegion _lock;
+        return internStringImmortal(s);
+    }
+
     auto& entry = interned_strings[s];
     if (!entry) {
         num_interned_strings.log();
@@ -382,6 +481,18 @@ extern "C" void PyString_InternInPlace(PyObject** p) noexcept {
     if (PyString_CHECK_INTERNED(s))
         return;
 
+    if (!threading::isGLPromoted()) {
+        auto it = interned_strings.find(s->s());
+        if (it != interned_strings.end()) {
+            *p = it->second;
+            return;
+        }
+
+        threading::GLPromoteRegion _lock;
+        PyString_InternInPlace(p);
+        return;
+    }
+
     auto& entry = interned_strings[s->s()];
     if (entry)
         *p = entry;
@@ -1544,8 +1655,7 @@ extern "C" size_t unicodeHashUnboxed(PyUnicodeObject* self) {
 extern "C" Box* strHash(BoxedString* self) {
     assert(PyString_Check(self));
 
-    StringHash<char> H;
-    return boxInt(H(self->data(), self->size()));
+    return boxInt(strHashUnboxed(self));
 }
 
 extern "C" Box* strNonzero(BoxedString* self) {
@@ -1782,15 +1892,38 @@ Box* strReplace(Box* _self, Box* _old, Box* _new, Box** _args) {
         raiseExcHelper(TypeError, "an integer is required");
 
     int max_replaces = static_cast<BoxedInt*>(_maxreplace)->n;
-    size_t start_pos = 0;
-    std::string s = self->s();
+
+    // The empty string matches in between every character (and at both ends), which the loop below doesn't handle:
+    if (old->size() == 0) {
+        std::string s = self->s();
+        size_t start_pos = 0;
+        for (int num_replaced = 0; num_replaced < max_replaces || max_replaces < 0; ++num_replaced) {
+            if (start_pos > s.size())
+                break;
+            s.insert(start_pos, new_->s());
+            start_pos += new_->size() + 1;
+        }
+        return boxString(s);
+    }
+
+    const char* data = self->data();
+    Py_ssize_t size = self->size();
+
+    std::string s;
+    Py_ssize_t pos = 0;
     for (int num_replaced = 0; num_replaced < max_replaces || max_replaces < 0; ++num_replaced) {
-        start_pos = s.find(old->s(), start_pos);
-        if (start_pos == std::string::npos)
+        Py_ssize_t found = _PyString_FindSubstring(data + pos, size - pos, old->data(), old->size());
+        if (found == -1)
             break;
-        s.replace(start_pos, old->size(), new_->s());
-        start_pos += new_->size(); // Handles case where 'to' is a substring of 'from'
+        s.append(data + pos, found);
+        s.append(new_->data(), new_->size());
+        pos += found + old->size();
     }
+
+    if (pos == 0 && self->cls == str_cls)
+        return self;
+
+    s.append(data + pos, size - pos);
     return boxString(s);
 }
 
@@ -1798,8 +1931,8 @@ Box* strPartition(BoxedString* self, BoxedString* sep) {
     RELEASE_ASSERT(PyString_Check(self), "");
     RELEASE_ASSERT(PyString_Check(sep), "");
 
-    size_t found_idx = self->s().find(sep->s());
-    if (found_idx == std::string::npos)
+    Py_ssize_t found_idx = _PyString_FindSubstring(self->data(), self->size(), sep->data(), sep->size());
+    if (found_idx == -1)
         return BoxedTuple::create({ self, EmptyString, EmptyString });
 
 
@@ -1952,11 +2085,12 @@ Box* strTranslate(BoxedString* self, BoxedString* table, BoxedString* delete_cha
         raiseExcHelper(TypeError, "descriptor 'translate' requires a 'str' object but received a '%s'",
                        getTypeName(self));
 
-    std::unordered_set<char> delete_set;
+    bool delete_set[256] = {};
     if (delete_chars) {
         if (!PyString_Check(delete_chars))
             raiseExcHelper(TypeError, "expected a character buffer object");
-        delete_set.insert(delete_chars->s().begin(), delete_chars->s().end());
+        for (const char c : delete_chars->s())
+            delete_set[(unsigned char)c] = true;
     }
 
     bool have_table = table != None;
@@ -1968,9 +2102,10 @@ Box* strTranslate(BoxedString* self, BoxedString* table, BoxedString* delete_cha
     }
 
     std::string str;
+    str.reserve(self->size());
     for (const char c : self->s()) {
-        if (!delete_set.count(c))
-            str.append(1, have_table ? table->s()[(unsigned char)c] : c);
+        if (!delete_set[(unsigned char)c])
+            str.push_back(have_table ? table->data()[(unsigned char)c] : c);
     }
     return boxString(str);
 }
@@ -1978,17 +2113,15 @@ Box* strTranslate(BoxedString* self, BoxedString* table, BoxedString* delete_cha
 Box* strLower(BoxedString* self) {
     assert(PyString_Check(self));
 
-    BoxedString* rtn = new (self->size()) BoxedString(self->s());
-    for (int i = 0; i < rtn->size(); i++)
-        rtn->data()[i] = std::tolower(rtn->data()[i]);
+    BoxedString* rtn = BoxedString::createUninitializedString(self->size());
+    _PyString_Lower(rtn->getWriteableStringContents(), self->data(), self->size());
     return rtn;
 }
 
 Box* strUpper(BoxedString* self) {
     assert(PyString_Check(self));
-    BoxedString* rtn = new (self->size()) BoxedString(self->s());
-    for (int i = 0; i < rtn->size(); i++)
-        rtn->data()[i] = std::toupper(rtn->data()[i]);
+    BoxedString* rtn = BoxedString::createUninitializedString(self->size());
+    _PyString_Upper(rtn->getWriteableStringContents(), self->data(), self->size());
     return rtn;
 }
 
@@ -2020,8 +2153,8 @@ Box* strContains(BoxedString* self, Box* elt) {
 
     BoxedString* sub = static_cast<BoxedString*>(elt);
 
-    size_t found_idx = self->s().find(sub->s());
-    if (found_idx == std::string::npos)
+    Py_ssize_t found_idx = _PyString_FindSubstring(self->data(), self->size(), sub->data(), sub->size());
+    if (found_idx == -1)
         return False;
     return True;
 }
@@ -2400,8 +2533,11 @@ extern "C" int _PyString_Resize(PyObject** pv, Py_ssize_t newsize) noexcept {
 
     if (newsize < s->size()) {
         // XXX resize the box (by reallocating) smaller if it makes sense
+        // Flatten a rope while it still has its old size, since that's how much flattenRope() will copy:
+        char* data = s->data();
         s->ob_size = newsize;
-        s->data()[newsize] = 0;
+        data[newsize] = 0;
+        s->hash = -1;
         return 0;
     }
 
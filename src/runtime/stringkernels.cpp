@@ -0,0 +1,229 @@
+// Copyright (c) 2014-2015 Dropbox, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Vectorized versions of the inner loops of str searching, counting and case conversion.
+//
+// Every kernel has an SSE2 version (which every x86-64 cpu has) and an AVX2 version; which one gets used is decided
+// the first time the kernel gets called, based on what the cpu supports.  Single-character searches just call into
+// libc, whose memchr/memrchr already do the same thing.
+
+#include <cctype>
+#include <clocale>
+#include <cstring>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#include "Python.h"
+
+namespace pyston {
+
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+
+static bool cpuHasAVX2() {
+    static int has_avx2 = -1;
+    if (has_avx2 == -1) {
+        __builtin_cpu_init();
+        has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return has_avx2;
+}
+
+// Looks for p (of length m >= 2) in s, by comparing a whole vector of positions against the first and the last
+// character of p at once, and only doing a full comparison at the positions where both of those match.
+// Handles the positions where the vectors still fit entirely inside of s, and returns -1 if there was no match
+// among those; *scanned is set to the first position that didn't get looked at.
+static Py_ssize_t findSubstringSSE2(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m, Py_ssize_t* scanned) {
+    const __m128i first = _mm_set1_epi8(p[0]);
+    const __m128i last = _mm_set1_epi8(p[m - 1]);
+
+    Py_ssize_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(s + i + m - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                        _mm_cmpeq_epi8(last, block_last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(s + i + bit + 1, p + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    *scanned = i;
+    return -1;
+}
+
+AVX2_FUNCTION static Py_ssize_t findSubstringAVX2(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m,
+                                                  Py_ssize_t* scanned) {
+    const __m256i first = _mm256_set1_epi8(p[0]);
+    const __m256i last = _mm256_set1_epi8(p[m - 1]);
+
+    Py_ssize_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(s + i + m - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                              _mm256_cmpeq_epi8(last, block_last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(s + i + bit + 1, p + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    *scanned = i;
+    return -1;
+}
+
+extern "C" Py_ssize_t _PyString_FindSubstring(const char* s, Py_ssize_t n, const char* p, Py_ssize_t m) noexcept {
+    if (m > n)
+        return -1;
+    if (m == 0)
+        return 0;
+    if (m == 1)
+        return _PyString_FindChar(s, n, p[0]);
+
+    Py_ssize_t i = 0;
+    Py_ssize_t r;
+    if (cpuHasAVX2())
+        r = findSubstringAVX2(s, n, p, m, &i);
+    else
+        r = findSubstringSSE2(s, n, p, m, &i);
+    if (r != -1)
+        return r;
+
+    for (; i + m <= n; i++) {
+        if (s[i] == p[0] && memcmp(s + i + 1, p + 1, m - 1) == 0)
+            return i;
+    }
+    return -1;
+}
+
+extern "C" Py_ssize_t _PyString_FindChar(const char* s, Py_ssize_t n, char c) noexcept {
+    const char* r = (const char*)memchr(s, c, n);
+    return r ? r - s : -1;
+}
+
+extern "C" Py_ssize_t _PyString_RFindChar(const char* s, Py_ssize_t n, char c) noexcept {
+    const char* r = (const char*)memrchr(s, c, n);
+    return r ? r - s : -1;
+}
+
+static Py_ssize_t countCharSSE2(const char* s, Py_ssize_t n, char c, Py_ssize_t* scanned) {
+    const __m128i needle = _mm_set1_epi8(c);
+
+    Py_ssize_t count = 0;
+    Py_ssize_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(s + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+    }
+
+    *scanned = i;
+    return count;
+}
+
+AVX2_FUNCTION static Py_ssize_t countCharAVX2(const char* s, Py_ssize_t n, char c, Py_ssize_t* scanned) {
+    const __m256i needle = _mm256_set1_epi8(c);
+
+    Py_ssize_t count = 0;
+    Py_ssize_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(s + i));
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+    }
+
+    *scanned = i;
+    return count;
+}
+
+extern "C" Py_ssize_t _PyString_CountChar(const char* s, Py_ssize_t n, char c, Py_ssize_t maxcount) noexcept {
+    Py_ssize_t i = 0;
+    Py_ssize_t count;
+    if (cpuHasAVX2())
+        count = countCharAVX2(s, n, c, &i);
+    else
+        count = countCharSSE2(s, n, c, &i);
+
+    for (; i < n; i++) {
+        if (s[i] == c)
+            count++;
+    }
+    return count < maxcount ? count : maxcount;
+}
+
+// str.lower() and str.upper() go through the C library, so they depend on the LC_CTYPE locale.  The vector
+// versions only know about ASCII, so they only get used in the C locale, where that's all that changes case.
+static bool ctypeIsCLocale() {
+    const char* name = setlocale(LC_CTYPE, NULL);
+    return name && (strcmp(name, "C") == 0 || strcmp(name, "POSIX") == 0);
+}
+
+// The locale check isn't free, so it's not worth doing for short strings.
+static const Py_ssize_t MIN_VECTOR_CASE_CONVERSION_SIZE = 64;
+
+// Adds 'delta' to every byte of src that is between 'lo' and 'hi'.  Bytes >= 0x80 compare as negative, so they
+// never match.
+static Py_ssize_t convertCaseSSE2(char* dest, const char* src, Py_ssize_t n, char lo, char hi, char delta) {
+    const __m128i below = _mm_set1_epi8(lo - 1);
+    const __m128i above = _mm_set1_epi8(hi + 1);
+    const __m128i vdelta = _mm_set1_epi8(delta);
+
+    Py_ssize_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(block, below), _mm_cmpgt_epi8(above, block));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi8(block, _mm_and_si128(in_range, vdelta)));
+    }
+    return i;
+}
+
+AVX2_FUNCTION static Py_ssize_t convertCaseAVX2(char* dest, const char* src, Py_ssize_t n, char lo, char hi,
+                                                char delta) {
+    const __m256i below = _mm256_set1_epi8(lo - 1);
+    const __m256i above = _mm256_set1_epi8(hi + 1);
+    const __m256i vdelta = _mm256_set1_epi8(delta);
+
+    Py_ssize_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi8(block, below), _mm256_cmpgt_epi8(above, block));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_add_epi8(block, _mm256_and_si256(in_range, vdelta)));
+    }
+    return i;
+}
+
+static Py_ssize_t convertCase(char* dest, const char* src, Py_ssize_t n, char lo, char hi, char delta) {
+    if (n < MIN_VECTOR_CASE_CONVERSION_SIZE || !ctypeIsCLocale())
+        return 0;
+
+    if (cpuHasAVX2())
+        return convertCaseAVX2(dest, src, n, lo, hi, delta);
+    return convertCaseSSE2(dest, src, n, lo, hi, delta);
+}
+
+extern "C" void _PyString_Lower(char* dest, const char* src, Py_ssize_t n) noexcept {
+    Py_ssize_t i = convertCase(dest, src, n, 'A', 'Z', 'a' - 'A');
+    for (; i < n; i++)
+        dest[i] = std::tolower(src[i]);
+}
+
+extern "C" void _PyString_Upper(char* dest, const char* src, Py_ssize_t n) noexcept {
+    Py_ssize_t i = convertCase(dest, src, n, 'a', 'z', 'A' - 'a');
+    for (; i < n; i++)
+        dest[i] = std::toupper(src[i]);
+}
+}
@@ -308,6 +308,7 @@ extern "C" int PyTuple_SetItem(PyObject* op, Py_ssize_t i, PyObject* newitem) no
     BoxedTuple* t = static_cast<BoxedTuple*>(op);
     RELEASE_ASSERT(i >= 0 && i < t->size(), "");
     t->elts[i] = newitem;
+    gc::writeBarrier(t);
     return 0;
 }
 
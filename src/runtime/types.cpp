@@ -88,6 +88,7 @@ extern "C" void initstrop();
 namespace pyston {
 
 void setupGC();
+void setupMethodCache();
 
 bool IN_SHUTDOWN = false;
 
@@ -1067,10 +1068,14 @@ static void typeSubSetDict(Box* obj, Box* val, void* context) {
             = (HCAttrs::AttrList*)gc_alloc(sizeof(HCAttrs::AttrList) + sizeof(Box*), gc::GCKind::PRECISE);
         new_attr_list->attrs[0] = val;
 
+        if (PyType_Check(obj))
+            PyType_Modified(static_cast<BoxedClass*>(obj));
+
         HCAttrs* hcattrs = obj->getHCAttrsPtr();
 
         hcattrs->hcls = HiddenClass::dict_backed;
         hcattrs->attr_list = new_attr_list;
+        gc::writeBarrier(obj);
         return;
     }
 
@@ -1141,15 +1146,7 @@ extern "C" void setGCHandler(GCVisitor* v, Box* b) {
     boxGCHandler(v, b);
 
     BoxedSet* s = (BoxedSet*)b;
-
-    // This feels like a cludge, but we need to find anything that
-    // the unordered_map might have allocated.
-    // Another way to handle this would be to rt_alloc the unordered_map
-    // as well, though that incurs extra memory dereferences which would
-    // be nice to avoid.
-    void** start = (void**)&s->s;
-    void** end = start + (sizeof(s->s) / 8);
-    v->visitPotentialRange(start, end);
+    s->s.gcVisit(v);
 }
 
 extern "C" void sliceGCHandler(GCVisitor* v, Box* b) {
@@ -1191,15 +1188,7 @@ extern "C" void dictGCHandler(GCVisitor* v, Box* b) {
     boxGCHandler(v, b);
 
     BoxedDict* d = (BoxedDict*)b;
-
-    // This feels like a cludge, but we need to find anything that
-    // the unordered_map might have allocated.
-    // Another way to handle this would be to rt_alloc the unordered_map
-    // as well, though that incurs extra memory dereferences which would
-    // be nice to avoid.
-    void** start = (void**)&d->d;
-    void** end = start + (sizeof(d->d) / 8);
-    v->visitPotentialRange(start, end);
+    d->d.gcVisit(v);
 }
 
 extern "C" void closureGCHandler(GCVisitor* v, Box* b) {
@@ -2130,9 +2119,14 @@ public:
         RELEASE_ASSERT(_self->cls == attrwrapper_cls, "");
         AttrWrapper* self = static_cast<AttrWrapper*>(_self);
 
+        threading::GLPromoteRegion _lock;
+
         HCAttrs* attrs = self->b->getHCAttrsPtr();
         RELEASE_ASSERT(attrs->hcls->type == HiddenClass::NORMAL || attrs->hcls->type == HiddenClass::SINGLETON, "");
 
+        if (PyType_Check(self->b))
+            PyType_Modified(static_cast<BoxedClass*>(self->b));
+
         // Clear the attrs array:
         new ((void*)attrs) HCAttrs(root_hcls);
         // Add the existing attrwrapper object (ie self) back as the attrwrapper:
@@ -2258,6 +2252,12 @@ Box* Box::getAttrWrapper() {
 
     int offset = hcls->getAttrwrapperOffset();
     if (offset == -1) {
+        // Same as adding an attribute in Box::setattr:
+        if (!threading::isGLPromoted()) {
+            threading::GLPromoteRegion _lock;
+            return getAttrWrapper();
+        }
+
         Box* aw = new AttrWrapper(this);
         if (hcls->type == HiddenClass::NORMAL) {
             auto new_hcls = hcls->getAttrwrapperChild();
@@ -2713,6 +2713,7 @@ static void objectSetClass(Box* obj, Box* val, void* context) {
     RELEASE_ASSERT(obj->cls->attrs_offset == new_cls->attrs_offset, "");
 
     obj->cls = new_cls;
+    gc::writeBarrier(obj);
 }
 
 static PyMethodDef object_methods[] = {
@@ -3044,6 +3045,7 @@ void setupRuntime() {
     gc::registerPermanentRoot(root_hcls);
     HiddenClass::dict_backed = HiddenClass::makeDictBacked();
     gc::registerPermanentRoot(HiddenClass::dict_backed);
+    setupMethodCache();
 
     // Disable the GC while we do some manual initialization of the object hierarchy:
     gc::disableGC();
@@ -3074,7 +3076,8 @@ void setupRuntime() {
     // We add 1 to the tp_basicsize of the BoxedString in order to hold the null byte at the end.
     // We use offsetof(BoxedString, s_data) as opposed to sizeof(BoxedString) so that we can
     // use the extra padding bytes at the end of the BoxedString.
-    str_cls = new (0) BoxedHeapClass(basestring_cls, NULL, 0, 0, offsetof(BoxedString, s_data) + 1, false, NULL);
+    str_cls = new (0)
+        BoxedHeapClass(basestring_cls, &BoxedString::gcHandler, 0, 0, offsetof(BoxedString, s_data) + 1, false, NULL);
     str_cls->tp_flags |= Py_TPFLAGS_STRING_SUBCLASS;
     str_cls->tp_itemsize = sizeof(char);
 
@@ -27,6 +27,7 @@
 #include "core/threading.h"
 #include "core/types.h"
 #include "gc/gc_alloc.h"
+#include "runtime/dictmap.h"
 
 namespace pyston {
 
@@ -485,11 +486,22 @@ class BoxedString : public BoxVar {
 public:
     // llvm::StringRef is basically just a pointer and a length, so with proper compiler
     // optimizations and inlining, creating a new one each time shouldn't have any cost.
-    llvm::StringRef s() const { return llvm::StringRef(s_data, ob_size); };
+    // (Flattening a rope doesn't change the string's value, so this is still logically const.)
+    llvm::StringRef s() const { return llvm::StringRef(const_cast<BoxedString*>(this)->data(), ob_size); };
 
+    // cached hash of the contents (see strHashUnboxed), or -1 if it hasn't been computed yet
+    long hash;
     char interned_state;
 
-    char* data() { return s_data; }
+    // Whether this is a rope (see createRope): its characters live in a separate buffer, which only gets filled
+    // in the first time something asks for them.
+    bool is_rope;
+
+    char* data() {
+        if (unlikely(is_rope))
+            return flattenRope();
+        return s_data;
+    }
     const char* c_str() {
         assert(data()[size()] == '\0');
         return data();
@@ -534,12 +546,33 @@ public:
     // Gets a writeable pointer to the contents of a string.
     // Is only meant to be used with something just created from createUninitializedString(), though
     // in theory it might work in more cases.
-    char* getWriteableStringContents() { return s_data; }
+    char* getWriteableStringContents() { return data(); }
+
+    // Creates the concatenation of lhs and rhs without copying them: the result just remembers the two pieces,
+    // and copies them into a buffer of its own the first time its contents get accessed.  This is what makes
+    // building up a string with repeated += linear rather than quadratic.
+    static BoxedString* createRope(BoxedString* lhs, BoxedString* rhs);
+
+    static void gcHandler(GCVisitor* v, Box* b);
 
 private:
     void* operator new(size_t size) = delete;
 
     BoxedString(size_t n); // non-initializing constructor
+    BoxedString(BoxedString* lhs, BoxedString* rhs); // rope constructor
+
+    struct RopeData {
+        // The two pieces; these get cleared once the rope is flattened.
+        BoxedString* lhs;
+        BoxedString* rhs;
+        char* flattened;
+    };
+    // Ropes keep their RopeData where a regular string would keep its characters (but aligned).
+    RopeData* ropeData() {
+        assert(is_rope);
+        return reinterpret_cast<RopeData*>(reinterpret_cast<char*>(this) + sizeof(BoxedString));
+    }
+    char* flattenRope();
 
     char s_data[0];
 
@@ -560,6 +593,18 @@ template <typename T> struct StringHash {
         size_t hash = 5381;
         T c;
 
+        // Same result as the loop below, but eight characters per iteration: expanding hash * 33 + c eight times
+        // gives a polynomial whose terms don't depend on each other, instead of one long chain of dependent
+        // multiply-adds.
+        constexpr size_t p1 = 33, p2 = p1 * 33, p3 = p2 * 33, p4 = p3 * 33, p5 = p4 * 33, p6 = p5 * 33, p7 = p6 * 33,
+                         p8 = p7 * 33;
+        while (len >= 8) {
+            hash = hash * p8 + (size_t)str[0] * p7 + (size_t)str[1] * p6 + (size_t)str[2] * p5 + (size_t)str[3] * p4
+                   + (size_t)str[4] * p3 + (size_t)str[5] * p2 + (size_t)str[6] * p1 + (size_t)str[7];
+            str += 8;
+            len -= 8;
+        }
+
         while (--len >= 0) {
             c = *str++;
             hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
@@ -576,6 +621,18 @@ template <> struct StringHash<std::string> {
     }
 };
 
+// The hash of a str, computed the first time it's needed.  Strings that happen to hash to -1 just don't get their
+// hash cached.
+inline size_t strHashUnboxed(BoxedString* self) {
+    if (self->hash != -1)
+        return self->hash;
+
+    StringHash<char> H;
+    size_t r = H(self->data(), self->size());
+    self->hash = r;
+    return r;
+}
+
 
 class BoxedInstanceMethod : public Box {
 public:
@@ -800,7 +857,7 @@ struct PyLt {
 
 class BoxedDict : public Box {
 public:
-    typedef std::unordered_map<Box*, Box*, PyHasher, PyEq, StlCompatAllocator<std::pair<Box*, Box*>>> DictMap;
+    typedef pyston::DictMap DictMap;
 
     DictMap d;
 
@@ -1101,6 +1158,8 @@ public:
 };
 
 extern "C" void boxGCHandler(GCVisitor* v, Box* b);
+extern "C" void listGCHandler(GCVisitor* v, Box* b);
+extern "C" void tupleGCHandler(GCVisitor* v, Box* b);
 
 Box* objectNewNoArgs(BoxedClass* cls);
 Box* objectSetattr(Box* obj, Box* attr, Box* value);
@@ -32,9 +32,29 @@ test_load(PyObject *self, PyObject *args)
     return stored;
 }
 
+// Concatenates a copy of `a` with `b` and resizes the result, like C code that builds up a string does.
+static PyObject *
+test_concat_resize(PyObject *self, PyObject *args)
+{
+    PyObject *a, *b;
+    Py_ssize_t size;
+    if (!PyArg_ParseTuple(args, "SSn", &a, &b, &size))
+        return NULL;
+
+    PyObject* s = PyString_FromStringAndSize(PyString_AS_STRING(a), PyString_GET_SIZE(a));
+    PyString_Concat(&s, b);
+    if (!s)
+        return NULL;
+
+    if (_PyString_Resize(&s, size) < 0)
+        return NULL;
+    return s;
+}
+
 static PyMethodDef TestMethods[] = {
     {"store",  test_store, METH_VARARGS, "Store."},
     {"load",  test_load, METH_VARARGS, "Load."},
+    {"concat_resize",  test_concat_resize, METH_VARARGS, "Concatenate and resize."},
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
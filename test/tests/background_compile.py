@@ -0,0 +1,66 @@
+# Hot functions and loops should keep giving the same answers while their LLVM-tier versions get compiled on
+# the background thread, and after those versions get swapped in.
+
+try:
+    import __pyston__
+    __pyston__.setOption("ENABLE_BACKGROUND_COMPILE", 1)
+    __pyston__.setOption("OSR_THRESHOLD_BASELINE", 50)
+    __pyston__.setOption("REOPT_THRESHOLD_BASELINE", 50)
+    __pyston__.setOption("REOPT_THRESHOLD_T2", 100)
+    __pyston__.setOption("SPECULATION_THRESHOLD", 10)
+except ImportError:
+    pass
+
+import threading
+
+def f(x, y):
+    return x * 3 + y
+
+def g(n):
+    t = 0
+    for i in xrange(n):
+        t += i % 7
+    return t
+
+total = 0
+for i in xrange(20000):
+    total += f(i, 1)
+print total
+
+for n in (10, 1000, 100000):
+    print g(n)
+
+# A function that starts failing its speculations partway through:
+def h(x):
+    return x + x
+for i in xrange(5000):
+    r = h(i)
+print r
+print h("ab"), h(1.5), h([1])
+
+# A function that keeps failing its speculations while its reopt is waiting in the queue, so that the version
+# being reoptimized can get thrown out before the compile thread gets to replace it:
+def k(x):
+    return x * 2
+t = 0
+for i in xrange(200):
+    t += k(i)
+for i in xrange(20000):
+    t += len(k("ab" if i % 2 else [1]))
+    t += k(i)
+print t
+
+# Tier-ups from several threads at once:
+results = []
+def worker(k):
+    s = 0
+    for i in xrange(20000):
+        s += f(i, k)
+    results.append((k, s, g(5000 + k)))
+
+threads = [threading.Thread(target=worker, args=(k,)) for k in range(4)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+print sorted(results)
@@ -0,0 +1,40 @@
+# run_args: -C
+# With the baseline jit cache, functions that got jitted in an earlier run of this test get jitted as soon as they
+# run; either way, the results should be the same.
+
+def f(n):
+    t = 0
+    for i in xrange(n):
+        if i % 3:
+            t += i
+        else:
+            t -= 1
+    return t
+
+def g(x):
+    try:
+        return 10 / x
+    except ZeroDivisionError:
+        return None
+
+def h():
+    # Imports make the baseline jit give up on the block:
+    import math
+    return math.sqrt(16)
+
+for n in (0, 1, 5, 100, 10000):
+    print n, f(n)
+
+for i in xrange(100):
+    r = [g(x) for x in (-2, 0, 3)]
+print r
+
+for i in xrange(100):
+    r = h()
+print r
+
+# Two functions that only differ inside an expression get different cache entries:
+for op in ("+", "-"):
+    ns = {}
+    exec "def k(n):\n    t = 0\n    for i in xrange(n):\n        t = t %s i\n    return t\n" % op in ns
+    print op, ns["k"](1000)
@@ -0,0 +1,48 @@
+# With ENABLE_BLOCK_COUNTS the baseline jit counts how often each block runs, and the llvm tier uses the counts
+# to decide which side of each branch is the hot one.  Make sure that loops still compute the same thing when they
+# switch to their rarely-taken paths after getting compiled.
+
+try:
+    import __pyston__
+    __pyston__.setOption("ENABLE_BLOCK_COUNTS", 1)
+    __pyston__.setOption("OSR_THRESHOLD_BASELINE", 50)
+    __pyston__.setOption("REOPT_THRESHOLD_BASELINE", 50)
+except ImportError:
+    pass
+
+def f(n, rare):
+    t = 0
+    for i in xrange(n):
+        if i % rare == 0:
+            t += 1000
+        elif i & 1:
+            t += i
+        else:
+            t -= 1
+    return t
+
+for rare in (1000000, 97, 3, 1):
+    print f(10000, rare)
+
+def g(l):
+    total = 0
+    for x in l:
+        if isinstance(x, int):
+            total += x
+        else:
+            total += len(x)
+    return total
+
+print g(range(5000))
+print g(range(5000) + ["abc", (1, 2)] + range(10))
+
+def h(n):
+    i = 0
+    while True:
+        i += 1
+        if i >= n:
+            break
+    return i
+for i in xrange(100):
+    h(100)
+print h(10000), h(0)
@@ -0,0 +1,56 @@
+# The baseline jit reuses the values of local variables within a block instead of loading them again; make sure
+# that the values it reuses are the current ones.
+import sys
+
+def f(n):
+    t = 0
+    x = 1
+    for i in xrange(n):
+        x = x + i
+        t = t + x * x - x
+        x = x - i
+        t = t + x
+        if i == n - 1:
+            # frame introspection sees the same values:
+            l = sys._getframe().f_locals
+            print sorted((k, v) for (k, v) in l.items() if k != "l")
+    return t, x
+print f(2000)
+
+def g(n):
+    r = []
+    for i in xrange(n):
+        a = i
+        a = a + 1
+        r.append(a)
+        a = a * 2
+        r.append(a)
+    return sum(r)
+print g(1000)
+
+def gen(n):
+    x = 0
+    for i in xrange(n):
+        x = x + 1
+        y = yield x
+        x = x + y
+        yield x
+c = gen(1000)
+total = 0
+for i in xrange(1000):
+    total += c.next()
+    total += c.send(i)
+print total
+
+def h(n):
+    x = 0
+    for i in xrange(n):
+        try:
+            x = x + 1
+            if i % 100 == 0:
+                raise ValueError(x)
+            x = x + 1
+        except ValueError as e:
+            x = x + e.args[0]
+    return x
+print h(1000)
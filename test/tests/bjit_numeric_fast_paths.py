@@ -0,0 +1,66 @@
+# The baseline jit does int and float arithmetic (and int comparisons) inline when it has seen those types at a
+# site; make sure that the inline paths give the same results as the generic ones, including when the types change
+# after the code got jitted.
+import sys
+
+def arith(a, b):
+    return (a + b, a - b, a * b, a < b, a <= b, a > b, a >= b, a == b, a != b)
+
+def aug(a, b):
+    a += b
+    a -= 1
+    a *= b
+    return a
+
+def run(n):
+    t = 0
+    for i in xrange(n):
+        r = arith(i, n - i)
+        t += r[0] + r[1] + r[2] + r[3] + r[4] + r[5] + r[6] + r[7] + r[8]
+        t += aug(i, 3)
+    return t
+print run(1000)
+
+def runf(n):
+    t = 0.0
+    for i in xrange(n):
+        x = i * 0.5
+        t = t + x * x - x
+    return t
+print runf(1000)
+
+# Warm up with small ints, then go past the limits of a machine word:
+for i in xrange(1000):
+    arith(i, i)
+    aug(i, i)
+big = sys.maxint
+print arith(big, 1)
+print arith(-big - 1, 1)
+print arith(big, big)
+print arith(-big - 1, -1)
+print aug(big, 2)
+
+# ...and then hand them other types:
+print arith(1.5, 2.25)
+print arith(2, 2.5)
+print arith(2L, 3)
+try:
+    print arith("a", "b")
+except TypeError as e:
+    print e
+print arith(True, True)
+print aug(1.0, 2), aug(True, 2)
+
+class I(int):
+    def __add__(self, rhs):
+        return "I.__add__"
+    def __lt__(self, rhs):
+        return "I.__lt__"
+print arith(I(1), 2)[:4]
+print arith(1, I(2))[:4]
+
+for i in xrange(1000):
+    runf(1)
+print arith(1e308, 1e308)
+print arith(float('inf'), 1.0)
+print arith(-0.0, 0.0)
@@ -0,0 +1,87 @@
+# Exercise the dict storage through a bunch of inserts, deletes and resizes,
+# checking the results against a simpler representation of the same contents.
+
+class Collider(object):
+    # Every instance hashes the same, so everything collides:
+    def __init__(self, n):
+        self.n = n
+    def __hash__(self):
+        return 7
+    def __eq__(self, other):
+        return isinstance(other, Collider) and self.n == other.n
+
+d = {}
+ref = [None] * 5000
+for i in xrange(5000):
+    d[i] = i * 2
+    ref[i] = i * 2
+    if i % 3 == 0:
+        del d[i // 2]
+        ref[i // 2] = None
+for i, v in enumerate(ref):
+    assert d.get(i) == v
+    assert (i in d) == (v is not None)
+print len(d), sum(d), sum(d.values())
+
+# Delete almost everything, then grow it again:
+for i in range(5000):
+    d.pop(i, None)
+print len(d), d
+for i in range(300):
+    d[str(i)] = i
+print len(d), sum(d.values()), d["299"]
+
+# popitem takes everything out exactly once:
+seen = set()
+while d:
+    k, v = d.popitem()
+    assert d.get(k) is None and k not in seen
+    seen.add(k)
+print len(seen)
+
+# Keys that all collide, including deleting them out of the middle of the probe chain:
+c = {}
+for i in xrange(100):
+    c[Collider(i)] = i
+for i in xrange(0, 100, 2):
+    del c[Collider(i)]
+print len(c), sorted(c.values())[:5], Collider(51) in c, Collider(50) in c
+c[Collider(50)] = "back"
+print c[Collider(50)], len(c)
+
+# Copies and updates:
+a = dict.fromkeys(range(50), 0)
+for i in range(0, 50, 5):
+    del a[i]
+b = a.copy()
+b[100] = 1
+print len(a), len(b), sorted(b)[:3]
+e = {}
+e.update(a)
+print e == a, dict(a) == a, len(e)
+print {}.copy(), dict({}), dict(x=1)
+
+# setdefault:
+s = {}
+for i in range(20):
+    s.setdefault(i % 7, []).append(i)
+print sorted(s.items())
+
+# Changing the size during iteration is an error:
+m = dict.fromkeys(range(10))
+try:
+    for k in m:
+        m[k + 100] = None
+except RuntimeError as e:
+    print e
+try:
+    for k in m.iteritems():
+        del m[k[0]]
+except RuntimeError as e:
+    print e
+
+# Overwriting values during iteration is fine:
+m = dict.fromkeys(range(10), 0)
+for k in m:
+    m[k] = k
+print sorted(m.items())
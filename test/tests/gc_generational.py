@@ -0,0 +1,65 @@
+# run_args: -g
+# Old objects that get young objects stored into them, through the various ways that
+# can happen, need to keep those young objects alive across minor collections.
+try:
+    import __pyston__
+    __pyston__.setOption("GC_MINOR_COLLECTIONS_PER_MAJOR", 3)
+except ImportError:
+    pass
+
+import gc
+
+class C(object):
+    pass
+
+class S(object):
+    __slots__ = ("a", "b")
+
+class L(list):
+    pass
+
+class D(object):
+    pass
+
+# Make all of these old:
+l = []
+c = C()
+s = S()
+sub = L()
+d = {}
+st = set()
+t = ([],)
+swap = C()
+gc.collect()
+
+for i in xrange(300):
+    # Allocate enough that a few collections happen in between the stores:
+    garbage = [[str(j)] for j in xrange(500)]
+
+    l.append([i])
+    if i % 2:
+        l[i // 2] = [i]
+    setattr(c, "attr%d" % (i % 40), [i])
+    c.last = (i, str(i))
+    if i % 7 == 0 and hasattr(c, "attr0"):
+        del c.attr0
+    s.a = [i]
+    s.b = str(i)
+    sub.append(str(i))
+    d[i] = [i]
+    d[str(i)] = str(i)
+    st.add(str(i))
+    t[0].append((i,))
+    swap.__class__ = D if i % 2 else C
+    swap.x = [i]
+
+gc.collect()
+
+print len(l), sum(x[0] for x in l)
+print sorted(k for k in c.__dict__)[:5], c.last, c.attr39
+print s.a, s.b
+print len(sub), sub[-1]
+print len(d), sum(v[0] for k, v in d.items() if isinstance(k, int)), d["299"]
+print len(st), "123" in st
+print len(t[0]), t[0][-1]
+print type(swap).__name__, swap.x
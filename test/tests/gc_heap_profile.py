@@ -0,0 +1,59 @@
+# Test the sampling heap profiler: sample every allocation, and check that the dump
+# mentions the types and the allocation site that we created.
+
+import gc
+import os
+import tempfile
+import thread
+import time
+
+class HeapProfileTest(object):
+    pass
+
+class ThreadHeapProfileTest(object):
+    pass
+
+def f():
+    l = []
+    for i in xrange(1000):
+        l.append(HeapProfileTest())
+    return l
+
+# Sampling is per-thread, but turning it on has to reach the other threads too:
+thread_objs = []
+def thread_f():
+    for i in xrange(1000):
+        thread_objs.append(ThreadHeapProfileTest())
+
+if hasattr(gc, "set_heap_profile_interval"):
+    gc.set_heap_profile_interval(1)
+l = f()
+thread.start_new_thread(thread_f, ())
+while len(thread_objs) < 1000:
+    time.sleep(0.01)
+gc.collect()
+print len(l), len(thread_objs)
+
+if hasattr(gc, "set_heap_profile_interval"):
+    gc.set_heap_profile_interval(0)
+
+    fn = tempfile.mktemp()
+    gc.dump_heap_profile(fn)
+    data = open(fn).read()
+    os.remove(fn)
+
+    print "HeapProfileTest" in data
+    print "ThreadHeapProfileTest" in data
+    print "gc_heap_profile.py" in data
+    print "inuse_space" in data
+
+    try:
+        gc.dump_heap_profile("/nonexistent/directory/profile")
+    except IOError:
+        print "IOError"
+else:
+    print True
+    print True
+    print True
+    print True
+    print "IOError"
@@ -0,0 +1,35 @@
+# run_args: -n
+# Collect while lots of JIT frames are on the stack, and make sure that everything those frames
+# are still using (locals, temporaries, call arguments, exception state) survives.
+import gc
+
+def f(a, b, c, d, e, depth):
+    return [a, b, c, d, e, depth]
+
+class C(object):
+    def __init__(self, n):
+        self.n = n
+
+def recurse(n):
+    s = str(n)
+    l = [n, s]
+    t = (C(n), s * 2)
+    if n == 0:
+        for i in xrange(3):
+            gc.collect()
+            garbage = [[i] for i in xrange(1000)]
+        return 0
+    if n % 5 == 0:
+        try:
+            raise ValueError(s)
+        except ValueError as e:
+            r = recurse(n - 1)
+            assert e.args == (s,)
+    else:
+        # more than six arguments, so some of them go through memory:
+        r = f(C(n), [n], str(n), (n,), {n: n}, recurse(n - 1))[5]
+    assert l == [n, s] and t[0].n == n and t[1] == s + s
+    return r + n
+
+for i in xrange(5):
+    print recurse(200)
@@ -0,0 +1,44 @@
+# Garbage from the collections that get triggered by allocation can sit around in unswept blocks
+# for a while; make sure none of it is visible through weakrefs, and that the live data survives.
+try:
+    import __pyston__
+    __pyston__.setOption("GC_LAZY_SWEEP", 1)
+except ImportError:
+    pass
+
+import gc
+import weakref
+
+class C(object):
+    def __init__(self, n):
+        self.n = n
+
+callbacks = []
+
+keep = C(-1)
+live = []
+refs = []
+for i in xrange(20000):
+    c = C(i)
+    refs.append(weakref.ref(c, callbacks.append))
+    if i % 100 == 0:
+        live.append(c)
+
+    # Weakrefs that die right away, while the object they point to stays alive:
+    weakref.ref(keep)
+    weakref.proxy(keep, callbacks.append)
+
+    garbage = [(str(j), [j]) for j in xrange(20)]
+
+for i in xrange(3):
+    gc.collect()
+
+for r in refs:
+    o = r()
+    assert o is None or isinstance(o, C)
+
+print sum(1 for r in refs if r() is None) > 15000
+print len(callbacks) > 15000
+print [c.n for c in live[:5]], len(live)
+print len(weakref.getweakrefs(keep)) <= 2
+print sum(l.n for l in live)
@@ -0,0 +1,51 @@
+# Run a bunch of collections with several marking threads, and make sure that
+# everything that's still reachable survives and that finalizers and weakref
+# callbacks still get run for the garbage.
+try:
+    import __pyston__
+    __pyston__.setOption("GC_MARK_THREADS", 4)
+except ImportError:
+    pass
+
+import gc
+import weakref
+from testing_helpers import test_gc
+
+class Node(object):
+    def __init__(self, n):
+        self.children = [Node(n - 1) for i in xrange(3)] if n else []
+        self.n = n
+
+def check(node):
+    total = 1
+    for c in node.children:
+        assert c.n == node.n - 1
+        total += check(c)
+    return total
+
+roots = [Node(6) for i in xrange(5)]
+big = [(i, str(i), [i]) for i in xrange(50000)]
+
+for i in xrange(5):
+    gc.collect()
+
+print sum(check(r) for r in roots)
+print sum(t[0] + t[2][0] for t in big), big[1234]
+
+finalized = []
+class Finalized(object):
+    def __del__(self):
+        finalized.append(1)
+
+callbacks = []
+class Referent(object):
+    pass
+
+def scope():
+    objs = [Finalized() for i in xrange(100)]
+    refs = [weakref.ref(Referent(), callbacks.append) for i in xrange(100)]
+    return refs
+
+refs = test_gc(scope)
+print len(finalized) > 0, len(callbacks) > 0
+print sum(check(r) for r in roots)
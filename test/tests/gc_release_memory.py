@@ -0,0 +1,27 @@
+# Blocks that become empty get handed back to the OS (beyond a watermark) and then reused;
+# make sure that objects allocated into reused blocks, and the objects that stayed alive
+# next to them, come out intact.
+try:
+    import __pyston__
+    __pyston__.setOption("GC_FREE_MEMORY_WATERMARK", 0)
+except ImportError:
+    pass
+
+import gc
+
+keep = []
+for round in xrange(4):
+    small = [(i, str(i)) for i in xrange(100000)]
+    large = ["x" * 10000 + str(i) for i in xrange(300)]
+    keep.append((small[round], large[round]))
+    del small, large
+    for i in xrange(3):
+        gc.collect()
+
+print keep[3][0], keep[3][1][-4:], len(keep[2][1])
+print sum(t[0][0] for t in keep)
+
+if hasattr(gc, "get_reclaimed_bytes"):
+    print gc.get_reclaimed_bytes() > 0
+else:
+    print True
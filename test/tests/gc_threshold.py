@@ -0,0 +1,34 @@
+import gc
+
+old = gc.get_threshold()
+print len(old)
+
+gc.set_threshold(100000, 10)
+print gc.get_threshold()[:2]
+gc.set_threshold(500000, 20, 5)
+print gc.get_threshold()
+
+def churn():
+    l = []
+    for i in xrange(20000):
+        l.append([str(i)] * 5)
+        if len(l) > 1000:
+            l = []
+    return len(l)
+
+# Very frequent collections:
+gc.set_threshold(1000)
+print churn()
+
+# No automatic collections:
+gc.set_threshold(0)
+print churn()
+
+gc.set_threshold(*old)
+print gc.get_threshold() == old
+print churn()
+
+try:
+    gc.set_threshold("a")
+except TypeError:
+    print "TypeError"
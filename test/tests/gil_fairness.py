@@ -0,0 +1,32 @@
+# Threads that spin in Python code shouldn't be able to starve the other threads: the GIL gets handed around in the
+# order that threads asked for it, and a thread that holds it for too long gets asked to give it up.
+from thread import start_new_thread
+import time
+
+stop = []
+counts = [0] * 4
+done = []
+
+def spin(idx):
+    while not stop:
+        counts[idx] += 1
+    done.append(idx)
+
+for i in xrange(len(counts)):
+    start_new_thread(spin, (i,))
+
+# Act like an IO thread: block for short amounts of time, and check that we keep getting the GIL back.
+for i in xrange(50):
+    time.sleep(0.001)
+print "io thread finished"
+
+# Every spinning thread has to make progress while the others are spinning too:
+before = list(counts)
+while not all(c > b for c, b in zip(counts, before)):
+    time.sleep(0.01)
+print "all threads made progress"
+
+stop.append(True)
+while len(done) < len(counts):
+    time.sleep(0.01)
+print sorted(done)
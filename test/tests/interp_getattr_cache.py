@@ -0,0 +1,97 @@
+# run_args: -J
+# The interpreter caches attribute lookups per AST node; make sure that the cached results stay correct as the
+# objects and their classes change underneath them.
+
+class C(object):
+    a = "C.a"
+    def m(self, x):
+        return "C.m", x
+
+class D(C):
+    pass
+
+def load_a(o):
+    return o.a
+
+def call_m(o, *args):
+    return o.m(*args)
+
+c = C()
+d = D()
+for i in xrange(5):
+    print load_a(c), load_a(d), call_m(c, i), call_m(d, i)
+
+# Instance attributes shadow the class attribute:
+c.a = "instance a"
+print load_a(c), load_a(d)
+del c.a
+print load_a(c)
+
+# Changing the class or one of its bases:
+C.a = "new C.a"
+print load_a(c), load_a(d)
+D.a = "D.a"
+print load_a(c), load_a(d)
+C.m = lambda self, x: ("new C.m", x)
+print call_m(c, 1), call_m(d, 2)
+
+# An instance attribute that's callable:
+d.m = lambda x: ("instance m", x)
+print call_m(d, 3)
+del d.m
+print call_m(d, 4)
+
+# Descriptors aren't cached, but should still work at the same sites:
+class E(object):
+    @property
+    def a(self):
+        return "property a"
+    @staticmethod
+    def m(x):
+        return "static m", x
+e = E()
+for o in (c, d, e, c, e):
+    print load_a(o), call_m(o, 5)
+
+# Changing __class__:
+o = C()
+print load_a(o)
+o.__class__ = D
+print load_a(o)
+
+# A descriptor class that gains a __get__ later:
+class Desc(object):
+    pass
+class F(object):
+    a = Desc()
+f = F()
+print type(load_a(f)).__name__
+Desc.__get__ = lambda self, obj, type: "Desc.__get__"
+print load_a(f)
+
+# Bound methods that get loaded and not called:
+bm = c.m
+print bm(6), bm.im_self is c
+for i in xrange(3):
+    bm = getattr(d, "m")
+    print bm(i)
+
+# Failed lookups:
+try:
+    load_a(object())
+except AttributeError as ex:
+    print ex
+try:
+    call_m(1)
+except AttributeError as ex:
+    print ex
+
+# __getattr__ and __getattribute__:
+class G(object):
+    def __getattr__(self, name):
+        return "G.__getattr__", name
+class H(C):
+    def __getattribute__(self, name):
+        return "H.__getattribute__", name
+for o in (G(), H(), c):
+    print load_a(o)
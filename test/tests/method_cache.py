@@ -0,0 +1,78 @@
+# Attribute lookups on types get cached; make sure that changes to a class or to anything in its mro show up.
+
+class A(object):
+    def f(self):
+        return "A.f"
+
+class B(A):
+    pass
+
+class C(B):
+    pass
+
+c = C()
+for i in xrange(3):
+    print c.f()
+
+# Changing a base class has to invalidate its subclasses:
+A.f = lambda self: "new A.f"
+print c.f()
+
+# Overriding in an intermediate class:
+B.f = lambda self: "B.f"
+print c.f()
+del B.f
+print c.f()
+
+# Attributes that didn't exist before:
+print hasattr(c, "g")
+A.g = 5
+print c.g
+del A.g
+print hasattr(c, "g")
+
+# Changing __bases__:
+class D(object):
+    def f(self):
+        return "D.f"
+    def h(self):
+        return "D.h"
+
+B.__bases__ = (D,)
+print c.f(), c.h()
+B.__bases__ = (A,)
+print c.f(), hasattr(c, "h")
+
+# Special methods:
+class E(object):
+    def __len__(self):
+        return 1
+class F(E):
+    pass
+f = F()
+print len(f)
+E.__len__ = lambda self: 2
+print len(f)
+F.__len__ = lambda self: 3
+print len(f)
+
+# Lots of classes and attributes, to get some collisions in the cache:
+classes = []
+for i in xrange(200):
+    classes.append(type("T%d" % i, (object,), {"a%d" % i: i}))
+total = 0
+for i, cls in enumerate(classes):
+    total += getattr(cls, "a%d" % i)
+    setattr(cls, "a%d" % i, -i)
+for i, cls in enumerate(classes):
+    total += getattr(cls, "a%d" % i)
+print total
+
+# Going through the class's __dict__:
+class G(object):
+    x = 1
+g = G()
+print g.x
+G.__dict__  # make sure getting the dict doesn't break anything
+setattr(G, "x", 2)
+print g.x
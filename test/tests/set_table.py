@@ -0,0 +1,103 @@
+# Exercise the set storage: lots of adds and removes, colliding hashes, and the
+# set algebra operations, which look up one set's elements directly in the other.
+
+class Collider(object):
+    def __init__(self, n):
+        self.n = n
+    def __hash__(self):
+        return 3
+    def __eq__(self, other):
+        return isinstance(other, Collider) and self.n == other.n
+    def __repr__(self):
+        return "C%d" % self.n
+
+s = set()
+for i in xrange(5000):
+    s.add(i)
+    if i % 3 == 0:
+        s.remove(i // 2)
+print len(s), sum(s)
+
+# Remove everything one way or another, then reuse the set:
+while len(s) > 100:
+    s.pop()
+for x in list(s):
+    s.discard(x)
+print len(s), s
+s.update(range(10))
+print sorted(s)
+
+c = set(Collider(i) for i in xrange(60))
+for i in xrange(0, 60, 3):
+    c.remove(Collider(i))
+print len(c), Collider(4) in c, Collider(3) in c
+c.add(Collider(3))
+print len(c), sorted(x.n for x in c)[:5]
+
+a = set(range(0, 200))
+b = set(range(100, 300))
+small = frozenset(range(0, 200, 10))
+print len(a | b), len(b | a), len(a & b), len(b & a), len(a - b), len(b - a), len(a ^ b)
+print sorted(a - small)[:12], sorted(small & b), sorted(b & small)
+print set(small).issubset(a), a.issubset(small), a.issuperset(small), set(small).issuperset(a)
+print a.isdisjoint(b), a.isdisjoint(set([1000])), set([1000]).isdisjoint(a)
+print sorted(a.intersection(small, b)), len(a.union(b, [1000])), len(a.difference(b, small))
+print sorted(a.difference(small, b)), a == set(range(200)), a != set(range(200)), a == b
+d = set(a)
+d.difference_update(small, range(50))
+print len(d)
+d.difference_update(d)
+print d
+print sorted(set([Collider(1), Collider(2)]) & set([Collider(2), Collider(5)]), key=lambda x: x.n)
+
+# Changing the size during iteration is an error:
+m = set(range(10))
+try:
+    for x in m:
+        m.add(x + 100)
+except RuntimeError as e:
+    print e
+
+# When the two sides have equal elements, | keeps the one from the left side:
+u = set([1]) | set([1.0, 2.0, 3.0])
+print sorted((type(x).__name__, x) for x in u)
+u = set([1.0]) | set([1, 2])
+print sorted((type(x).__name__, x) for x in u)
+
+# update() has to keep working if an __eq__ call changes the set being added:
+class Mutator(object):
+    def __init__(self, n):
+        self.n = n
+    def __hash__(self):
+        return 7
+    def __eq__(self, rhs):
+        if mutating and other:
+            other.pop()
+        return False
+mutating = []
+other = set([Mutator(i) for i in xrange(20)])
+target = set([Mutator(100)])
+mutating.append(True)
+target.update(other)
+print len(target) <= 21, len(other) < 20
+
+# Or if one clears the set that's being searched or added to:
+class Clearer(object):
+    def __hash__(self):
+        return 7
+    def __eq__(self, rhs):
+        if clearing:
+            clearing.pop().clear()
+        return False
+clearing = []
+s = set([Clearer(), Clearer()])
+clearing = [s]
+print Clearer() in s, len(s)
+s = set([Clearer(), Clearer()])
+clearing = [s]
+s.add(Clearer())
+print len(s)
+s = set([Clearer(), Clearer()])
+clearing = [s]
+s.discard(Clearer())
+print len(s)
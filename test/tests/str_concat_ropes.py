@@ -0,0 +1,57 @@
+# Long concatenations produce ropes, which only get flattened once their contents are needed; make sure that
+# they behave exactly like regular strs everywhere.
+import cStringIO
+
+def build(n, piece):
+    s = ""
+    for i in xrange(n):
+        s += piece % i
+    return s
+
+s = build(5000, "<%d>")
+print len(s), s[:30], s[-30:], s.count("<"), hash(s) == hash(str(list(s) and "".join(list(s))))
+
+# Prepending builds ropes that are deep on the other side:
+t = ""
+for i in xrange(5000):
+    t = str(i % 10) + t
+print len(t), t[:20], t[-20:]
+
+# Intermediate results stay valid and independent of each other:
+a = "x" * 300
+b = a + "y"
+c = a + "z"
+d = b + "w"
+print len(a), len(b), len(c), len(d), b[-2:], c[-2:], d[-3:], b == c, b < c, d.startswith(b)
+
+# Ropes built out of ropes:
+r = (a + b) + (c + d)
+print len(r), r.count("x"), r[295:305], r.find("yx"), r.rfind("z")
+
+# Hashing, dict keys and interning:
+k1 = "key_" * 100 + "1"
+k2 = "".join(["key_"] * 100) + "1"
+dct = {k1: 1}
+print k2 in dct, dct[k2], hash(k1) == hash(k2), intern(k1) is intern(k2)
+
+# Going through the C API:
+f = cStringIO.StringIO()
+f.write(s)
+print f.getvalue() == s, len("%s|%s" % (s, t)), repr(s[100:120]), s.encode("hex")[:20], s.upper()[:10]
+print int("1" * 200 + "0" * 100) % 97, float("1" + "0" * 299) > 1e298, "".join([s, t]) == s + t
+print s.split(">")[1000], len(s.splitlines()), s.replace("<", "[")[:12], s.strip("<>")[:10]
+
+# Mutating operations on the pieces aren't possible, but make sure that the pieces staying alive doesn't matter:
+parts = [str(i) * 50 for i in xrange(100)]
+joined = ""
+for p in parts:
+    joined += p
+del parts
+import gc
+gc.collect()
+print len(joined), joined[:5], joined[-5:], joined[2500:2505]
+
+class S(str):
+    pass
+print type(S("a" * 300) + "b"), type("b" + S("a" * 300)), ("a" * 300 + S("b"))[-3:]
+print "" + "a" * 300 == "a" * 300, ("a" * 300 + "") is not None
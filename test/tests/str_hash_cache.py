@@ -0,0 +1,36 @@
+# str objects cache their hash; make sure the cached value always matches the contents, and that equal str and
+# unicode objects still hash the same.
+
+words = ["", "a", "ab", "abcdefg", "abcdefgh", "abcdefghi", "x" * 15, "y" * 16, "z" * 17, "\xff\x80abcdefgh\x01",
+         "hello world, this is a longer string"]
+for w in words:
+    h = hash(w)
+    assert hash(w) == h
+    assert hash(w[:]) == h
+    assert hash("".join(list(w))) == h
+    assert hash(str(w)) == h
+    if all(ord(c) < 128 for c in w):
+        assert hash(unicode(w)) == h, repr(w)
+
+d = {}
+for i in xrange(1000):
+    s = "key_%d_%s" % (i, "pad" * (i % 7))
+    d[s] = i
+for i in xrange(1000):
+    s = "key_%d_%s" % (i, "pad" * (i % 7))
+    assert d[s] == i
+    assert s in d
+    assert unicode(s) in d
+print len(d)
+
+class S(str):
+    pass
+s = S("abcdefghijk")
+print hash(s) == hash("abcdefghijk"), s in {"abcdefghijk": 1}
+
+# Strings that get built up in place (these go through _PyString_Resize):
+a = "%s-%s" % ("abc" * 10, 12345)
+print hash(a) == hash("abc" * 10 + "-12345")
+b = "abcdefghij".replace("c", "")
+print hash(b) == hash("abdefghij")
+print len(set(["abc" * i for i in range(100)] * 3))
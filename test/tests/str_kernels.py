@@ -0,0 +1,37 @@
+# Searching, counting, splitting, replacing and case conversion of strs go through vectorized kernels; check them
+# with needles right at the vector boundaries and at either end of strings of various lengths.
+
+for n in (0, 1, 2, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000):
+    s = "a" * n
+    for pos in sorted(set((0, 1, n // 2, n - 3, n - 2, n - 1))):
+        if pos < 0 or pos >= n:
+            continue
+        for needle in ("b", "bc", "bcd", "b" * 17):
+            t = s[:pos] + needle + s[pos + 1:]
+            print n, pos, len(needle), needle in t, t.find(needle), t.rfind(needle), t.count("b"), t.index(needle[0]),
+            print len(t.split("b")), t.partition(needle)[0] == t[:t.find(needle)], t.replace(needle, "X").count("X")
+
+# Near-misses: the first and last characters of the needle match, but the middle doesn't.
+s = "abxc" * 50 + "abcc"
+print s.find("abcc"), s.find("abxd"), "abyc" in s
+
+s = "".join(chr(i) for i in xrange(256)) * 3
+print s.find("\xff\x00\x01"), s.rfind("\x80"), s.count("\x00"), s.find("\x7f\x80"), "\xfe\xff" in s
+print s.lower() == s.lower().lower(), s.upper() == s.upper().upper(), s.lower()[60:127], s.upper()[60:127]
+print repr(s.lower()[128:140]), repr(s.upper()[200:210])
+print ("Hello World " * 20).lower(), ("Hello World " * 20).upper()
+print ("aBc" * 10).lower(), ("aBc" * 10).upper(), "X".lower(), "".upper()
+
+print "abc".replace("", "-"), "abc".replace("", "-", 2), "".replace("", "x"), "abc".replace("", "")
+print "aaaa".replace("a", "aa"), "aaaa".replace("aa", "a"), "abcabc".replace("bc", "", 1), "abc".replace("x", "y")
+print ("x" * 100 + "ab") .replace("ab", "ba")[-5:], "abab".replace("ab", "abab", -1)
+
+class S(str):
+    pass
+r = S("abc").replace("x", "y")
+print type(r), r
+
+print "a,b,,c,".split(","), "a,b,,c,".split(",", 2), ",".split(","), "".split(","), ("x," * 40).split(",")[-3:]
+print "abc".translate(None, "b"), "abc\xff".translate(None, "\xff"), "hello".translate("".join(chr((i + 1) % 256) for i in xrange(256)), "l")
+print "hello world".count("o"), "hello world".count("o", 5), "hello world".count("o", 0, 5), "aaa".count("a", 1, 2)
+print "b" in "a" * 1000, "a" * 1000 + "b" in "a" * 1001 + "b"
@@ -0,0 +1,14 @@
+# Long concatenations done through the C API produce ropes too; resizing one has to get at its characters first.
+import basic_test
+
+a = "a" * 200
+b = "b" * 200
+
+s = basic_test.concat_resize(a, b, 300)
+print len(s), s.count("a"), s.count("b"), s[195:205]
+
+s = basic_test.concat_resize(a, b, 10)
+print len(s), s
+
+s = basic_test.concat_resize(a, b, 500)
+print len(s), s[:400] == a + b
@@ -0,0 +1,64 @@
+# Several threads changing the structure of the same objects at once: appending to a list, adding and removing dict
+# keys and set elements, and setting attributes on instances and classes.  With the GRWL these all have to promote to
+# write mode, so none of the updates should get lost or corrupt the objects.
+from thread import start_new_thread, allocate_lock
+import time
+
+NTHREADS = 4
+N = 2000
+
+class C(object):
+    def m(self):
+        return 1
+
+shared_list = []
+shared_dict = {}
+shared_obj = C()
+shared_set = set()
+shared_pool = set()
+
+done_lock = allocate_lock()
+done = []
+
+def work(idx):
+    for i in xrange(N):
+        shared_list.append(i)
+        shared_dict[(idx, i)] = i
+        if i % 2:
+            del shared_dict[(idx, i - 1)]
+        # Overwriting an existing key:
+        shared_dict["last"] = i
+        setattr(shared_obj, "attr_%d_%d" % (idx, i % 50), i)
+        # Changing a class invalidates the cached lookups through it, while the other threads are doing them:
+        setattr(C, "cattr_%d" % idx, i)
+        assert getattr(shared_obj, "cattr_%d" % idx) == i and shared_obj.m() == 1
+        shared_set.add((idx, i))
+        if i % 2:
+            shared_set.discard((idx, i - 1))
+        if i % 10 == 9:
+            shared_set.remove((idx, i))
+            shared_set.update([(idx, "u", i), (idx, "v", i)])
+        # What's in here at the end depends on the timing, since the threads pop and clear each other's elements:
+        shared_pool.add((idx, i))
+        try:
+            shared_pool.pop()
+        except KeyError:
+            pass
+        if i % 100 == 0:
+            shared_pool.clear()
+    with done_lock:
+        done.append(idx)
+
+for i in xrange(NTHREADS):
+    start_new_thread(work, (i,))
+
+while len(done) < NTHREADS:
+    time.sleep(0.01)
+
+print len(shared_list), sum(shared_list) == NTHREADS * sum(xrange(N))
+print len(shared_dict), shared_dict["last"]
+print sorted(k for k in shared_dict if k != "last")[:3]
+print len([a for a in shared_obj.__dict__ if a.startswith("attr_")])
+print [getattr(C, "cattr_%d" % i) for i in xrange(NTHREADS)]
+print len(shared_set), sorted(shared_set)[:3]
+print len(shared_pool) <= NTHREADS, all(type(e) is tuple for e in shared_pool)
@@ -0,0 +1,83 @@
+# Class attribute lookups in ICs guard on the class's version tag; make sure they notice all the ways that a
+# class or one of its bases can change.
+
+class A(object):
+    x = 1
+    def f(self):
+        return "A.f"
+
+class B(A):
+    pass
+
+def get_x(o):
+    return o.x
+
+def call_f(o):
+    return o.f()
+
+def get_cls_x(c):
+    return c.x
+
+b = B()
+for i in xrange(1000):
+    if i == 200:
+        A.x = 2
+    elif i == 400:
+        B.x = 3
+    elif i == 600:
+        del B.x
+    elif i == 800:
+        del A.x
+        A.x = 4
+    if i % 100 == 0:
+        print i, get_x(b), get_cls_x(B), call_f(b)
+    get_x(b)
+    get_cls_x(B)
+    call_f(b)
+
+# Changing the bases:
+class C(object):
+    x = "C.x"
+    def f(self):
+        return "C.f"
+
+for i in xrange(300):
+    if i == 100:
+        B.__bases__ = (C,)
+    elif i == 200:
+        B.__bases__ = (A,)
+    if i % 50 == 0:
+        print i, get_x(b), call_f(b)
+    get_x(b)
+    call_f(b)
+
+# Attributes that go away:
+class D(object):
+    y = 1
+d = D()
+
+def get_y(o):
+    try:
+        return o.y
+    except AttributeError:
+        return "no y"
+
+for i in xrange(200):
+    if i == 100:
+        D.y = 2
+    if i % 50 == 0:
+        print i, get_y(d)
+    get_y(d)
+del D.y
+print get_y(d)
+
+# Lots of different classes at the same site:
+classes = [type("T%d" % i, (object,), {"x": i}) for i in xrange(50)]
+total = 0
+for j in xrange(3):
+    for c in classes:
+        total += get_cls_x(c)
+        total += get_x(c())
+    for c in classes:
+        c.x += 1
+print total
@@ -0,0 +1,132 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "codegen/object_cache.h"
+#include "core/options.h"
+#include "unittests.h"
+
+using namespace pyston;
+
+static std::string makeHash(int i) {
+    std::string hash = "hash" + std::to_string(i);
+    hash.resize(ObjectCachePackFile::hash_length, '-');
+    return hash;
+}
+
+// A bit over 1MB, and not a multiple of the alignment:
+static std::string makeObject(int i) {
+    std::string data(1024 * 1024 + i * 4099, 'a' + i % 26);
+    data.replace(0, std::to_string(i).size(), std::to_string(i));
+    return data;
+}
+
+static void checkContents(ObjectCachePackFile& cache, int num_added, int num_slots) {
+    for (int i = 0; i < num_added; i++) {
+        std::unique_ptr<llvm::MemoryBuffer> buf = cache.get(makeHash(i));
+        if (i < num_added - num_slots) {
+            EXPECT_TRUE(buf == NULL) << i;
+        } else {
+            ASSERT_TRUE(buf != NULL) << i;
+            EXPECT_TRUE(buf->getBuffer() == makeObject(i)) << i;
+        }
+    }
+}
+
+static size_t fileSize(const std::string& path) {
+    struct stat st;
+    EXPECT_EQ(0, stat(path.c_str(), &st));
+    return st.st_size;
+}
+
+// How many of our memory mappings are of this file:
+static int numMappings(const std::string& path) {
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    int n = 0;
+    while (std::getline(maps, line)) {
+        if (line.find(path) != std::string::npos)
+            n++;
+    }
+    return n;
+}
+
+TEST(object_cache, add_evict_compact) {
+    char dir[] = "/tmp/pyston_object_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    std::string path = std::string(dir) + "/object_cache.pack";
+
+    const int num_slots = 4;
+    int old_max_entries = MAX_OBJECT_CACHE_ENTRIES;
+    MAX_OBJECT_CACHE_ENTRIES = num_slots;
+
+    {
+        ObjectCachePackFile cache(path);
+
+        // Only add: our mapping stays the size of the empty file, while add() keeps appending past it.  Once more
+        // than 8MB of the file belongs to evicted objects, add() compacts it, which has to read all the live objects.
+        int n = 0;
+        for (; n < 16; n++)
+            cache.add(makeHash(n), makeObject(n));
+        checkContents(cache, n, num_slots);
+        size_t compacted_size = fileSize(path);
+        EXPECT_LT(compacted_size, 10 * 1024 * 1024);
+
+        // Now look things up in between, so that the mapping grows a bit at a time and the next compaction starts
+        // with a mapping that covers part of the file:
+        for (; n < 32; n++) {
+            cache.add(makeHash(n), makeObject(n));
+            if (n % 3 == 0)
+                checkContents(cache, n + 1, num_slots);
+        }
+        checkContents(cache, n, num_slots);
+        EXPECT_LT(fileSize(path), 16 * 1024 * 1024);
+
+        // Another cache object on the same file sees the same objects, like another process would:
+        ObjectCachePackFile other(path);
+        checkContents(other, n, num_slots);
+        other.add(makeHash(n), makeObject(n));
+        n++;
+        checkContents(cache, n, num_slots);
+    }
+
+    MAX_OBJECT_CACHE_ENTRIES = old_max_entries;
+    unlink(path.c_str());
+    rmdir(dir);
+}
+
+TEST(object_cache, mapping_grows_in_place) {
+    char dir[] = "/tmp/pyston_object_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    std::string path = std::string(dir) + "/object_cache.pack";
+
+    const int num_slots = 16;
+    int old_max_entries = MAX_OBJECT_CACHE_ENTRIES;
+    MAX_OBJECT_CACHE_ENTRIES = num_slots;
+
+    {
+        ObjectCachePackFile cache(path);
+
+        // Each lookup has to map the object that was just appended.  The buffers that we already handed out have to
+        // stay valid, but the new parts of the file should get mapped right after the old ones rather than mapping
+        // the whole file again:
+        std::vector<std::unique_ptr<llvm::MemoryBuffer>> bufs;
+        for (int n = 0; n < 8; n++) {
+            cache.add(makeHash(n), makeObject(n));
+            bufs.push_back(cache.get(makeHash(n)));
+            ASSERT_TRUE(bufs.back() != NULL) << n;
+        }
+        for (int n = 0; n < 8; n++)
+            EXPECT_TRUE(bufs[n]->getBuffer() == makeObject(n)) << n;
+        EXPECT_EQ(1, numMappings(path));
+    }
+
+    MAX_OBJECT_CACHE_ENTRIES = old_max_entries;
+    unlink(path.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+
+#include "codegen/type_recording.h"
+#include "core/options.h"
+#include "core/types.h"
+#include "unittests.h"
+
+using namespace pyston;
+
+// recordType() only looks at the class pointers, so these don't have to be real classes:
+static char fake_classes[TypeRecorder::max_classes + 1];
+static BoxedClass* fakeClass(int i) {
+    return (BoxedClass*)&fake_classes[i];
+}
+
+static void record(TypeRecorder* recorder, int cls_idx, int times) {
+    Box b;
+    b.cls = fakeClass(cls_idx);
+    for (int i = 0; i < times; i++)
+        ASSERT_EQ(&b, recordType(recorder, &b));
+}
+
+TEST(type_recording, no_counts_by_default) {
+    TypeRecorder recorder;
+    record(&recorder, 0, 10);
+    EXPECT_EQ(0, recorder.countFor(fakeClass(0)));
+    EXPECT_FALSE(recorder.isMegamorphic());
+}
+
+TEST(type_recording, counts) {
+    bool old_enable = ENABLE_TYPE_HISTOGRAMS;
+    ENABLE_TYPE_HISTOGRAMS = true;
+
+    TypeRecorder recorder;
+    ASSERT_EQ(0, recorder.countFor(fakeClass(0)));
+
+    // A site that switches back and forth between two classes:
+    for (int i = 0; i < 10; i++) {
+        record(&recorder, 0, 3);
+        record(&recorder, 1, 1);
+    }
+    EXPECT_EQ(30, recorder.countFor(fakeClass(0)));
+    EXPECT_EQ(10, recorder.countFor(fakeClass(1)));
+    EXPECT_EQ(0, recorder.countFor(fakeClass(2)));
+    EXPECT_FALSE(recorder.isMegamorphic());
+
+    for (int i = 2; i < TypeRecorder::max_classes; i++)
+        record(&recorder, i, i);
+    for (int i = 2; i < TypeRecorder::max_classes; i++)
+        EXPECT_EQ(i, recorder.countFor(fakeClass(i)));
+    EXPECT_FALSE(recorder.isMegamorphic());
+
+    // One class too many; from then on the counts stay where they were:
+    record(&recorder, TypeRecorder::max_classes, 1);
+    EXPECT_TRUE(recorder.isMegamorphic());
+    EXPECT_EQ(0, recorder.countFor(fakeClass(TypeRecorder::max_classes)));
+    record(&recorder, 0, 5);
+    EXPECT_EQ(30, recorder.countFor(fakeClass(0)));
+
+    ENABLE_TYPE_HISTOGRAMS = old_enable;
+}